@@ -3,8 +3,9 @@
 #include "PCA9685.h"           // https://github.com/NachtRaveVL/PCA9685-Arduino
 #include <Servo.h>
 #include "common.h"  // Local libary.
-#include "msTimer.h" // Local libary.
 #include "flasher.h" // Local libary.
+#include "ringPixels.h" // Local libary.
+#include "taskScheduler.h" // Local libary.
 
 #define PIN_ANALOG_POT_HEISENBERG_BIAS A2
 #define PIN_ANALOG_POT_ATOMIC_TRI_BOND A6
@@ -23,13 +24,16 @@
 PCA9685 pwmController1;
 PCA9685 pwmController2;
 
-Adafruit_NeoPixel stripIndicatorLeft = Adafruit_NeoPixel(1, PIN_WS2812B_CENTER_INDICATOR_LEFT, NEO_RGB + NEO_KHZ800);
-Adafruit_NeoPixel stripIndicatorRight = Adafruit_NeoPixel(1, PIN_WS2812B_CENTER_INDICATOR_RIGHT, NEO_RGB + NEO_KHZ800);
+ringPixels stripIndicatorLeft = ringPixels(1, PIN_WS2812B_CENTER_INDICATOR_LEFT, NEO_RGB + NEO_KHZ800);
+ringPixels stripIndicatorRight = ringPixels(1, PIN_WS2812B_CENTER_INDICATOR_RIGHT, NEO_RGB + NEO_KHZ800);
 
 Servo servoRed, servoGreen, servoBlue;
 
 signed int trigainDelta, tripanGamma, triphaseBeta;
 
+byte taskDetachServos;
+byte taskTriValues;
+
 void UpdatePWMs(bool fill)
 {
   uint16_t pwms1[16];
@@ -88,16 +92,22 @@ int RandomServoPosition()
   return pos;
 }
 
-void SetTriServoValues()
+// Servos are released once they have settled, so they do not hum.
+void DetachServos()
 {
+  servoRed.detach();
+  servoGreen.detach();
+  servoBlue.detach();
+}
 
-  static msTimer timerDetach(250);
+void SetTriServoValues()
+{
   int redPos, greenPos, bluePos;
 
   if (performActivityFlag && digitalRead(PIN_TOGGLE_1))
   {
     performActivityFlag = false;
-    timerDetach.resetDelay();
+    ScheduleTask(taskDetachServos, 250);
 
     int bias = map(analogRead(PIN_ANALOG_POT_HEISENBERG_BIAS), 0, 1023, 0, 15);
 
@@ -118,75 +128,60 @@ void SetTriServoValues()
     stripIndicatorLeft.setPixelColor(0, stripIndicatorLeft.Color(ledPos, 255 - ledPos, 0));
     stripIndicatorLeft.show();
   }
-  else
-  {
-    if (timerDetach.elapsed())
-    {
-      servoRed.detach();
-      servoGreen.detach();
-      servoBlue.detach();
-    }
-  }
 }
 
+// Steps the bars toward their targets, runs again sooner as the state rises.
 void SetTriValues()
 {
-  static msTimer timer(100);
   static signed int trigainDeltaTarget, tripanGammaTarget, triphaseBetaTarget;
 
   int delay = state == stable ? 60 : state == warning ? 30 : state == critical ? 10 : 0;
   delay += map(analogRead(PIN_ANALOG_POT_MIDI_CLORIAN_COMPENSATION), 0, 1023, 0, 50);
 
-  timer.setDelay(delay);
+  ScheduleTask(taskTriValues, delay);
 
-  if (timer.elapsed())
-  {
-    int minRange = state == stable ? 1 : state == warning ? 3 : state == critical ? 7 : 0;
-    int maxRange = state == stable ? 6 : state == warning ? 8 : state == critical ? 10 : 0;
+  int minRange = state == stable ? 1 : state == warning ? 3 : state == critical ? 7 : 0;
+  int maxRange = state == stable ? 6 : state == warning ? 8 : state == critical ? 10 : 0;
 
-    if (trigainDelta == trigainDeltaTarget)
-    {
-      trigainDeltaTarget = random(minRange, maxRange);
-    }
-    else
-    {
-      if (trigainDelta > trigainDeltaTarget)
-        trigainDelta--;
-      if (trigainDelta < trigainDeltaTarget)
-        trigainDelta++;
-    }
+  if (trigainDelta == trigainDeltaTarget)
+  {
+    trigainDeltaTarget = random(minRange, maxRange);
+  }
+  else
+  {
+    if (trigainDelta > trigainDeltaTarget)
+      trigainDelta--;
+    if (trigainDelta < trigainDeltaTarget)
+      trigainDelta++;
+  }
 
-    if (tripanGamma == tripanGammaTarget)
-    {
-      tripanGammaTarget = random(minRange, maxRange);
-    }
-    else
-    {
-      if (tripanGamma > tripanGammaTarget)
-        tripanGamma--;
-      if (tripanGamma < tripanGammaTarget)
-        tripanGamma++;
-    }
+  if (tripanGamma == tripanGammaTarget)
+  {
+    tripanGammaTarget = random(minRange, maxRange);
+  }
+  else
+  {
+    if (tripanGamma > tripanGammaTarget)
+      tripanGamma--;
+    if (tripanGamma < tripanGammaTarget)
+      tripanGamma++;
+  }
 
-    if (triphaseBeta == triphaseBetaTarget)
-    {
-      triphaseBetaTarget = random(minRange, maxRange);
-    }
-    else
-    {
-      if (triphaseBeta > triphaseBetaTarget)
-        triphaseBeta--;
-      if (triphaseBeta < triphaseBetaTarget)
-        triphaseBeta++;
-    }
+  if (triphaseBeta == triphaseBetaTarget)
+  {
+    triphaseBetaTarget = random(minRange, maxRange);
+  }
+  else
+  {
+    if (triphaseBeta > triphaseBetaTarget)
+      triphaseBeta--;
+    if (triphaseBeta < triphaseBetaTarget)
+      triphaseBeta++;
   }
 }
 
 void UpdateLeftTriangle()
 {
-
-  SetTriServoValues();
-
   static flasher flasherRed(Pattern::Sin, 1000, 255);
   static flasher flasherGreen(Pattern::Sin, 1000, 255);
   static flasher flasherBlue(Pattern::Sin, 1000, 255);
@@ -209,11 +204,9 @@ void UpdateLeftTriangle()
   analogWrite(PIN_LED_POINTER_BLUE, flasherBlue.getPwmValue());
 }
 
-void UpdateRightTriangle(bool fill)
+void UpdateRightTriangle()
 {
-  SetTriValues();
-
-  UpdatePWMs(fill);
+  UpdatePWMs(digitalRead(PIN_TOGGLE_2));
 
   int total = trigainDelta + tripanGamma + triphaseBeta;
 
@@ -251,18 +244,21 @@ void CheckActivity()
   {
     oldPot1 = pot1;
     activityFlag = true;
+    PostEvent(biTriaxialForceAlignment, eventPot + 0, pot1);
   }
 
   if (!InRange(pot2, oldPot2 - rangeTest, oldPot2 + rangeTest))
   {
     oldPot2 = pot2;
     activityFlag = true;
+    PostEvent(biTriaxialForceAlignment, eventPot + 1, pot2);
   }
 
   if (!InRange(pot3, oldPot3 - rangeTest, oldPot3 + rangeTest))
   {
     oldPot3 = pot3;
     activityFlag = true;
+    PostEvent(biTriaxialForceAlignment, eventPot + 2, pot3);
   }
 
   static bool oldToggle1, toggle1;
@@ -275,13 +271,17 @@ void CheckActivity()
   {
     oldToggle1 = toggle1;
     activityFlag = true;
+    PostEvent(biTriaxialForceAlignment, eventToggle + 0, toggle1);
   }
 
   if (oldToggle2 != toggle2)
   {
     oldToggle2 = toggle2;
     activityFlag = true;
+    PostEvent(biTriaxialForceAlignment, eventToggle + 1, toggle2);
   }
+
+  SetPanelInputs(biTriaxialForceAlignment, toggle1 | (toggle2 << 1), pot1);
 }
 
 void ShutdownPanel()
@@ -302,9 +302,26 @@ void ShutdownPanel()
   stripIndicatorRight.show();
 }
 
+void UpdateBrightness()
+{
+  int brightnessOffset = map(analogRead(PIN_ANALOG_POT_ATOMIC_TRI_BOND), 0, 1023, 0, 200);
+  stripIndicatorLeft.setBrightness(100 - brightnessOffset / 2.5);
+  stripIndicatorRight.setBrightness(255 - brightnessOffset);
+}
+
+// The panel is held dark until it is booted.
+void CheckBootup()
+{
+  if (!IsPanelBootup(biTriaxialForceAlignment))
+  {
+    ShutdownPanel();
+  }
+}
+
 void setup()
 { 
-  Serial.begin(BAUD_RATE);
+  BeginControlData();
+  HostPanel(biTriaxialForceAlignment);
 
   pinMode(PIN_TOGGLE_1, INPUT);
   digitalWrite(PIN_TOGGLE_1, HIGH);
@@ -324,29 +341,21 @@ void setup()
   pwmController2.init(0x41);
   pwmController2.setPWMFrequency(1500);
 
-  
+  AddPanelTask(biTriaxialForceAlignment, UpdateBrightness, TASK_FRAME_MS);
+  AddPanelTask(biTriaxialForceAlignment, SetTriServoValues, TASK_FRAME_MS);
+  AddPanelTask(biTriaxialForceAlignment, UpdateLeftTriangle, TASK_FRAME_MS);
+  taskTriValues = AddPanelTask(biTriaxialForceAlignment, SetTriValues, 100, 100);
+  AddPanelTask(biTriaxialForceAlignment, UpdateRightTriangle, TASK_FRAME_MS);
+  AddPanelTask(biTriaxialForceAlignment, CheckActivity, TASK_FRAME_MS);
+  taskDetachServos = AddTaskOnce(DetachServos);
+  AddTask(CheckBootup, TASK_FRAME_MS);
 }
 
 void loop()
 {
+  LatchFrameClock();
 
   CheckControlData();
 
-  if (IsPanelBootup(biTriaxialForceAlignment))
-  {
-    int brightnessOffset = map(analogRead(PIN_ANALOG_POT_ATOMIC_TRI_BOND), 0, 1023, 0, 200);
-    stripIndicatorLeft.setBrightness(100 - brightnessOffset / 2.5);
-    stripIndicatorRight.setBrightness(255 - brightnessOffset);
-
-    UpdateLeftTriangle();
-
-    bool fill = digitalRead(PIN_TOGGLE_2);
-    UpdateRightTriangle(fill);
-
-    CheckActivity();
-  }
-  else
-  {
-    ShutdownPanel();
-  }
-}
\ No newline at end of file
+  RunTasks();
+}
@@ -4,8 +4,10 @@
 #include <SPI.h>
 #include <Adafruit_NeoPixel.h> // https://github.com/adafruit/Adafruit_NeoPixel
 #include "common.h"            // Local libary.
-#include "msTimer.h"           // Local libary.
 #include "flasher.h"           // Local libary.
+#include "ringPixels.h"        // Local libary.
+#define TASK_MAX 10
+#include "taskScheduler.h"     // Local libary.
 
 #define PIN_POT_CORRECTION A0
 #define PIN_STRIP_DCDC 7
@@ -21,14 +23,20 @@
 // Hardware SPI : MOSI = pin 11, SCLK = pin 13
 Adafruit_ST7789 tft = Adafruit_ST7789(TFT_CS, TFT_DC, TFT_RST);
 
-Adafruit_NeoPixel stripDc = Adafruit_NeoPixel(10, PIN_STRIP_DCDC, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripDistribution = Adafruit_NeoPixel(3, PIN_STRIP_DISTRIBUTION, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripLambda = Adafruit_NeoPixel(1, PIN_STRIP_LAMBDA_CORRECTION, NEO_GRB + NEO_KHZ800);
+ringPixels stripDc = ringPixels(10, PIN_STRIP_DCDC, NEO_GRB + NEO_KHZ800);
+ringPixels stripDistribution = ringPixels(3, PIN_STRIP_DISTRIBUTION, NEO_GRB + NEO_KHZ800);
+ringPixels stripLambda = ringPixels(1, PIN_STRIP_LAMBDA_CORRECTION, NEO_GRB + NEO_KHZ800);
 
 int gravimetricCorrection;
 
-void UpdateStrips(int offset)
+flasher flasherLock(Pattern::Sin, 1000, 255);
+
+byte taskLambdaFlash;
+byte taskLambdaOff;
+
+void UpdateStrips()
 {
+  int offset = gravimetricCorrection;
   uint32_t colorDc = state == stable ? Color(0, 225 - 25 * offset, 25 * offset) : state == warning ? Color(127, 127, 0) : state == critical ? Color(255, 0, 0) : 0;
   stripDc.fill(colorDc, 0, stripDc.numPixels());
 
@@ -39,29 +47,20 @@ void UpdateStrips(int offset)
   stripDistribution.show();
 }
 
-void UpdateLambda()
+// Flashes the lambda LED a random color, more often as the state rises.
+void LambdaFlash()
 {
-  static msTimer timer(1000);
-  static msTimer timerFlash(200);
-  static byte wheelPos;
-  static bool toggle = false;
-
   int delay = state == stable ? 1000 : state == warning ? 750 : state == critical ? 500 : 0;
+  ScheduleTask(taskLambdaFlash, delay);
+  ScheduleTask(taskLambdaOff, 200);
 
-  if (timer.elapsed())
-  {
-    timer.setDelay(delay);
-    wheelPos = random(0, 256);
-    timerFlash.resetDelay();
-    toggle = true;
-  }
-
-  if (timerFlash.elapsed())
-  {
-    toggle = false;
-  }
+  stripLambda.setPixelColor(0, Wheel(random(0, 256)));
+  stripLambda.show();
+}
 
-  stripLambda.setPixelColor(0, toggle ? Wheel(wheelPos) : 0);
+void LambdaOff()
+{
+  stripLambda.setPixelColor(0, 0);
   stripLambda.show();
 }
 
@@ -130,9 +129,10 @@ void UpdateLcdIntensity()
   }
 }
 
-void UpdateLcdSin(int offset)
+void UpdateLcdSin()
 {
   static int oldOffset;
+  int offset = gravimetricCorrection;
   int yOffset = 68;
   ;
 
@@ -150,30 +150,25 @@ void UpdateLcdSin(int offset)
   oldOffset = offset;
 }
 
-void UpdateLockLed(bool trigger = false)
+// Automatic activity flashes the lock LED every second while the state is raised.
+void RestartLockLed()
 {
-  static flasher flasherFlash(Pattern::Sin, 1000, 255);
-  static msTimer timer(1000);
-  flasherFlash.repeat(false);
-
-  if (mode == automaticActivity)
+  if (mode == automaticActivity && (state == warning || state == critical))
   {
-    if (state == warning || state == critical)
-    {
-      if (timer.elapsed())
-      {
-        flasherFlash.setDelay(random(state == warning ? 1000 : 500, 1500));
-        flasherFlash.reset();
-      }
-    }
+    flasherLock.setDelay(random(state == warning ? 1000 : 500, 1500));
+    flasherLock.reset();
   }
+}
 
-  if (trigger)
+void UpdateLockLed()
+{
+  if (performActivityFlag)
   {
-    flasherFlash.reset();
+    performActivityFlag = false;
+    flasherLock.reset();
   }
 
-  analogWrite(PIN_LED_LOCK, flasherFlash.getPwmValue());
+  analogWrite(PIN_LED_LOCK, flasherLock.getPwmValue());
 }
 
 void CheckPot()
@@ -185,7 +180,10 @@ void CheckPot()
   {
     oldGravimetricCorrection = gravimetricCorrection;
     activityFlag = true;
+    PostEvent(dilithumPowerFrame, eventPot, gravimetricCorrection);
   }
+
+  SetPanelInputs(dilithumPowerFrame, 0, gravimetricCorrection);
 }
 
 void ShutdownPanel()
@@ -233,69 +231,86 @@ tft.fillScreen(ST77XX_BLACK);
   tft.drawLine(0, 109, tft.width() - 1, 109, color);
 }
 
-void setup(void)
+void PerformActivity(byte source, byte id, byte value)
 {
+  performActivityFlag = true;
+}
 
-  Serial.begin(BAUD_RATE);
-
-  pinMode(PIN_POT_CORRECTION, INPUT);
-  pinMode(PIN_LED_LOCK, OUTPUT);
-  pinMode(PIN_LED_POWER_ON, OUTPUT);
-
-  stripDc.begin();
-  stripDistribution.begin();
-  stripLambda.begin();
-
-  delay(500);
-
-  tft.init(135, 240);
+// Any other panel's pot flashes the lock LED.
+const eventHandler eventHandlers[] PROGMEM = {
+    {EVENT_ANY_SOURCE, eventPot, eventKindMask, PerformActivity}};
 
-  tft.setRotation(3);
-  
+void CueActivity(byte cue)
+{
+  performActivityFlag = true;
 }
 
-void loop()
-{
+// Sentience sweeps across the wall then flashes every panel, an abort flashes them together.
+const cueStep cueSteps[] PROGMEM = {
+    {cueSentience, 0, CueActivity},
+    {cueSentience, 1500, CueActivity},
+    {cueAbort, 0, CueActivity}};
 
+// The panel is held dark until it is booted, the display is redrawn once it is.
+void CheckBootup()
+{
   static bool setupTftFlag;
 
-  CheckControlData();
-
   if (IsPanelBootup(dilithumPowerFrame))
   {
-
     if (setupTftFlag)
     {
       setupTftFlag = false;
       SetupTft();
+      digitalWrite(PIN_LED_POWER_ON, HIGH);
     }
+  }
+  else
+  {
+    setupTftFlag = true;
+    ShutdownPanel();
+  }
+}
 
-    digitalWrite(PIN_LED_POWER_ON, HIGH);
+void setup(void)
+{
 
-    if (performActivityFlag)
-    {
-      performActivityFlag = false;
+  BeginControlData();
+  HostPanel(dilithumPowerFrame);
+  SetEventHandlers(eventHandlers, sizeof(eventHandlers) / sizeof(eventHandlers[0]));
+  SetCueSteps(cueSteps, sizeof(cueSteps) / sizeof(cueSteps[0]));
 
-      UpdateLockLed(true);
-    }
+  pinMode(PIN_POT_CORRECTION, INPUT);
+  pinMode(PIN_LED_LOCK, OUTPUT);
+  pinMode(PIN_LED_POWER_ON, OUTPUT);
 
-    CheckPot();
+  stripDc.begin();
+  stripDistribution.begin();
+  stripLambda.begin();
 
-    UpdateLockLed();
+  tft.init(135, 240);
 
-    UpdateLcdSin(gravimetricCorrection);
+  tft.setRotation(3);
 
-    UpdateLcdIntensity();
+  flasherLock.repeat(false);
+
+  AddTask(CheckBootup, TASK_FRAME_MS);
+  AddPanelTask(dilithumPowerFrame, CheckPot, TASK_FRAME_MS);
+  AddPanelTask(dilithumPowerFrame, UpdateLockLed, TASK_FRAME_MS);
+  AddPanelTask(dilithumPowerFrame, RestartLockLed, 1000, 1000);
+  AddPanelTask(dilithumPowerFrame, UpdateLcdSin, TASK_FRAME_MS);
+  AddPanelTask(dilithumPowerFrame, UpdateLcdIntensity, TASK_FRAME_MS);
+  AddPanelTask(dilithumPowerFrame, UpdateLcdText, TASK_FRAME_MS);
+  AddPanelTask(dilithumPowerFrame, UpdateStrips, TASK_FRAME_MS);
+  taskLambdaFlash = AddPanelTask(dilithumPowerFrame, LambdaFlash, 1000, 1000);
+  taskLambdaOff = AddTaskOnce(LambdaOff);
+}
 
-    UpdateLcdText();
+void loop()
+{
+  LatchFrameClock();
 
-    UpdateLambda();
+  CheckControlData();
 
-    UpdateStrips(gravimetricCorrection);
-  }
-  else
-  {
-    setupTftFlag = true;
-    ShutdownPanel();
-  }
-}
\ No newline at end of file
+  RunTasks();
+}
@@ -3,8 +3,11 @@
 #include "PCA9685.h"           // https://github.com/NachtRaveVL/PCA9685-Arduino
 #include <TM1637Display.h>     // https://github.com/avishorp/TM1637
 #include "common.h"            // Local libary.
-#include "msTimer.h"           // Local libary.
 #include "flasher.h"           // Local libary.
+#include "flasherBank.h"       // Local libary.
+#include "ringPixels.h"        // Local libary.
+#define TASK_MAX 14
+#include "taskScheduler.h"     // Local libary.
 
 #define PIN_STRIP_ISOLINEAR_MANAFOLD 13
 //#define PIN_STRIP_DYNAMIC_MULTIPLEX A1
@@ -30,11 +33,11 @@
 #define PIN_LED_DISPLAY_2_DIO 9
 #define PIN_LED_DISPLAY_3_DIO 11
 
-Adafruit_NeoPixel stripManifold = Adafruit_NeoPixel(3 + 3, PIN_STRIP_ISOLINEAR_MANAFOLD, NEO_GRB + NEO_KHZ800);
-//Adafruit_NeoPixel stripMultiplex = Adafruit_NeoPixel(3, PIN_STRIP_DYNAMIC_MULTIPLEX, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripGenerator = Adafruit_NeoPixel(3, PIN_STRIP_SYNAPTIC_GENERATOR, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripRadiation = Adafruit_NeoPixel(12, PIN_STRIP_RADIATION, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripGlyphs = Adafruit_NeoPixel(3, PIN_STRIP_GLYPH_INDICATOR, NEO_RGB + NEO_KHZ800);
+ringPixels stripManifold = ringPixels(3 + 3, PIN_STRIP_ISOLINEAR_MANAFOLD, NEO_GRB + NEO_KHZ800);
+//ringPixels stripMultiplex = ringPixels(3, PIN_STRIP_DYNAMIC_MULTIPLEX, NEO_GRB + NEO_KHZ800);
+ringPixels stripGenerator = ringPixels(3, PIN_STRIP_SYNAPTIC_GENERATOR, NEO_GRB + NEO_KHZ800);
+ringPixels stripRadiation = ringPixels(12, PIN_STRIP_RADIATION, NEO_GRB + NEO_KHZ800);
+ringPixels stripGlyphs = ringPixels(3, PIN_STRIP_GLYPH_INDICATOR, NEO_RGB + NEO_KHZ800);
 
 PCA9685 pwmController1;
 
@@ -42,7 +45,16 @@ TM1637Display ledDisplay1(PIN_LED_DISPLAY_1_CLK, PIN_LED_DISPLAY_1_DIO);
 TM1637Display ledDisplay2(PIN_LED_DISPLAY_2_CLK, PIN_LED_DISPLAY_2_DIO);
 TM1637Display ledDisplay3(PIN_LED_DISPLAY_3_CLK, PIN_LED_DISPLAY_3_DIO);
 
+TM1637Display *ledDisplays[3] = {&ledDisplay1, &ledDisplay2, &ledDisplay3};
+
 bool relayStates[4];
+bool inFlux[4];
+byte multiplexWheelPos = 0;
+
+byte taskLedDisplays[3];
+byte taskFlux;
+byte taskMultiplexWheel;
+byte taskSubspaceSwitches;
 
 bool DeMultiplex(int channel)
 {
@@ -56,13 +68,14 @@ bool DeMultiplex(int channel)
   return analogRead(PIN_DECORDER_SIG) < 100 ? false : true;
 }
 
-void UpdateSynapticGenerator(bool trigger = false)
+void UpdateSynapticGenerator()
 {
   static flasher flasherFlash(Pattern::Sin, 400, 255);
   flasherFlash.repeat(false);
 
-  if (trigger)
+  if (performActivityFlag)
   {
+    performActivityFlag = false;
     flasherFlash.reset();
   }
 
@@ -70,14 +83,12 @@ void UpdateSynapticGenerator(bool trigger = false)
   stripGenerator.show();
 }
 
-void UpdateLedDisplays()
+// Each display counts toward a random target, then rests a random time and picks another.
+// A change of state restarts every display from a new value.
+void StepLedDisplay(byte display)
 {
-  static msTimer timer1(1000);
-  static msTimer timer2(1000);
-  static msTimer timer3(1000);
   static states previousState;
-  static int value1, value2, value3;
-  static int target1, target2, target3;
+  static int values[3], targets[3], delays[3] = {1000, 1000, 1000};
 
   int minDelay = state == stable ? 250 : state == warning ? 60 : state == critical ? 7 : 0;
   int maxDelay = state == stable ? 450 : state == warning ? 160 : state == critical ? 20 : 0;
@@ -88,81 +99,80 @@ void UpdateLedDisplays()
   if (previousState != state)
   {
     previousState = state;
-    value1 = random(minRange, maxRange);
-    value2 = random(minRange, maxRange);
-    value3 = random(minRange, maxRange);
-    timer1.resetDelay();
-    timer2.resetDelay();
-    timer3.resetDelay();
-  }
-
-  if (timer1.elapsed())
-  {
-    if (value1 > (target1 - spread) && value1 < (target1 + spread))
-    {
-      target1 = random(minRange, maxRange);
-      timer1.setDelay(random(minDelay, maxDelay));
-    }
-    else
+    for (byte i = 0; i < 3; i++)
     {
-      if (value1 > target1)
-        value1 -= spread;
-      if (value1 < target1)
-        value1 += spread;
+      values[i] = random(minRange, maxRange);
+      ScheduleTask(taskLedDisplays[i], delays[i]);
     }
-    ledDisplay1.showNumberDecEx(value1);
+    return;
   }
 
-  if (timer2.elapsed())
+  int &value = values[display];
+  int &target = targets[display];
+
+  if (value > (target - spread) && value < (target + spread))
   {
-    if (value2 > (target2 - spread) && value2 < (target2 + spread))
-    {
-      target2 = random(minRange, maxRange);
-      timer2.setDelay(random(minDelay, maxDelay));
-    }
-    else
-    {
-      if (value2 > target2)
-        value2 -= spread;
-      if (value2 < target2)
-        value2 += spread;
-    }
-    ledDisplay2.showNumberDecEx(value2);
+    target = random(minRange, maxRange);
+    delays[display] = random(minDelay, maxDelay);
   }
-
-  if (timer3.elapsed())
+  else
   {
-    if (value3 > (target3 - spread) && value3 < (target3 + spread))
-    {
-      target3 = random(minRange, maxRange);
-      timer3.setDelay(random(minDelay, maxDelay));
-    }
-    else
-    {
-      if (value3 > target3)
-        value3 -= spread;
-      if (value3 < target3)
-        value3 += spread;
-    }
-    ledDisplay3.showNumberDecEx(value3);
+    if (value > target)
+      value -= spread;
+    if (value < target)
+      value += spread;
   }
+
+  ScheduleTask(taskLedDisplays[display], delays[display]);
+  ledDisplays[display]->showNumberDecEx(value);
+}
+
+void UpdateLedDisplay1()
+{
+  StepLedDisplay(0);
+}
+
+void UpdateLedDisplay2()
+{
+  StepLedDisplay(1);
+}
+
+void UpdateLedDisplay3()
+{
+  StepLedDisplay(2);
+}
+
+void SetRadiationPixel(byte index, byte r, byte g, byte b)
+{
+  stripRadiation.setPixelColor(index, r, g, b);
 }
 
 void UpdateRadiation()
 {
-  static flasher flashers[12];
+  static flasherBank<12> flashers;
+  static lockstepRandom stream(randomRadiation);
+
+  // A program pushed over the ring replaces the built in effect.
+  if (VmLoaded())
+  {
+    RunVm();
+    stripRadiation.show();
+    return;
+  }
 
   int delayRange = state == stable ? 3 : state == warning ? 2 : state == critical ? 1 : 0;
   Pattern pattern = state == stable ? Pattern::Sin : state == warning ? Pattern::OnOff : state == critical ? Pattern::Flash : Pattern::Flash;
 
+  flashers.update();
+
   for (int i = 0; i < 12; i++)
   {
-    int pwmValue = flashers[i].getPwmValue();
+    int pwmValue = flashers.value(i);
 
     if (pwmValue == 0)
     {
-      flashers[i].setPattern(pattern);
-      flashers[i].setDelay(random(500 * delayRange, 1000 * delayRange));
+      flashers.setPattern(i, pattern);
+      flashers.setDelay(i, stream.next(500 * delayRange, 1000 * delayRange));
     }
 
     uint32_t color;
@@ -179,21 +189,20 @@ void UpdateRadiation()
   stripRadiation.show();
 }
 
-void UpdatePWMs()
+// Tachyon Sensormatic Grid : System in Terminal Flux, picks new systems sooner as the state rises.
+void UpdateFlux()
 {
-  uint16_t pwms1[16];
-
-  // Tachyon Sensormatic Grid : System in Terminal Flux
+  static lockstepRandom stream(randomFlux);
   int systemsInFlux = state == stable ? 1 : state == warning ? 2 : state == critical ? 3 : 0;
   int fluxDelay = state == stable ? 5000 : state == warning ? 3000 : state == critical ? 1000 : 0;
 
-  static bool inFlux[4];
-  static msTimer timerFlux(1000);
-  if (timerFlux.elapsed())
-  {
-    timerFlux.setDelay(fluxDelay);
-    RandomArrayFill(inFlux, systemsInFlux, sizeof(inFlux));
-  }
+  ScheduleTask(taskFlux, fluxDelay);
+  RandomArrayFill(inFlux, systemsInFlux, sizeof(inFlux), &stream);
+}
+
+void UpdatePWMs()
+{
+  uint16_t pwms1[16];
 
   pwms1[0] = inFlux[0] ? maxPwmGenericLed : 0;
   pwms1[1] = inFlux[1] ? maxPwmGenericLed : 0;
@@ -284,41 +293,33 @@ void ToggleRelay(int relay)
   digitalWrite(PIN_RELAY_RIGHT_2, relayStates[3]);
 }
 
+// Subspace Synthesis, channels 11, 12, 13, 14, 15
+// A change toggles a relay, then the switches are left for 100 ms to debounce.
 void ProcessSubspaceSwitches()
 {
-  // Subspace Synthesis, channels 11, 12, 13, 14, 15
-  static msTimer timerDebounce(100);
-  static bool debounceFlag;
   static int oldSubspaceValue;
 
   int subspaceValue = DeMultiplex(11) + DeMultiplex(12) + DeMultiplex(13) + DeMultiplex(14) + DeMultiplex(15);
 
-  if (timerDebounce.elapsed())
-    debounceFlag = false;
-
-  if (oldSubspaceValue != subspaceValue && debounceFlag == false)
+  if (oldSubspaceValue != subspaceValue)
   {
     oldSubspaceValue = subspaceValue;
-
-    timerDebounce.resetDelay();
-    debounceFlag = true;
+    ScheduleTask(taskSubspaceSwitches, 100);
 
     ToggleRelay(random(0, 4));  
   }
 }
-void UpdateMultiplexIndicator()
-{
-  static msTimer timer(20);
-  static byte wheelPos = 0;
 
+// Turns the multiplex indicator's color wheel, faster as the state rises.
+void AdvanceMultiplexWheel()
+{
   int delay = state == stable ? 20 : state == warning ? 15 : state == critical ? 10 : 0;
-  timer.setDelay(delay);
-
-  if (timer.elapsed())
-  {
-    wheelPos++;
-  }
+  ScheduleTask(taskMultiplexWheel, delay);
+  multiplexWheelPos++;
+}
 
+void UpdateMultiplexIndicator()
+{
   int maxRand = state == stable ? 1000 : state == warning ? 90 : state == critical ? 35 : 0;
   static int hold = 0;
   if (state != stable && random(0, maxRand) == 0)
@@ -332,7 +333,7 @@ void UpdateMultiplexIndicator()
   }
   else
   {
-    stripManifold.fill(Wheel(wheelPos), 3, 3);
+    stripManifold.fill(Wheel(multiplexWheelPos), 3, 3);
   }
 
   stripManifold.show();
@@ -369,15 +370,24 @@ void CheckToggleActivity()
 {
   static int oldToggleSum;
   int toggleSum = 0;
+  byte toggleBits = 0;
   for (int i = 0; i < 16; i++)
   {
-    toggleSum += DeMultiplex(i);
+    bool toggle = DeMultiplex(i);
+    toggleSum += toggle;
+    if (i < 8 && toggle)
+    {
+      toggleBits |= 1 << i;
+    }
   }
   if (oldToggleSum != toggleSum)
   {
     oldToggleSum = toggleSum;
     activityFlag = true;
+    PostEvent(gndnPipelineRelay, eventToggle, toggleSum);
   }
+
+  SetPanelInputs(gndnPipelineRelay, toggleBits, toggleSum);
 }
 
 void ShutdownPanelSensormaticGrid()
@@ -413,9 +423,49 @@ void ShutdownPanelGndnPipelineRelay()
   stripGlyphs.show();
 }
 
+void PerformActivity(byte source, byte id, byte value)
+{
+  performActivityFlag = true;
+}
+
+// Any other panel's button pulses the synaptic generator.
+const eventHandler eventHandlers[] PROGMEM = {
+    {EVENT_ANY_SOURCE, eventButton, eventKindMask, PerformActivity}};
+
+void CueActivity(byte cue)
+{
+  performActivityFlag = true;
+}
+
+// Sentience sweeps across the wall then flashes every panel, an abort flashes them together.
+const cueStep cueSteps[] PROGMEM = {
+    {cueSentience, 200, CueActivity},
+    {cueSentience, 1500, CueActivity},
+    {cueAbort, 0, CueActivity}};
+
+// Each panel is held dark until it is booted.
+void CheckBootup()
+{
+  if (!IsPanelBootup(tachyonSensormaticGrid))
+  {
+    ShutdownPanelSensormaticGrid();
+  }
+
+  if (!IsPanelBootup(gndnPipelineRelay))
+  {
+    ShutdownPanelGndnPipelineRelay();
+  }
+}
+
 void setup()
 {
-  Serial.begin(BAUD_RATE);
+  BeginControlData();
+  HostPanel(gndnPipelineRelay);
+  HostPanel(tachyonSensormaticGrid);
+  SetEventHandlers(eventHandlers, sizeof(eventHandlers) / sizeof(eventHandlers[0]));
+  SetCueSteps(cueSteps, sizeof(cueSteps) / sizeof(cueSteps[0]));
+  BeginVm();
+  SetVmOutputs(SetRadiationPixel, NULL);
 
   pinMode(PIN_DECODER_S0, OUTPUT);
   pinMode(PIN_DECODER_S1, OUTPUT);
@@ -444,48 +494,31 @@ void setup()
   ledDisplay1.setBrightness(2);
   ledDisplay2.setBrightness(2);
   ledDisplay3.setBrightness(2);
+
+  // Lights on both panels, blanks those of a panel that is down.
+  AddTask(UpdatePWMs, TASK_FRAME_MS);
+  AddTask(CheckBootup, TASK_FRAME_MS);
+
+  taskFlux = AddPanelTask(tachyonSensormaticGrid, UpdateFlux, 1000, 1000);
+  AddPanelTask(tachyonSensormaticGrid, UpdateRadiation, TASK_FRAME_MS);
+  taskLedDisplays[0] = AddPanelTask(tachyonSensormaticGrid, UpdateLedDisplay1, 1000, 1000);
+  taskLedDisplays[1] = AddPanelTask(tachyonSensormaticGrid, UpdateLedDisplay2, 1000, 1000);
+  taskLedDisplays[2] = AddPanelTask(tachyonSensormaticGrid, UpdateLedDisplay3, 1000, 1000);
+
+  AddPanelTask(gndnPipelineRelay, UpdateSynapticGenerator, TASK_FRAME_MS);
+  taskSubspaceSwitches = AddPanelTask(gndnPipelineRelay, ProcessSubspaceSwitches, TASK_FRAME_MS);
+  taskMultiplexWheel = AddPanelTask(gndnPipelineRelay, AdvanceMultiplexWheel, 20, 20);
+  AddPanelTask(gndnPipelineRelay, UpdateMultiplexIndicator, TASK_FRAME_MS);
+  AddPanelTask(gndnPipelineRelay, UpdateManifoldIndicator, TASK_FRAME_MS);
+  AddPanelTask(gndnPipelineRelay, UpdateGlyphIndicators, TASK_FRAME_MS);
+  AddPanelTask(gndnPipelineRelay, CheckToggleActivity, TASK_FRAME_MS);
 }
 
 void loop()
 {
+  LatchFrameClock();
 
   CheckControlData();
 
-  UpdatePWMs();
-
-  if (IsPanelBootup(tachyonSensormaticGrid))
-  {
-    UpdateRadiation();
-
-    UpdateLedDisplays();
-  }
-  else
-  {
-    ShutdownPanelSensormaticGrid();
-  }
-
-  if (IsPanelBootup(gndnPipelineRelay))
-  {
-    if (performActivityFlag)
-    {
-      performActivityFlag = false;
-      UpdateSynapticGenerator(true);
-    }
-
-    ProcessSubspaceSwitches();
-
-    UpdateMultiplexIndicator();
-
-    UpdateManifoldIndicator();
-
-    UpdateGlyphIndicators();
-
-    UpdateSynapticGenerator();
-
-    CheckToggleActivity();
-  }
-  else
-  {
-    ShutdownPanelGndnPipelineRelay();
-  }
-}
\ No newline at end of file
+  RunTasks();
+}
@@ -4,8 +4,11 @@
 #include <TM1637Display.h>     // https://github.com/avishorp/TM1637
 #include <JC_Button.h>         // https://github.com/JChristensen/JC_Button
 #include "common.h"            // Local libary.
-#include "msTimer.h"           // Local libary.
 #include "flasher.h"           // Local libary.
+#include "flasherBank.h"       // Local libary.
+#include "ringPixels.h"        // Local libary.
+#define TASK_MAX 17
+#include "taskScheduler.h"     // Local libary.
 
 #define PIN_STRIP_SPORATION_CHAMBER 5
 #define PIN_STRIP_STATE_INDICATORS A0
@@ -23,12 +26,12 @@
 #define PIN_BUTTON_MONO 2
 #define PIN_STRIP_BACKGROUND 4
 
-Adafruit_NeoPixel stripChamber = Adafruit_NeoPixel(7, PIN_STRIP_SPORATION_CHAMBER, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripGlyph = Adafruit_NeoPixel(25, PIN_STRIP_GLYPH_INDICATORS, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripStates = Adafruit_NeoPixel(15, PIN_STRIP_STATE_INDICATORS, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripWarning1 = Adafruit_NeoPixel(9, PIN_STRIP_WARNING_1_INDICATOR, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripWarning2 = Adafruit_NeoPixel(9, PIN_STRIP_WARNING_2_INDICATOR, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripBackground = Adafruit_NeoPixel(22, PIN_STRIP_BACKGROUND, NEO_GRB + NEO_KHZ800);
+ringPixels stripChamber = ringPixels(7, PIN_STRIP_SPORATION_CHAMBER, NEO_GRB + NEO_KHZ800);
+ringPixels stripGlyph = ringPixels(25, PIN_STRIP_GLYPH_INDICATORS, NEO_GRB + NEO_KHZ800);
+ringPixels stripStates = ringPixels(15, PIN_STRIP_STATE_INDICATORS, NEO_GRB + NEO_KHZ800);
+ringPixels stripWarning1 = ringPixels(9, PIN_STRIP_WARNING_1_INDICATOR, NEO_GRB + NEO_KHZ800);
+ringPixels stripWarning2 = ringPixels(9, PIN_STRIP_WARNING_2_INDICATOR, NEO_GRB + NEO_KHZ800);
+ringPixels stripBackground = ringPixels(22, PIN_STRIP_BACKGROUND, NEO_GRB + NEO_KHZ800);
 
 PCA9685 pwmController1;
 PCA9685 pwmController2;
@@ -38,10 +41,21 @@ Button buttonMono(PIN_BUTTON_MONO);
 
 bool genesisFlag;
 int fxOffset;
-bool performMaxIntensityFlag = false;
 bool performUpdateWarningsFlag = false;
-bool glyphStartup = true;
-bool warningStartup = true;
+
+flasherBank<6> flasherWarnings;
+bool nodeStates[15];
+int targetIntensity;
+int currentIntensity;
+byte chamberWheelPos;
+int blackoutPixel;
+
+byte taskGlyphs;
+byte taskWarnings;
+byte taskChamberWheel;
+byte taskIntensity;
+byte taskGenesis;
+byte taskSpread;
 
 enum SeedState
 {
@@ -66,54 +80,46 @@ const signed int nodeMap[15][4] = {{1, -1, -1, -1},
                                    {7, -1, -1, -1},
                                    {11, -1, -1, -1}};
 
+// Lights a new random set of glyphs, sooner as the state rises.
 void UpdateGlyphIndicator()
 {
-  static msTimer timer(1000);
   static bool activeGlyphs[25];
   
   int delay = state == stable ? 2000 : state == warning ? 1250 : state == critical ? 500 : 0;
-  timer.setDelay(delay);
-
-  if (glyphStartup)
-  {
-    glyphStartup = false;
-    timer.ForceTrigger();
-  }
+  ScheduleTask(taskGlyphs, delay);
 
-  if (timer.elapsed())
-  {
-    int fillAmount = state == stable ? 10 : state == warning ? 15 : state == critical ? 20 : 0;
+  int fillAmount = state == stable ? 10 : state == warning ? 15 : state == critical ? 20 : 0;
 
-    RandomArrayFill(activeGlyphs, fillAmount, sizeof(activeGlyphs));
+  RandomArrayFill(activeGlyphs, fillAmount, sizeof(activeGlyphs));
 
-    for (int i = 0; i < (int)stripGlyph.numPixels(); i++)
+  for (int i = 0; i < (int)stripGlyph.numPixels(); i++)
+  {
+    uint32_t color;
+    if (state == critical)
     {
-      uint32_t color;
-      if (state == critical)
-      {
-        color = Wheel(random(0, 255));
-      }
-      else
-      {
-        int r = random(0, 3);
-        color = r == 0 ? 0x00FF0000 : r == 1 ? 0x000000FF : r == 2 ? 0x00FF00 : 0;
-      }
-
-      if (activeGlyphs[i])
-        stripGlyph.setPixelColor(i, color);
-      else
-        stripGlyph.setPixelColor(i, 0);
+      color = Wheel(random(0, 255));
     }
-    stripGlyph.show();
+    else
+    {
+      int r = random(0, 3);
+      color = r == 0 ? 0x00FF0000 : r == 1 ? 0x000000FF : r == 2 ? 0x00FF00 : 0;
+    }
+
+    if (activeGlyphs[i])
+      stripGlyph.setPixelColor(i, color);
+    else
+      stripGlyph.setPixelColor(i, 0);
   }
+  stripGlyph.show();
 }
 
 void UpdateStateIndicators()
 {
   static flasher flasher(Pattern::Sin, 1000, 255);
+  flasher.tick(FrameMicros());
 
   int fillStart = state == stable ? 0 : state == warning ? 1 : state == critical ? 2 : 0;
-  uint32_t color = state == stable ? Color(0, flasher.getPwmValue(), 0) : state == warning ? Color(flasher.getPwmValue() / 2, flasher.getPwmValue() / 2.2, 0) : state == critical ? Color(flasher.getPwmValue(), 0, 0) : 0;
+  uint32_t color = state == stable ? Color(0, flasher.value(), 0) : state == warning ? Color(flasher.value() / 2, flasher.value() / 2.2, 0) : state == critical ? Color(RingSinPwm(1000, 255), 0, 0) : 0;
   Pattern pattern = state == stable ? Pattern::Solid : state == warning ? Pattern::RandomReverseFlash : state == critical ? Pattern::Sin : Pattern::Solid;
 
   flasher.setPattern(pattern);
@@ -122,94 +128,93 @@ void UpdateStateIndicators()
   stripStates.show();
 }
 
-void UpdateWarningIndicators()
+// Picks the warnings that flash, again after a time shorter as the state rises.
+// Activity on the wall raises more of them.
+void PickWarnings()
 {
   static bool warnings[6];
-  static flasher flasherWarnings[6];
-  static msTimer timerWarning(0);
-  static states oldState;
 
   int delayTimer = state == stable ? 5000 : state == warning ? 3000 : state == critical ? 2000 : 0;
   int delayFlash = state == stable ? 1000 : state == warning ? 750 : state == critical ? 500 : 0;
 
-  if (oldState != state)
-  {
-    oldState = state;
-    timerWarning.ForceTrigger();
-  }
+  ScheduleTask(taskWarnings, delayTimer);
+
+  int minWarnings = state == stable ? 0 : state == warning ? 1 : state == critical ? 2 : 0;
+  int maxWarnings = state == stable ? 1 : state == warning ? 3 : state == critical ? 5 : 0;
+  int numWarnings = 0;
 
-  if (warningStartup)
+  if (performUpdateWarningsFlag)
   {
-    warningStartup = false;
-    timerWarning.ForceTrigger();
+    performUpdateWarningsFlag = false;
+    numWarnings = random(minWarnings + 1, maxWarnings + 2);
   }
-
-  if (timerWarning.elapsed() || performUpdateWarningsFlag)
+  else
   {
-    timerWarning.setDelay(delayTimer);
+    numWarnings = random(minWarnings, maxWarnings + 1);
+  }
 
-    int minWarnings = state == stable ? 0 : state == warning ? 1 : state == critical ? 2 : 0;
-    int maxWarnings = state == stable ? 1 : state == warning ? 3 : state == critical ? 5 : 0;
-    int numWarnings = 0;
+  RandomArrayFill(warnings, numWarnings, sizeof(warnings));
 
-    if (performUpdateWarningsFlag)
-    {
-      performUpdateWarningsFlag = false;
-      timerWarning.resetDelay();
-      numWarnings = random(minWarnings + 1, maxWarnings + 2);
-    }
-    else
-    {
-      numWarnings = random(minWarnings, maxWarnings + 1);
-    }
+  for (int i = 0; i < 6; i++)
+  {
+    flasherWarnings.setPattern(i, Pattern::Sin);
+    flasherWarnings.setDelay(i, delayFlash + random(0, 100));
+    flasherWarnings.repeat(i, warnings[i]);
+  }
+}
 
-    RandomArrayFill(warnings, numWarnings, sizeof(warnings));
+void UpdateWarningIndicators()
+{
+  static states oldState;
 
-    for (int i = 0; i < 6; i++)
-    {
-      flasherWarnings[i].setPattern(Pattern::Sin);
-      flasherWarnings[i].setDelay(delayFlash + random(0, 100));
-      flasherWarnings[i].repeat(warnings[i]);
-    }
+  // A change of state or activity picks new warnings at once.
+  if (oldState != state || performUpdateWarningsFlag)
+  {
+    oldState = state;
+    ScheduleTask(taskWarnings, 0);
   }
 
-  stripWarning1.fill(Color(flasherWarnings[0].getPwmValue(), 0, 0), 0, 3);
-  stripWarning1.fill(Color(flasherWarnings[1].getPwmValue(), 0, 0), 3, 3);
-  stripWarning1.fill(Color(flasherWarnings[2].getPwmValue(), 0, 0), 6, 3);
-  stripWarning2.fill(Color(flasherWarnings[3].getPwmValue(), 0, 0), 0, 3);
-  stripWarning2.fill(Color(flasherWarnings[4].getPwmValue(), 0, 0), 3, 3);
-  stripWarning2.fill(Color(flasherWarnings[5].getPwmValue(), 0, 0), 6, 3);
+  flasherWarnings.update();
+  stripWarning1.fill(Color(flasherWarnings.value(0), 0, 0), 0, 3);
+  stripWarning1.fill(Color(flasherWarnings.value(1), 0, 0), 3, 3);
+  stripWarning1.fill(Color(flasherWarnings.value(2), 0, 0), 6, 3);
+  stripWarning2.fill(Color(flasherWarnings.value(3), 0, 0), 0, 3);
+  stripWarning2.fill(Color(flasherWarnings.value(4), 0, 0), 3, 3);
+  stripWarning2.fill(Color(flasherWarnings.value(5), 0, 0), 6, 3);
   stripWarning1.show();
   stripWarning2.show();
 }
 
-void UpdateChamber()
+// Turns the chamber's color wheel, fast while the decay toggle is on.
+void AdvanceChamberWheel()
 {
-  static msTimer timer(20);
-  static byte wheelPos;
-
   int delay = !digitalRead(PIN_TOGGLE_DECAY) ? 2 : 20;
-  timer.setDelay(delay);
+  ScheduleTask(taskChamberWheel, delay);
 
-  if (timer.elapsed())
+  chamberWheelPos++;
+  if (seedState == poly)
   {
-    wheelPos++;
-    if (seedState == poly)
+    for (int i = 0; i < (int)stripChamber.numPixels(); i++)
     {
-      for (int i = 0; i < (int)stripChamber.numPixels(); i++)
-      {
-        stripChamber.setPixelColor(i, Wheel(((i * 256 / stripChamber.numPixels()) + wheelPos) & 255));
-      }
+      stripChamber.setPixelColor(i, Wheel(((i * 256 / stripChamber.numPixels()) + chamberWheelPos) & 255));
     }
-    else if (seedState == mono)
+  }
+  else if (seedState == mono)
+  {
+    for (int i = 0; i < (int)stripChamber.numPixels(); i++)
     {
-      for (int i = 0; i < (int)stripChamber.numPixels(); i++)
-      {
-        stripChamber.setPixelColor(i, Wheel(wheelPos));
-      }
+      stripChamber.setPixelColor(i, Wheel(chamberWheelPos));
     }
   }
+}
+
+void PickBlackoutPixel()
+{
+  blackoutPixel = random(0, stripChamber.numPixels());
+}
 
+void UpdateChamber()
+{
   static flasher flasherBrightness(Pattern::Sin, 1500, 200);
 
   if (!digitalRead(PIN_TOGGLE_PULSE))
@@ -221,14 +226,8 @@ void UpdateChamber()
     stripChamber.setBrightness(255);
   }
 
-  static msTimer timerAsync(1000);
-  static int blackoutPixel;
   if (!digitalRead(PIN_TOGGLE_ASYNC))
   {
-    if (timerAsync.elapsed())
-    {
-      blackoutPixel = random(0, stripChamber.numPixels());
-    }
     stripChamber.setPixelColor(blackoutPixel, 0);
   }
 
@@ -238,47 +237,39 @@ void UpdateChamber()
 void UpdateCloudBank9Background()
 {
   static flasher flasherBackground(Pattern::Sin, 3000, 200);
-  uint32_t color = state == stable ? Color(0, 255 - flasherBackground.getPwmValue(), 0) : state == warning ? Color(127 - flasherBackground.getPwmValue() / 2, 127 - flasherBackground.getPwmValue() / 2.2, 0) : state == critical ? Color(255 - flasherBackground.getPwmValue(), 0, 0) : 0;
-  //uint32_t color = Color(0, 255 - flasherBackground.getPwmValue(), 0);
+  flasherBackground.tick(FrameMicros());
+  uint32_t color = state == stable ? Color(0, 255 - flasherBackground.value(), 0) : state == warning ? Color(127 - flasherBackground.value() / 2, 127 - flasherBackground.value() / 2.2, 0) : state == critical ? Color(255 - flasherBackground.value(), 0, 0) : 0;
+  //uint32_t color = Color(0, 255 - flasherBackground.value(), 0);
 
   stripBackground.setBrightness(65);
   stripBackground.fill(color, 0, stripBackground.numPixels());
   stripBackground.show();
 }
 
-void UpdatePWMs()
+// Steps the LED segment bar toward its target intensity.
+void StepIntensity()
 {
-  uint16_t pwms1[16];
-
-  // Update LED segment bar.
-  static msTimer timerIntensity(250);
-  static int targetIntensity;
-  static int currentIntensity;
   int minIntensity = state == stable ? 0 : state == warning ? 3 : state == critical ? 6 : 0;
   int maxIntensity = state == stable ? 6 : state == warning ? 8 : state == critical ? 10 : 0;
 
-  if (performMaxIntensityFlag)
+  if (currentIntensity == targetIntensity)
   {
-    performMaxIntensityFlag = false;
-    targetIntensity = 9;
-    timerIntensity.resetDelay();
+    targetIntensity = random(minIntensity, maxIntensity);
   }
-
-  if (timerIntensity.elapsed())
+  else
   {
-    if (currentIntensity == targetIntensity)
-    {
-      targetIntensity = random(minIntensity, maxIntensity);
-    }
-    else
-    {
-      if (currentIntensity < targetIntensity)
-        currentIntensity++;
-      if (currentIntensity > targetIntensity)
-        currentIntensity--;
-    }
+    if (currentIntensity < targetIntensity)
+      currentIntensity++;
+    if (currentIntensity > targetIntensity)
+      currentIntensity--;
   }
+}
+
+void UpdatePWMs()
+{
+  uint16_t pwms1[16];
 
+  // Update LED segment bar.
   pwms1[6] = 0 >= (9 - currentIntensity) ? 1500 : 0;
   pwms1[7] = 1 >= (9 - currentIntensity) ? 1500 : 0;
   pwms1[8] = 2 >= (9 - currentIntensity) ? 4095 : 0;
@@ -307,99 +298,107 @@ void UpdatePWMs()
   pwmController1.setChannelsPWM(0, 16, pwms1);
 }
 
-void UpdateCloudBank9()
+// Resets the nodes and seeds them, flashing the genesis button.
+void Genesis()
 {
-  static msTimer timerNode(3000);
-  static msTimer timerGenesis(1000);
-  static bool nodeStates[15];
-  uint16_t pwms2[16];
-  bool nodeStatesUpdates[15];
-  int delayGenesis = state == stable ? 20000 : state == warning ? 15000 : state == critical ? 10000 : 10000;
-  int delaySpread = state == stable ? 3000 : state == warning ? 2000 : state == critical ? 1000 : 10000;
-  timerNode.setDelay(delaySpread);
-
-  buttonPoly.read();
-  buttonMono.read();
+  genesisFlag = true;
 
-  if (buttonPoly.wasPressed())
+  for (int i = 0; i < 15; i++)
   {
-    seedState = poly;
-    genesisFlag = true;
-    activityFlag = true;
+    nodeStates[i] = false;
   }
-
-  if (buttonMono.wasPressed())
+  if (seedState == poly)
   {
-    seedState = mono;
-    genesisFlag = true;
-    activityFlag = true;
+    int selection1[4] = {0, 1, 3, 12};
+    nodeStates[selection1[random(0, 4)]] = true;
+    int selection2[4] = {9, 10, 8, 2};
+    nodeStates[selection2[random(0, 4)]] = true;
   }
-
-  // Start genesis on a timer.
-  if (timerGenesis.elapsed())
+  else if (seedState == mono)
   {
-    timerGenesis.setDelay(delayGenesis);
-    genesisFlag = true;
+    nodeStates[random(0, 16)] = true;
   }
+}
 
-  // Reset nodes and seed genesis.
-  if (genesisFlag)
-  {
-    for (int i = 0; i < 15; i++)
-    {
-      nodeStates[i] = false;
-    }
-    if (seedState == poly)
-    {
-      int selection1[4] = {0, 1, 3, 12};
-      nodeStates[selection1[random(0, 4)]] = true;
-      int selection2[4] = {9, 10, 8, 2};
-      nodeStates[selection2[random(0, 4)]] = true;
-    }
-    else if (seedState == mono)
-    {
-      nodeStates[random(0, 16)] = true;
-    }
-  }
+// Start genesis on a timer.
+void StartGenesis()
+{
+  ScheduleTask(taskGenesis, Param(paramCloudGenesis + state));
+  Genesis();
+}
+
+// Activate adjacent nodes of active nodes.
+void SpreadNodes()
+{
+  bool nodeStatesUpdates[15];
+
+  ScheduleTask(taskSpread, Param(paramCloudSpread + state));
 
   for (int i = 0; i < 15; i++)
   {
     nodeStatesUpdates[i] = false;
   }
 
-  // Activate adjacent nodes of active nodes.
-  if (timerNode.elapsed())
+  for (int i = 0; i < 15; i++)
   {
-    for (int i = 0; i < 15; i++)
+    if (nodeStates[i])
     {
-      if (nodeStates[i])
+      for (int j = 0; j < 4; j++)
       {
-        for (int j = 0; j < 4; j++)
+        if (nodeMap[i][j] != -1)
         {
-          if (nodeMap[i][j] != -1)
-          {
-            nodeStatesUpdates[nodeMap[i][j]] = true;
-          }
+          nodeStatesUpdates[nodeMap[i][j]] = true;
         }
       }
     }
+  }
 
-    for (int i = 0; i < 15; i++)
+  for (int i = 0; i < 15; i++)
+  {
+    if (nodeStatesUpdates[i])
     {
-      if (nodeStatesUpdates[i])
-      {
-        nodeStates[i] = true;
-      }
+      nodeStates[i] = true;
     }
   }
+}
+
+void CheckSeedButtons()
+{
+  buttonPoly.read();
+  buttonMono.read();
+
+  if (buttonPoly.wasPressed())
+  {
+    seedState = poly;
+    Genesis();
+    activityFlag = true;
+    PostEvent(metaphasicSporation, eventButton, 0);
+  }
+
+  if (buttonMono.wasPressed())
+  {
+    seedState = mono;
+    Genesis();
+    activityFlag = true;
+    PostEvent(metaphasicSporation, eventButton + 1, 0);
+  }
+}
 
-  static flasher flasherNodes[15];
+void UpdateCloudBank9()
+{
+  static flasherBank<15> flasherNodes;
+  uint16_t pwms2[16];
   Pattern pattern = fxOffset == 0 ? Pattern::Sin : fxOffset == 1 ? Pattern::RampUp : fxOffset == 2 ? Pattern::OnOff : fxOffset == 3 ? Pattern::RandomFlash : Pattern::Sin;
 
+  flasherNodes.setPattern(pattern);
+  flasherNodes.update(pwms2);
+
   for (int i = 0; i < 15; i++)
   {
-    flasherNodes[i].setPattern(pattern);
-    pwms2[i] = nodeStates[i] ? flasherNodes[i].getPwmValue() : 0;
+    if (!nodeStates[i])
+    {
+      pwms2[i] = 0;
+    }
   }
 
   pwmController2.setChannelsPWM(0, 16, pwms2);
@@ -414,6 +413,7 @@ void CheckFxOffset()
   {
     oldFxOffset = fxOffset;
     activityFlag = true;
+    PostEvent(metaphasicSporation, eventPot, fxOffset);
   }
 }
 
@@ -422,6 +422,15 @@ void CheckActivity()
   // FxOffset checked elsewhere.
   // Poly-Seed and Mono-Seed buttons checked elsewhere.
 
+  // Activity elsewhere on the wall drives the bar to maximum and raises warnings.
+  if (performActivityFlag)
+  {
+    performActivityFlag = false;
+    performUpdateWarningsFlag = true;
+    targetIntensity = 9;
+    ScheduleTask(taskIntensity, 250);
+  }
+
   static int oldToggleValue;
   int toggleValue = digitalRead(PIN_TOGGLE_ASYNC) + digitalRead(PIN_TOGGLE_PULSE) + digitalRead(PIN_TOGGLE_DECAY);
 
@@ -429,16 +438,16 @@ void CheckActivity()
   {
     oldToggleValue = toggleValue;
     activityFlag = true;
+    PostEvent(metaphasicSporation, eventToggle, toggleValue);
   }
+
+  byte inputs = digitalRead(PIN_TOGGLE_ASYNC) | (digitalRead(PIN_TOGGLE_PULSE) << 1) | (digitalRead(PIN_TOGGLE_DECAY) << 2) | ((seedState == mono) << 3);
+  SetPanelInputs(metaphasicSporation, inputs, fxOffset);
 }
 
 void ShutdownPanelSystemStatus()
 {
-
-glyphStartup = true;
-warningStartup = true;
-
-stripStates.fill(0, 0, stripStates.numPixels());
+  stripStates.fill(0, 0, stripStates.numPixels());
   stripStates.show();
 
   stripWarning1.fill(0, 0, stripWarning1.numPixels());
@@ -468,9 +477,56 @@ void ShutdownPanelMetaphasicSportation()
   pwmController2.setChannelsPWM(0, 16, pwms1);
 }
 
+void PerformActivity(byte source, byte id, byte value)
+{
+  performActivityFlag = true;
+}
+
+// Any other panel's toggle drives the chamber to maximum intensity.
+const eventHandler eventHandlers[] PROGMEM = {
+    {EVENT_ANY_SOURCE, eventToggle, eventKindMask, PerformActivity}};
+
+void CueActivity(byte cue)
+{
+  performActivityFlag = true;
+}
+
+// Sentience sweeps across the wall then flashes every panel, an abort flashes them together.
+const cueStep cueSteps[] PROGMEM = {
+    {cueSentience, 400, CueActivity},
+    {cueSentience, 1500, CueActivity},
+    {cueAbort, 0, CueActivity}};
+
+// Each panel is held dark until it is booted, the status panel picks new glyphs and warnings as it lights.
+void CheckBootup()
+{
+  static bool systemStatusDown = true;
+
+  if (!IsPanelBootup(realTimeSystemStatus))
+  {
+    systemStatusDown = true;
+    ShutdownPanelSystemStatus();
+  }
+  else if (systemStatusDown)
+  {
+    systemStatusDown = false;
+    ScheduleTask(taskGlyphs, 0);
+    ScheduleTask(taskWarnings, 0);
+  }
+
+  if (!IsPanelBootup(metaphasicSporation))
+  {
+    ShutdownPanelMetaphasicSportation();
+  }
+}
+
 void setup()
 {
-  Serial.begin(BAUD_RATE);
+  BeginControlData();
+  HostPanel(metaphasicSporation);
+  HostPanel(realTimeSystemStatus);
+  SetEventHandlers(eventHandlers, sizeof(eventHandlers) / sizeof(eventHandlers[0]));
+  SetCueSteps(cueSteps, sizeof(cueSteps) / sizeof(cueSteps[0]));
 
   pinMode(PIN_OFFSET_0, INPUT);
   pinMode(PIN_OFFSET_1, INPUT);
@@ -504,50 +560,33 @@ void setup()
 
   buttonPoly.begin();
   buttonMono.begin();
+
+  AddTask(CheckBootup, TASK_FRAME_MS);
+
+  taskGlyphs = AddPanelTask(realTimeSystemStatus, UpdateGlyphIndicator, 1000);
+  AddPanelTask(realTimeSystemStatus, UpdateStateIndicators, TASK_FRAME_MS);
+  taskWarnings = AddPanelTask(realTimeSystemStatus, PickWarnings, 1000);
+  AddPanelTask(realTimeSystemStatus, UpdateWarningIndicators, TASK_FRAME_MS);
+
+  taskChamberWheel = AddPanelTask(metaphasicSporation, AdvanceChamberWheel, 20, 20);
+  AddPanelTask(metaphasicSporation, PickBlackoutPixel, 1000, 1000);
+  AddPanelTask(metaphasicSporation, UpdateChamber, TASK_FRAME_MS);
+  taskIntensity = AddPanelTask(metaphasicSporation, StepIntensity, 250, 250);
+  AddPanelTask(metaphasicSporation, UpdatePWMs, TASK_FRAME_MS);
+  AddPanelTask(metaphasicSporation, CheckSeedButtons, TASK_FRAME_MS);
+  taskGenesis = AddPanelTask(metaphasicSporation, StartGenesis, 1000, 1000);
+  taskSpread = AddPanelTask(metaphasicSporation, SpreadNodes, 1000, 1000);
+  AddPanelTask(metaphasicSporation, UpdateCloudBank9, TASK_FRAME_MS);
+  AddPanelTask(metaphasicSporation, UpdateCloudBank9Background, TASK_FRAME_MS);
+  AddPanelTask(metaphasicSporation, CheckFxOffset, TASK_FRAME_MS);
+  AddPanelTask(metaphasicSporation, CheckActivity, TASK_FRAME_MS);
 }
 
 void loop()
 {
+  LatchFrameClock();
 
   CheckControlData();
 
-  if (IsPanelBootup(realTimeSystemStatus))
-  {
-    UpdateGlyphIndicator();
-
-    UpdateStateIndicators();
-
-    UpdateWarningIndicators();
-  }
-  else
-  {
-    ShutdownPanelSystemStatus();
-  }
-
-  if (IsPanelBootup(metaphasicSporation))
-  {
-
-    if (performActivityFlag)
-    {
-      performActivityFlag = false;
-      performMaxIntensityFlag = true;
-      performUpdateWarningsFlag = true;
-    }
-
-    UpdateChamber();
-
-    UpdatePWMs();
-
-    UpdateCloudBank9();
-
-    UpdateCloudBank9Background();
-
-    CheckFxOffset();
-
-    CheckActivity();
-  }
-  else
-  {
-    ShutdownPanelMetaphasicSportation();
-  }
-}
\ No newline at end of file
+  RunTasks();
+}
@@ -0,0 +1,28 @@
+// vmPrograms
+//
+// Generated by tools/vmasm.py from off.vma, sweep.vma, pulse.vma, do not edit.
+
+#ifndef VM_PROGRAMS_H
+#define VM_PROGRAMS_H
+
+#include <Arduino.h>
+
+const byte vmOff[] PROGMEM = {
+    0x00
+};
+
+const byte vmSweep[] PROGMEM = {
+    0x02, 0x60, 0x09, 0x13, 0x01, 0x0B, 0x09, 0x0A, 0x08, 0x04, 0x01, 0x01,
+    0x00, 0x04, 0x00, 0x03, 0x00, 0x05, 0x03, 0x01, 0x0F, 0x02, 0xFF, 0x00,
+    0x09, 0x01, 0x00, 0x01, 0x00, 0x1A, 0x03, 0x00, 0x01, 0x01, 0x07, 0x05,
+    0x04, 0x00, 0x01, 0x0C, 0x0F, 0x11, 0xE4, 0x00
+};
+
+const byte vmPulse[] PROGMEM = {
+    0x02, 0xA0, 0x0F, 0x17, 0x02, 0xE8, 0x03, 0x09, 0x08, 0x14, 0x04, 0x01,
+    0x01, 0x00, 0x04, 0x00, 0x03, 0x00, 0x01, 0x00, 0x03, 0x01, 0x03, 0x01,
+    0x1A, 0x03, 0x00, 0x01, 0x01, 0x07, 0x05, 0x04, 0x00, 0x01, 0x0C, 0x0F,
+    0x11, 0xEA, 0x00
+};
+
+#endif
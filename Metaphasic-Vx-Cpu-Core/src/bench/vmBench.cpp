@@ -0,0 +1,76 @@
+// vmBench
+//
+// Ring VM throughput on a board, see ringVm.h. Built by the vmbench env in
+// place of the panel, it prints over the ring port at 57600 baud:
+//   pio run -e vmbench -t upload -t monitor
+// The op mix of vm/bench.vma is timed for ops per ms, the effects in vm/
+// for the time of one run. Timer0's interrupt runs throughout, so figures
+// are a little under the interpreter's own.
+//
+// Version 1.0
+
+#include <Arduino.h>
+#include <common.h>
+#include "vmBench.h"
+#include "vmPrograms.h"
+
+#define BENCH_RUNS 200
+
+// Ops in one run of vmBench, see bench.vma, counted by the native test_vm.
+#define BENCH_OPS 683UL
+
+// Scripted effects should not cost frame rate against hand written Update*() functions.
+#define BENCH_TARGET_OPS_PER_MS 1000
+
+void Print(const char *text)
+{
+  while (*text)
+  {
+    RingSerialWrite(*text++);
+  }
+}
+
+void Print(unsigned long value)
+{
+  char text[11];
+  Print(ultoa(value, text, 10));
+}
+
+// Microseconds for BENCH_RUNS runs, the first run after loading threads the program and is left out.
+unsigned long TimeRuns(const byte *program, byte size)
+{
+  LoadVmProgram(program, size);
+  RunVm();
+
+  unsigned long start = micros();
+  for (int i = 0; i < BENCH_RUNS; i++)
+  {
+    RunVm();
+  }
+  return micros() - start;
+}
+
+void setup()
+{
+  RingSerialBegin(BAUD_RATE, false);
+  BeginVm();
+
+  unsigned long elapsed = TimeRuns(vmBench, sizeof(vmBench));
+  unsigned long opsPerMs = BENCH_OPS * BENCH_RUNS * 1000 / elapsed;
+
+  Print("vm ops/ms ");
+  Print(opsPerMs);
+  Print(", cycles/op ");
+  Print(elapsed * (F_CPU / 1000000) / (BENCH_OPS * BENCH_RUNS));
+  Print(opsPerMs >= BENCH_TARGET_OPS_PER_MS ? ", pass\r\n" : ", FAIL\r\n");
+
+  Print("sweep us/run ");
+  Print(TimeRuns(vmSweep, sizeof(vmSweep)) / BENCH_RUNS);
+  Print("\r\npulse us/run ");
+  Print(TimeRuns(vmPulse, sizeof(vmPulse)) / BENCH_RUNS);
+  Print("\r\n");
+}
+
+void loop()
+{
+}
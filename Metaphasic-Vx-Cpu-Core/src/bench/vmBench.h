@@ -0,0 +1,16 @@
+// vmBench
+//
+// Generated by tools/vmasm.py from bench.vma, do not edit.
+
+#ifndef VM_BENCH_H
+#define VM_BENCH_H
+
+#include <Arduino.h>
+
+const byte vmBench[] PROGMEM = {
+    0x01, 0x28, 0x04, 0x00, 0x03, 0x01, 0x01, 0x03, 0x09, 0x0A, 0x02, 0x02,
+    0xE8, 0x03, 0x0C, 0x03, 0x00, 0x07, 0x04, 0x01, 0x03, 0x00, 0x01, 0xFF,
+    0x07, 0x05, 0x04, 0x00, 0x01, 0x00, 0x0F, 0x11, 0xE3, 0x00
+};
+
+#endif
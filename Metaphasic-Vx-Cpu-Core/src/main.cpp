@@ -14,6 +14,10 @@
 #include <common.h>            // Local libary.
 #include <msTimer.h>           // Local libary.
 #include <flasher.h>           // Local libary.
+#include <ringPixels.h>        // Local libary.
+#define TASK_MAX 18
+#include <taskScheduler.h>     // Local libary.
+#include "vmPrograms.h"        // Assembled from vm/ by tools/vmasm.py.
 
 #define PIN_MATRIX_DATAIN 4
 #define PIN_MATRIX_LOAD 3
@@ -29,7 +33,7 @@
 // data, clk, load, number of matrix
 LedControl lc = LedControl(PIN_MATRIX_DATAIN, PIN_MATRIX_CLK, PIN_MATRIX_LOAD, 3);
 
-Adafruit_NeoPixel stripSentienceDetected = Adafruit_NeoPixel(3, PIN_STRIP_SENTIENCE_DETECTED, NEO_GRB + NEO_KHZ800);
+ringPixels stripSentienceDetected = ringPixels(3, PIN_STRIP_SENTIENCE_DETECTED, NEO_GRB + NEO_KHZ800);
 
 PCA9685 pwmController1;
 
@@ -74,36 +78,58 @@ enum aiStates
 bool errorStates[3];
 bool flipFlop;
 bool sentienceDetected;
-bool abortFlag;
+
+#define SENTIENCE_MS 20000
+#define SENTIENCE_COMPLETE_MS 8000
+
+#define ABORT_STEP_MS 250
+#define ABORT_STEPS 16
+
+// Step of the abort sequence up next, 0 while not aborting.
+// The abort sequence has the matrices and lights to itself.
+byte abortStep = 0;
+uint16_t abortPwms[16];
+
+byte taskAbortStep;
+byte taskSentience;
+byte taskSentienceComplete;
+byte taskErrors;
 
 void MemoryBank()
 {
-  static msTimer timer(1000);
-  if (timer.elapsed())
+  if (abortStep > 0)
+  {
+    return;
+  }
+
+  for (int row = 0; row < 8; row++)
   {
-    for (int row = 0; row < 8; row++)
+    for (int col = 0; col < 8; col++)
     {
-      for (int col = 0; col < 8; col++)
+      if (random(2) == 0) // Hides refresh pattern.
       {
-        if (random(2) == 0) // Hides refresh pattern.
-        {
-          if (random(3) == 0)
-            lc.setLed(0, row, col, true);
-          else
-            lc.setLed(0, row, col, false);
-        }
+        if (random(3) == 0)
+          lc.setLed(0, row, col, true);
+        else
+          lc.setLed(0, row, col, false);
       }
     }
   }
 }
 
+// The AI animations are tasks of their own, each draws only while its AI is selected.
 void Skynet()
 {
   static RainDrop drops[10];
 
+  if (aiState != skynet || abortStep > 0)
+  {
+    return;
+  }
+
   for (int drop = 0; drop < 6; drop++)
   {
-    if ((drops[drop].millis + drops[drop].speed) < millis())
+    if (millis() - drops[drop].millis > drops[drop].speed)
     {
       drops[drop].millis = millis();
 
@@ -127,54 +153,61 @@ void Skynet()
 
 void Lcars()
 {
-  static msTimer timer(500);
-  if (timer.elapsed())
+  if (aiState != lcars || abortStep > 0)
   {
-    int col = random(0, 8);
-    int val = random(0, 8);
-    lc.setColumn(1, col, lcarsVals[val]);
-    lc.setColumn(2, col, flipFlop ? ~lcarsVals[val] : lcarsVals[val]);
+    return;
   }
+
+  int col = random(0, 8);
+  int val = random(0, 8);
+  lc.setColumn(1, col, lcarsVals[val]);
+  lc.setColumn(2, col, flipFlop ? ~lcarsVals[val] : lcarsVals[val]);
 }
 
 void Hal()
 {
-  static msTimer timer(500);
-  if (timer.elapsed())
+  static byte step;
+
+  if (aiState != hal || abortStep > 0)
+  {
+    return;
+  }
+
+  if (++step > 3)
   {
-    static byte step;
+    step = 0;
+  }
 
-    if (++step > 3)
+  for (int i = 0; i < 8; i++)
+  {
+    if (step == 0)
     {
-      step = 0;
+      lc.setRow(1, i, hal0[i]);
+      lc.setRow(2, i, flipFlop ? ~hal0[i] : hal0[i]);
     }
-
-    for (int i = 0; i < 8; i++)
+    else if (step == 1)
     {
-      if (step == 0)
-      {
-        lc.setRow(1, i, hal0[i]);
-        lc.setRow(2, i, flipFlop ? ~hal0[i] : hal0[i]);
-      }
-      else if (step == 1)
-      {
-        lc.setRow(1, i, hal1[i]);
-        lc.setRow(2, i, flipFlop ? ~hal1[i] : hal1[i]);
-      }
-      else if (step == 2)
-      {
-        lc.setRow(1, i, hal2[i]);
-        lc.setRow(2, i, flipFlop ? ~hal2[i] : hal2[i]);
-      }
+      lc.setRow(1, i, hal1[i]);
+      lc.setRow(2, i, flipFlop ? ~hal1[i] : hal1[i]);
+    }
+    else if (step == 2)
+    {
+      lc.setRow(1, i, hal2[i]);
+      lc.setRow(2, i, flipFlop ? ~hal2[i] : hal2[i]);
     }
   }
 }
 
 void Kitt()
 {
+  if (aiState != kitt || abortStep > 0)
+  {
+    return;
+  }
+
   for (int i = 0; i < 8; i++)
   {
-    if ((kitLeds[i].millis + kitLeds[i].speed) < millis())
+    if (millis() - kitLeds[i].millis > kitLeds[i].speed)
     {
 
       kitLeds[i].millis = millis();
@@ -216,6 +249,11 @@ void UpdatePWMs()
 {
   uint16_t pwms1[16];
 
+  if (abortStep > 0)
+  {
+    return;
+  }
+
   // Error states/messages.
   for (unsigned int i = 0; i < sizeof(errorStates); i++)
   {
@@ -245,6 +283,17 @@ void UpdatePWMs()
   pwmController1.setChannelsPWM(0, 16, pwms1);
 }
 
+// Effects pushed to the panels, holding Kitt steps to the next, vmOff hands back the built in effects.
+const byte *const vmPrograms[] = {vmOff, vmSweep, vmPulse};
+const byte vmProgramSizes[] = {sizeof(vmOff), sizeof(vmSweep), sizeof(vmPulse)};
+
+void NextVmProgram()
+{
+  static byte program = 0;
+  program = (program + 1) % sizeof(vmProgramSizes);
+  LoadVmProgram(vmPrograms[program], vmProgramSizes[program]);
+}
+
 void CheckButtons()
 {
   buttonAbort.read();
@@ -258,7 +307,8 @@ void CheckButtons()
   {
     if (sentienceDetected)
     {
-      abortFlag = true;
+      SendCue(cueAbort);
+      PostEvent(metaphasicVxCpuCore, eventButton, 0);
     }
   }
 
@@ -268,6 +318,7 @@ void CheckButtons()
     {
       aiState = skynet;
       activityFlag = true;
+      PostEvent(metaphasicVxCpuCore, eventButton + 1, 0);
     }
   }
 
@@ -277,6 +328,7 @@ void CheckButtons()
     {
       aiState = lcars;
       activityFlag = true;
+      PostEvent(metaphasicVxCpuCore, eventButton + 2, 0);
     }
   }
 
@@ -286,6 +338,7 @@ void CheckButtons()
     {
       aiState = kitt;
       activityFlag = true;
+      PostEvent(metaphasicVxCpuCore, eventButton + 3, 0);
     }
   }
 
@@ -295,6 +348,7 @@ void CheckButtons()
     {
       aiState = hal;
       activityFlag = true;
+      PostEvent(metaphasicVxCpuCore, eventButton + 4, 0);
     }
   }
 
@@ -319,19 +373,32 @@ void CheckButtons()
   {
     state = warning;
   }
+
+  // Once per hold.
+  static bool kittHeld = false;
+  if (buttonKitt.pressedFor(pressedForDelay))
+  {
+    if (!kittHeld)
+    {
+      kittHeld = true;
+      NextVmProgram();
+    }
+  }
+  else
+  {
+    kittHeld = false;
+  }
 }
 
+// Runs again after a random time, shorter as the state rises.
 void ProcessErrors()
 {
-  static msTimer errorTimer(1000);
+  static lockstepRandom stream(randomErrors);
   int delay = state == stable ? 2500 : state == warning ? 1500 : state == critical ? 750 : 0;
 
-  if (errorTimer.elapsed())
-  {
-    errorTimer.setDelay(random(delay, delay * 2));
-    int quantity = state == stable ? 1 : state == warning ? 2 : state == critical ? 2 : 0;
-    RandomArrayFill(errorStates, quantity, sizeof(errorStates));
-  }
+  ScheduleTask(taskErrors, stream.next(delay, delay * 2));
+  int quantity = state == stable ? 1 : state == warning ? 2 : state == critical ? 2 : 0;
+  RandomArrayFill(errorStates, quantity, sizeof(errorStates), &stream);
 }
 
 void UpdateSentienceIndicator()
@@ -348,62 +415,67 @@ void UpdateSentienceIndicator()
   stripSentienceDetected.show();
 }
 
-void AbortSequence()
+// Runs a step every ABORT_STEP_MS so control frames keep circulating, the ring would break over the whole sequence.
+// Matrix rows clear top down, then every light flashes.
+void AbortStep()
 {
-  sentienceDetected = false;
-  UpdateSentienceIndicator();
-
-  uint16_t pwms1[16];
-  for (int i = 0; i < 16; i++)
+  // The next detection is timed from the end of the sequence.
+  if (abortStep > ABORT_STEPS)
   {
-    pwms1[i] = 0;
+    abortStep = 0;
+    ScheduleTask(taskSentience, SENTIENCE_MS);
+    return;
   }
 
-  byte empty = 0;
-  for (int i = 0; i < 8; i++)
+  byte i = abortStep - 1;
+
+  if (i < 8)
   {
+    byte empty = 0;
     lc.setRow(0, 7 - i, empty);
     lc.setRow(1, 7 - i, empty);
     lc.setRow(2, 7 - i, empty);
-    pwms1[12] = ~pwms1[12];
-    pwmController1.setChannelsPWM(0, 16, pwms1);
-    delay(250);
+    abortPwms[12] = ~abortPwms[12];
   }
-
-  for (int i = 0; i < 8; i++)
+  else
   {
     int pwmValue = ((i % 2) == 0) ? 0 : 1500;
-    for (int i = 0; i < 16; i++)
+    for (int j = 0; j < 16; j++)
     {
-      pwms1[i] = pwmValue;
+      abortPwms[j] = pwmValue;
     }
-    pwms1[12] = ((i % 2) == 1) ? 0 : 1500;
-    pwmController1.setChannelsPWM(0, 16, pwms1);
-    delay(250);
+    abortPwms[12] = ((i % 2) == 1) ? 0 : 1500;
   }
+
+  pwmController1.setChannelsPWM(0, 16, abortPwms);
+  abortStep++;
+  ScheduleTask(taskAbortStep, ABORT_STEP_MS);
 }
 
-void UpdateSentience()
+void AbortSequence()
 {
-  static msTimer timerSentience(20000);
-  static msTimer timerSentienceComplete(8000);
-  if (timerSentience.elapsed())
-  {
-    sentienceDetected = true;
-    timerSentienceComplete.resetDelay();
-  }
+  sentienceDetected = false;
+  UpdateSentienceIndicator();
 
-  if (timerSentienceComplete.elapsed())
+  for (int i = 0; i < 16; i++)
   {
-    sentienceDetected = false;
+    abortPwms[i] = 0;
   }
 
-  if (abortFlag)
-  {
-    abortFlag = false;
-    AbortSequence();
-    timerSentience.resetDelay();
-  }
+  abortStep = 1;
+  CancelTask(taskSentience);
+  ScheduleTask(taskAbortStep, 0);
+}
+
+// Every SENTIENCE_MS the wall detects sentience, SentienceCue() fires with the other panels' steps.
+void DetectSentience()
+{
+  SendCue(cueSentience);
+}
+
+void SentienceComplete()
+{
+  sentienceDetected = false;
 }
 
 void CheckToggle()
@@ -414,20 +486,24 @@ void CheckToggle()
   {
     oldToggleSuppression = digitalRead(PIN_TOGGLE_SUPPRESSION);
     activityFlag = true;
+    PostEvent(metaphasicVxCpuCore, eventToggle, oldToggleSuppression);
   }
 }
 
 void UpdateFlipFlop()
 {
-  static msTimer flipFlopTimer(5000);
-  if (flipFlopTimer.elapsed())
-  {
-    flipFlop = !flipFlop;
-  }
+  flipFlop = !flipFlop;
 }
 
 void ShutdownPanel()
 {
+  if (abortStep > 0)
+  {
+    CancelTask(taskAbortStep);
+    abortStep = 0;
+    ScheduleTask(taskSentience, SENTIENCE_MS);
+  }
+
   stripSentienceDetected.fill(0, 0, stripSentienceDetected.numPixels());
   stripSentienceDetected.show();
 
@@ -464,10 +540,62 @@ void ApplyStatesFromSwitches()
   }
 }
 
+void SentienceCue(byte cue)
+{
+  if (IsPanelBootup(metaphasicVxCpuCore))
+  {
+    sentienceDetected = true;
+    ScheduleTask(taskSentienceComplete, SENTIENCE_COMPLETE_MS);
+  }
+}
+
+void AbortCue(byte cue)
+{
+  if (IsPanelBootup(metaphasicVxCpuCore))
+  {
+    AbortSequence();
+  }
+}
+
+// Fired with the other panels' steps.
+const cueStep cueSteps[] PROGMEM = {
+    {cueSentience, 0, SentienceCue},
+    {cueAbort, 0, AbortCue}};
+
+// The panel is held dark until it is booted.
+void CheckBootup()
+{
+  if (!IsPanelBootup(metaphasicVxCpuCore))
+  {
+    ShutdownPanel();
+  }
+}
+
+signed int activityCount = 0;
+
+// Automatic activity resumes once the panels are left alone.
+void ActivityTimeout()
+{
+  mode = automaticActivity;
+}
+
+// Manual activity winds down a step a second.
+void ReduceActivity()
+{
+  if (mode == manualActivity && --activityCount == -1)
+  {
+    activityCount = 0;
+  }
+}
+
+byte taskActivityTimeout;
+
 void setup()
 {
-  delay(500);
-  Serial.begin(BAUD_RATE);
+  BeginControlData(true);
+  BeginVm();
+  HostPanel(metaphasicVxCpuCore);
+  SetCueSteps(cueSteps, sizeof(cueSteps) / sizeof(cueSteps[0]));
 
   pinMode(PIN_TOGGLE_SUPPRESSION, INPUT);
   digitalWrite(PIN_TOGGLE_SUPPRESSION, HIGH);
@@ -504,91 +632,68 @@ void setup()
 
   state = stable;
   aiState = lcars;
+
+  AddPanelTask(metaphasicVxCpuCore, UpdateFlipFlop, 5000, 5000);
+  AddPanelTask(metaphasicVxCpuCore, MemoryBank, 1000, 1000);
+  AddPanelTask(metaphasicVxCpuCore, Skynet, TASK_FRAME_MS);
+  AddPanelTask(metaphasicVxCpuCore, Lcars, 500, 500);
+  AddPanelTask(metaphasicVxCpuCore, Kitt, TASK_FRAME_MS);
+  AddPanelTask(metaphasicVxCpuCore, Hal, 500, 500);
+  AddPanelTask(metaphasicVxCpuCore, UpdatePWMs, TASK_FRAME_MS);
+  AddPanelTask(metaphasicVxCpuCore, UpdateSentienceIndicator, TASK_FRAME_MS);
+  AddPanelTask(metaphasicVxCpuCore, CheckToggle, TASK_FRAME_MS);
+  AddPanelTask(metaphasicVxCpuCore, CheckButtons, TASK_FRAME_MS);
+  taskErrors = AddPanelTask(metaphasicVxCpuCore, ProcessErrors, 1000, 1000);
+  taskSentience = AddPanelTask(metaphasicVxCpuCore, DetectSentience, SENTIENCE_MS, SENTIENCE_MS);
+  taskSentienceComplete = AddTaskOnce(SentienceComplete);
+  taskAbortStep = AddTaskOnce(AbortStep);
+  AddTask(CheckBootup, TASK_FRAME_MS);
+  AddTask(SendStatusFromMaster, 2000, 2000);
+  taskActivityTimeout = AddTask(ActivityTimeout, 8000, 8000);
+  AddTask(ReduceActivity, 1000, 1000);
 }
 
 void loop()
 {
-  static msTimer timerActivityTimeout(8000);
-  static msTimer timerSendData(100);
-  static signed int activityCount = 0;
+  LatchFrameClock();
+
+  static bool performActivity = false;
 
   CheckStartupSequence();
 
   CheckControlData(true);
 
-  if (timerSendData.elapsed())
+  if (activityFlag)
   {
-    if (activityFlag)
-    {
-      activityCount++;
-      activityFlag = false;
-      mode = manualActivity;
-      timerActivityTimeout.resetDelay();
-
-      SendControlDataFromMaster(true);
-    }
-    else
-    {
-      SendControlDataFromMaster(false);
-    }
+    // Interacting with several panels at once escalates faster.
+    activityCount += max(1, CountPanelInputsChanged());
+    activityFlag = false;
+    mode = manualActivity;
+    ScheduleTask(taskActivityTimeout, 8000);
+    performActivity = true;
   }
 
-  if (timerActivityTimeout.elapsed())
+  SendBlocksFromMaster();
+
+  // Sent as soon as anything changes, a slow keep-alive otherwise.
+  if (ringScheduler.due(ControlDataChanged() || performActivity || RingEchoOverdue()))
   {
-    mode = automaticActivity;
+    SendControlDataFromMaster(performActivity);
+    performActivity = false;
   }
 
   // ApplyStatesFromSwitches();
 
   // State controller for entire panel.
-  static msTimer timerState(10000);
-
   if (mode == automaticActivity)
   {
 
     activityCount = state == critical ? 11 : state == warning ? 6 : 0;
 
-    if (timerState.elapsed())
-    {
-      int delay = state == stable ? 10000 : state == warning ? 6000 : state == critical ? 3000 : 0;
-      timerState.setDelayAndReset(random(delay, delay * 2));
-
-      int randMax = state == stable ? 3 : state == warning ? 4 : state == critical ? 5 : 0;
-
-      if (random(0, randMax) == 0)
-      {
-        // Increment state.
-        if (state == stable)
-          state = warning;
-        else if (state == warning)
-          state = critical;
-        else if (state == critical)
-          state = critical;
-      }
-      else
-      {
-        // Decrement state.
-        if (state == stable)
-          state = stable;
-        else if (state == warning)
-          state = stable;
-        else if (state == critical)
-          state = warning;
-      }
-    }
+    UpdateAutomaticState();
   }
   else if (mode == manualActivity)
   {
-
-    static msTimer timerActivityReduction(1000);
-    if (timerActivityReduction.elapsed())
-    {
-      if (--activityCount == -1)
-      {
-        activityCount = 0;
-      }
-    }
-
     if (activityCount > 9)
     {
       state = critical;
@@ -603,35 +708,5 @@ void loop()
     }
   }
 
-  if (IsPanelBootup(metaphasicVxCpuCore))
-  {
-    UpdateFlipFlop();
-
-    UpdateSentience();
-
-    UpdateSentienceIndicator();
-
-    CheckToggle();
-
-    UpdatePWMs();
-
-    CheckButtons();
-
-    ProcessErrors();
-
-    MemoryBank();
-
-    if (aiState == skynet)
-      Skynet();
-    else if (aiState == lcars)
-      Lcars();
-    else if (aiState == kitt)
-      Kitt();
-    else if (aiState == hal)
-      Hal();
-  }
-  else
-  {
-    ShutdownPanel();
-  }
+  RunTasks();
 }
@@ -0,0 +1,143 @@
+// Adafruit_NeoPixel
+//
+// Host stand-in for the NeoPixel library, used by the native unit tests.
+// show() puts the colour bytes on neoPixelLine as the strip would see them,
+// waits out the latch time like the library, and calls neoPixelShowHook with
+// the span interrupts were off for, 10 us a byte at 800 kHz. The line idling
+// for a WS2812's latch time between shows is counted as a latch, the strip
+// then starts over from its first pixel. Colours are kept in the order
+// given, with no GRB reordering.
+//
+// Version 1.0
+
+#ifndef ADAFRUIT_NEOPIXEL_H
+#define ADAFRUIT_NEOPIXEL_H
+
+#include <Arduino.h>
+
+#define NEO_RGB 0x06
+#define NEO_GRB 0x52
+#define NEO_KHZ800 0x0000
+
+typedef uint16_t neoPixelType;
+
+#define NEO_PIXEL_LINE_CAPACITY 1024
+
+// Interrupts off time around the bytes of one show().
+#define NEO_PIXEL_OVERHEAD_US 3
+
+byte neoPixelLine[NEO_PIXEL_LINE_CAPACITY];
+unsigned int neoPixelLineCount = 0;
+
+// WS2812 latch time, the line idle this long ends a frame.
+#define NEO_PIXEL_LATCH_US 50
+
+// Latches between shows since the line was cleared, and when the line last went idle.
+unsigned int neoPixelLatches = 0;
+unsigned long neoPixelIdleMicros = 0;
+
+void (*neoPixelShowHook)(unsigned long start, unsigned long end) = NULL;
+
+class Adafruit_NeoPixel
+{
+
+protected:
+  uint16_t numLEDs;
+  uint16_t numBytes;
+  uint8_t *pixels;
+  uint32_t endTime;
+
+public:
+  Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800)
+  {
+    numLEDs = n;
+    numBytes = n * 3;
+    pixels = (uint8_t *)calloc(numBytes, 1);
+    endTime = 0;
+  }
+
+  ~Adafruit_NeoPixel()
+  {
+    free(pixels);
+  }
+
+  void begin()
+  {
+  }
+
+  bool canShow()
+  {
+    if (endTime > micros())
+    {
+      endTime = micros();
+    }
+    return (micros() - endTime) >= 300L;
+  }
+
+  void show()
+  {
+    if (!canShow())
+    {
+      AdvanceClock(300 - (micros() - endTime));
+    }
+
+    if (neoPixelLineCount > 0 && micros() - neoPixelIdleMicros >= NEO_PIXEL_LATCH_US)
+    {
+      neoPixelLatches++;
+    }
+
+    unsigned long start = micros();
+    for (uint16_t i = 0; i < numBytes && neoPixelLineCount < NEO_PIXEL_LINE_CAPACITY; i++)
+    {
+      neoPixelLine[neoPixelLineCount++] = pixels[i];
+    }
+    AdvanceClock(numBytes * 10UL + NEO_PIXEL_OVERHEAD_US);
+
+    if (neoPixelShowHook)
+    {
+      neoPixelShowHook(start, micros());
+    }
+    endTime = micros();
+    neoPixelIdleMicros = micros();
+  }
+
+  void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b)
+  {
+    if (n < numLEDs)
+    {
+      pixels[n * 3] = r;
+      pixels[n * 3 + 1] = g;
+      pixels[n * 3 + 2] = b;
+    }
+  }
+
+  void setPixelColor(uint16_t n, uint32_t c)
+  {
+    setPixelColor(n, c >> 16, c >> 8, c);
+  }
+
+  void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0)
+  {
+    for (uint16_t i = first; i < (count ? first + count : numLEDs); i++)
+    {
+      setPixelColor(i, c);
+    }
+  }
+
+  void clear()
+  {
+    memset(pixels, 0, numBytes);
+  }
+
+  uint16_t numPixels() const
+  {
+    return numLEDs;
+  }
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b)
+  {
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+  }
+};
+
+#endif
@@ -0,0 +1,113 @@
+// Arduino
+//
+// Host stand-in for the Arduino core, used by the native unit tests.
+// Each test is a single translation unit, so the globals are defined here.
+// millis() and micros() read a virtual clock the tests move with AdvanceClock(),
+// truncated to 32 bits so they wrap as on the AVR.
+//
+// Version 1.0
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define PI 3.1415926535897932384626433832795
+#define radians(deg) ((deg) * PI / 180.0)
+#define F(s) (s)
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define lowByte(w) ((uint8_t)((w) & 0xFF))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+
+template <class T>
+T constrain(T x, T low, T high)
+{
+  return x < low ? low : x > high ? high : x;
+}
+
+unsigned long fakeMillis = 0;
+unsigned long fakeMicros = 0;
+
+inline unsigned long millis()
+{
+  return (uint32_t)fakeMillis;
+}
+
+inline unsigned long micros()
+{
+  return (uint32_t)fakeMicros;
+}
+
+// Moves the virtual clock forward, millis() follows micros() as on the AVR.
+void AdvanceClock(unsigned long us)
+{
+  unsigned long before = fakeMicros;
+  fakeMicros += us;
+  fakeMillis += fakeMicros / 1000 - before / 1000;
+}
+
+// Sets both clocks, e.g. just short of a wrap.
+void SetClock(unsigned long ms, unsigned long us)
+{
+  fakeMillis = ms;
+  fakeMicros = us;
+}
+
+inline void delay(unsigned long ms)
+{
+  AdvanceClock(ms * 1000);
+}
+
+inline void delayMicroseconds(unsigned int us)
+{
+  AdvanceClock(us);
+}
+
+inline long random(long high)
+{
+  return high > 0 ? rand() % high : 0;
+}
+
+inline long random(long low, long high)
+{
+  return high > low ? low + rand() % (high - low) : low;
+}
+
+inline void randomSeed(unsigned long seed)
+{
+  srand(seed);
+}
+
+inline long map(long x, long inLow, long inHigh, long outLow, long outHigh)
+{
+  return (x - inLow) * (outHigh - outLow) / (inHigh - inLow) + outLow;
+}
+
+inline int digitalRead(uint8_t) { return LOW; }
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int analogRead(uint8_t) { return 0; }
+inline void analogWrite(uint8_t, int) {}
+inline void pinMode(uint8_t, uint8_t) {}
+
+#endif
@@ -0,0 +1,57 @@
+// Host stand-in for the 1 KB EEPROM, held in RAM.
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <Arduino.h>
+
+class EEPROMClass
+{
+
+private:
+  uint8_t _data[1024];
+
+public:
+  EEPROMClass()
+  {
+    memset(_data, 0xFF, sizeof(_data));
+  }
+
+  uint8_t read(int address)
+  {
+    return _data[address];
+  }
+
+  void write(int address, uint8_t value)
+  {
+    _data[address] = value;
+  }
+
+  void update(int address, uint8_t value)
+  {
+    _data[address] = value;
+  }
+
+  template <class T>
+  T &get(int address, T &t)
+  {
+    memcpy(&t, _data + address, sizeof(T));
+    return t;
+  }
+
+  template <class T>
+  const T &put(int address, const T &t)
+  {
+    memcpy(_data + address, &t, sizeof(T));
+    return t;
+  }
+
+  uint16_t length()
+  {
+    return sizeof(_data);
+  }
+};
+
+EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,12 @@
+// Host stand-in, interrupt vectors become plain functions the tests call.
+
+#ifndef AVR_INTERRUPT_H
+#define AVR_INTERRUPT_H
+
+#define ISR(vector) extern "C" void vector(void)
+#define cli() ((void)0)
+#define sei() ((void)0)
+#define noInterrupts() ((void)0)
+#define interrupts() ((void)0)
+
+#endif
@@ -0,0 +1,30 @@
+// Host stand-in for the ATmega328 registers used by the common headers.
+
+#ifndef AVR_IO_H
+#define AVR_IO_H
+
+#include <stdint.h>
+
+volatile uint8_t UDR0, UCSR0A, UCSR0B, UCSR0C, UBRR0H, UBRR0L;
+volatile uint8_t SREG, MCUSR, SMCR;
+volatile uint8_t TCCR2A, TCCR2B, TIMSK2, TIFR2, TCNT2, OCR2A;
+
+#define RXC0 7
+#define TXC0 6
+#define UDRE0 5
+#define FE0 4
+#define DOR0 3
+#define UPE0 2
+#define U2X0 1
+#define RXCIE0 7
+#define TXCIE0 6
+#define UDRIE0 5
+#define RXEN0 4
+#define TXEN0 3
+#define UCSZ01 2
+#define UCSZ00 1
+#define TOIE2 0
+
+#define _BV(bit) (1 << (bit))
+
+#endif
@@ -0,0 +1,15 @@
+// Host stand-in, program memory is ordinary memory.
+
+#ifndef AVR_PGMSPACE_H
+#define AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define memcpy_P memcpy
+
+#endif
@@ -0,0 +1,23 @@
+// Host stand-in, sleeping moves the virtual clock on by sleepMicros.
+
+#ifndef AVR_SLEEP_H
+#define AVR_SLEEP_H
+
+#define SLEEP_MODE_IDLE 0
+
+unsigned long sleepMicros = 100;
+unsigned int sleepCount = 0;
+
+void AdvanceClock(unsigned long us);
+
+inline void set_sleep_mode(int) {}
+inline void sleep_enable() {}
+inline void sleep_disable() {}
+
+inline void sleep_cpu()
+{
+  sleepCount++;
+  AdvanceClock(sleepMicros);
+}
+
+#endif
@@ -0,0 +1,108 @@
+// ringTest
+//
+// Wire helpers for the native unit tests.
+// The USART is never ready, so everything a board sends waits in the transmit
+// ring, DrainTx() moves it to txBytes as the UDRE interrupt would.
+// ReceiveByte() runs the RX interrupt for one byte, relaying it if forwarding.
+// EncodeWire() and ReceiveWire() play a frame in from upstream at line rate.
+//
+// Version 1.0
+
+#ifndef RING_TEST_H
+#define RING_TEST_H
+
+#include <Arduino.h>
+#include <ringSerial.h>
+#include <ringFrame.h>
+
+#define TEST_TX_CAPACITY 2048
+
+byte txBytes[TEST_TX_CAPACITY];
+unsigned int txCount = 0;
+
+void DrainTx()
+{
+  while (ringTxHead != ringTxTail)
+  {
+    if (txCount < TEST_TX_CAPACITY)
+    {
+      txBytes[txCount++] = ringTxBuffer[ringTxTail];
+    }
+    ringTxTail = (ringTxTail + 1) & RING_TX_MASK;
+  }
+
+  UCSR0B &= ~_BV(UDRIE0);
+  UCSR0A = _BV(TXC0);
+}
+
+void ClearTx()
+{
+  DrainTx();
+  txCount = 0;
+}
+
+void ReceiveByte(byte c)
+{
+  UDR0 = c;
+  UCSR0A = 0;
+  USART_RX_vect();
+  DrainTx();
+}
+
+void ReceiveBytes(const byte *bytes, unsigned int count)
+{
+  for (unsigned int i = 0; i < count; i++)
+  {
+    ReceiveByte(bytes[i]);
+  }
+}
+
+// A frame as it leaves the sender, for receiving a byte time apart with ReceiveWire().
+byte wire[FRAME_WIRE_SIZE(RING_FRAME_MAX_PAYLOAD)];
+byte wireCount;
+
+void PutWire(byte c)
+{
+  wire[wireCount++] = c;
+}
+
+void PutWireStuffed(byte c)
+{
+  if (c == SLIP_END || c == SLIP_ESC)
+  {
+    PutWire(SLIP_ESC);
+    PutWire(c == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC);
+  }
+  else
+  {
+    PutWire(c);
+  }
+}
+
+void EncodeWire(byte type, const byte *payload, byte length)
+{
+  wireCount = 0;
+  EncodeFrame(type, payload, length, PutWireStuffed, PutWire);
+}
+
+// Receives the encoded frame at baud, returns micros() as its closing END arrived.
+unsigned long ReceiveWire(unsigned long baud)
+{
+  unsigned long start = micros();
+
+  for (byte i = 0; i < wireCount; i++)
+  {
+    unsigned long at = start + (i + 1) * 10000000ULL / baud;
+    SetClock(at / 1000, at);
+    ReceiveByte(wire[i]);
+  }
+  return micros();
+}
+
+// Empties the receive ring without decoding.
+void ClearRx()
+{
+  ringRxTail = ringRxHead;
+}
+
+#endif
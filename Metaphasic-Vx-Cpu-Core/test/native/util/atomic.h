@@ -0,0 +1,9 @@
+// Host stand-in, blocks run once with nothing to mask.
+
+#ifndef UTIL_ATOMIC_H
+#define UTIL_ATOMIC_H
+
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_BLOCK(type) for (int atomicOnce = 1; atomicOnce; atomicOnce = 0)
+
+#endif
@@ -0,0 +1,70 @@
+// Saved blocks: loaded at boot only while the firmware's layout tag matches, and areas do not overlap.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <common.h>
+#include <vmPrograms.h>
+
+void setUp()
+{
+  // Blank EEPROM, as shipped.
+  for (int i = 0; i < 128; i++)
+  {
+    EEPROM.update(i, 0xFF);
+  }
+  BeginParams();
+  BeginVm();
+}
+
+void tearDown()
+{
+}
+
+void test_saved_blocks_reload()
+{
+  SetParam(paramVertexBrightness, 42);
+  LoadVmProgram(vmSweep, sizeof(vmSweep));
+  SaveBlock(blockParams);
+  SaveBlock(blockProgram);
+
+  // Rebooted, the saved blocks replace the built in ones.
+  memset(ringVmProgram, opEnd, RING_VM_PROGRAM_SIZE);
+  BeginParams();
+  BeginVm();
+
+  TEST_ASSERT_EQUAL(42, Param(paramVertexBrightness));
+  TEST_ASSERT_EQUAL(blockPersist, ringBlocks[blockParams].flags);
+  TEST_ASSERT_TRUE(VmLoaded());
+  TEST_ASSERT_EQUAL(blockPersist, ringBlocks[blockProgram].flags);
+}
+
+void test_other_layout_not_loaded()
+{
+  SetParam(paramVertexBrightness, 42);
+  SaveBlock(blockParams);
+
+  // Saved by firmware with another table of the same size, the size and CRC still match.
+  EEPROM.update(ringBlockEeprom[blockParams] + 4, RING_PARAMS_LAYOUT + 1);
+  BeginParams();
+
+  TEST_ASSERT_EQUAL(pgm_read_word(&ringParamDefaults[paramVertexBrightness]), Param(paramVertexBrightness));
+  TEST_ASSERT_EQUAL(0, ringBlocks[blockParams].flags);
+  TEST_ASSERT_EQUAL(0, ringBlocks[blockParams].version);
+}
+
+void test_areas_do_not_overlap()
+{
+  for (byte id = 0; id + 1 < blockCount; id++)
+  {
+    TEST_ASSERT_LESS_OR_EQUAL(ringBlockEeprom[id + 1], ringBlockEeprom[id] + RING_BLOCK_EEPROM_HEADER + ringBlocks[id].size);
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_saved_blocks_reload);
+  RUN_TEST(test_other_layout_not_loaded);
+  RUN_TEST(test_areas_do_not_overlap);
+  return UNITY_END();
+}
@@ -0,0 +1,209 @@
+// A 32 panel wall: bootup bits and input slots past panel 8, the power budgeted boot cascade,
+// and the rate negotiated only once the wall is lit.
+
+#define RING_PANEL_COUNT 32
+
+#include <Arduino.h>
+#include <unity.h>
+#include <common.h>
+#include <ringTest.h>
+
+frameDecoder downstream;
+
+const byte bootPattern[PANEL_BITMAP_SIZE] = {0xA5, 0x5A, 0xFF, 0x81};
+
+void CopyTx(byte *bytes, unsigned int &count)
+{
+  memcpy(bytes, txBytes, txCount);
+  count = txCount;
+  ClearTx();
+}
+
+// Total supply draw, and the panels still drawing their inrush.
+unsigned int BootDraw(byte &inrushCount)
+{
+  unsigned int drawMa = 0;
+  inrushCount = 0;
+
+  for (byte i = 0; i < RING_PANEL_COUNT; i++)
+  {
+    if (!PanelBit(bootupPanels, i))
+    {
+      continue;
+    }
+
+    bool inrush = millis() - bootMillis[i] < RING_BOOT_INRUSH_MS;
+    drawMa += inrush ? BootCurrent(i).inrushMa : BootCurrent(i).runningMa;
+    inrushCount += inrush;
+  }
+  return drawMa;
+}
+
+byte CountTrues(const byte *bitmap)
+{
+  byte count = 0;
+  for (byte i = 0; i < RING_PANEL_COUNT; i++)
+  {
+    count += PanelBit(bitmap, i);
+  }
+  return count;
+}
+
+void setUp()
+{
+  ClearTx();
+  ClearRx();
+  SetClock(1000, 1000000UL);
+  ringBaudState = baudDone;
+  ringForwarding = false;
+  downstream = frameDecoder();
+  memset((byte *)hostedPanels, 0, sizeof(hostedPanels));
+  memset(bootupPanels, 0, sizeof(bootupPanels));
+}
+
+void tearDown()
+{
+}
+
+void test_control_frame_addresses_every_panel()
+{
+  memcpy(bootupPanels, bootPattern, sizeof(bootupPanels));
+  SendControlDataFromMaster(false);
+  DrainTx();
+
+  byte sent[TEST_TX_CAPACITY];
+  unsigned int sentCount;
+  CopyTx(sent, sentCount);
+
+  // A board hosting panel 20 relays the frame.
+  ringForwarding = true;
+  memset(bootupPanels, 0, sizeof(bootupPanels));
+  SetPanelInputs((Panels)20, 0x12, 0x34);
+  ReceiveBytes(sent, sentCount);
+  CheckControlData();
+
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(bootPattern, bootupPanels, PANEL_BITMAP_SIZE);
+  TEST_ASSERT_TRUE(IsPanelBootup((Panels)31));
+  TEST_ASSERT_FALSE(IsPanelBootup((Panels)30));
+
+  unsigned int index = 0;
+  const byte *frame = NULL;
+  while (index < txCount && frame == NULL)
+  {
+    frame = downstream.decode(txBytes[index++]);
+  }
+  TEST_ASSERT_NOT_NULL(frame);
+  TEST_ASSERT_EQUAL(ControlFrameLength(RING_PANEL_COUNT), FrameLength(frame));
+  TEST_ASSERT_EQUAL(RING_PANEL_COUNT, FramePayload(frame)[controlPanelCount]);
+
+  // The master reads panel 20's slot from the returning frame.
+  byte relayed[TEST_TX_CAPACITY];
+  unsigned int relayedCount;
+  CopyTx(relayed, relayedCount);
+  ringForwarding = false;
+  memset((byte *)hostedPanels, 0, sizeof(hostedPanels));
+  memset((byte *)panelInputs, 0, sizeof(panelInputs));
+  ReceiveBytes(relayed, relayedCount);
+  CheckControlData(true);
+
+  TEST_ASSERT_TRUE(PanelInputsChanged((Panels)20));
+  TEST_ASSERT_EQUAL(0x12, panelInputs[20][inputBits]);
+  TEST_ASSERT_EQUAL(0x34, panelInputs[20][inputValue]);
+  TEST_ASSERT_EQUAL(0, CountPanelInputsChanged());
+}
+
+void test_boot_cascade_stays_in_budget()
+{
+  ringBaudState = baudIdle;
+  CheckStartupSequence(true);
+
+  unsigned long start = millis();
+  byte booted = 0;
+
+  while (booted < RING_PANEL_COUNT && millis() - start < 20000)
+  {
+    CheckStartupSequence();
+
+    byte inrushCount;
+    unsigned int drawMa = BootDraw(inrushCount);
+
+    // Over budget only while a single panel comes up on its own.
+    TEST_ASSERT_TRUE(drawMa <= RING_BOOT_BUDGET_MA || inrushCount <= 1);
+
+    // In address order.
+    booted = 0;
+    while (booted < RING_PANEL_COUNT && PanelBit(bootupPanels, booted))
+    {
+      booted++;
+    }
+    for (byte i = booted; i < RING_PANEL_COUNT; i++)
+    {
+      TEST_ASSERT_FALSE(PanelBit(bootupPanels, i));
+    }
+
+    AdvanceClock(1000);
+  }
+
+  TEST_ASSERT_EQUAL(RING_PANEL_COUNT, booted);
+
+  // Once the running draw nears the budget the panels come up one inrush apart.
+  TEST_ASSERT_LESS_OR_EQUAL(RING_PANEL_COUNT * RING_BOOT_INRUSH_MS, millis() - start);
+}
+
+// Boots every panel, returns the time the startup sequence began.
+unsigned long BootWall()
+{
+  CheckStartupSequence(true);
+  unsigned long start = millis();
+
+  for (unsigned int i = 0; i < 20000 && CountTrues(bootPending) > 0; i++)
+  {
+    CheckStartupSequence();
+    AdvanceClock(1000);
+  }
+  CheckStartupSequence();
+  return start;
+}
+
+void test_rate_negotiated_once_lit()
+{
+  unsigned long start = BootWall();
+
+  // Every bit is set but no frame carrying them has come back.
+  TEST_ASSERT_EQUAL(RING_PANEL_COUNT, CountTrues(bootupPanels));
+  TEST_ASSERT_FALSE(RingBaudNegotiating());
+  TEST_ASSERT_EQUAL(0, ringBootMillis);
+
+  SendControlDataFromMaster(false);
+  DrainTx();
+  byte sent[TEST_TX_CAPACITY];
+  unsigned int sentCount;
+  CopyTx(sent, sentCount);
+  AdvanceClock(3000);
+  ReceiveBytes(sent, sentCount);
+  CheckControlData(true);
+  TEST_ASSERT_FALSE(bootLitPending);
+
+  // The boot time runs to the frame's return, not through the negotiation.
+  unsigned int bootMillis = millis() - start;
+  TEST_ASSERT_EQUAL(bootMillis, ringBootMillis);
+
+  CheckStartupSequence();
+  TEST_ASSERT_TRUE(RingBaudNegotiating());
+  TEST_ASSERT_EQUAL(0, ringBaudMillis);
+
+  AdvanceClock(1500000UL);
+  ringBaudState = baudDone;
+  CheckStartupSequence();
+  TEST_ASSERT_EQUAL(bootMillis, ringBootMillis);
+  TEST_ASSERT_EQUAL(1500, ringBaudMillis);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_control_frame_addresses_every_panel);
+  RUN_TEST(test_boot_cascade_stays_in_budget);
+  RUN_TEST(test_rate_negotiated_once_lit);
+  return UNITY_END();
+}
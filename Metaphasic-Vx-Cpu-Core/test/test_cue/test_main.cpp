@@ -0,0 +1,199 @@
+// Cue skew: panels at different ring positions and clock rates fire a cue's steps together.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <common.h>
+#include <ringTest.h>
+
+#define BAUD 57600UL
+#define BYTE_MICROS (10000000UL / BAUD)
+#define FRAME_MICROS 20000UL
+#define STEP_OFFSET_MS 50
+
+// Master clock rate relative to the panel's, parts per million.
+long masterPpm;
+unsigned long masterOffset = 7000000UL;
+
+unsigned long firedMicros[2];
+byte firedCount[2];
+
+void FirstStep(byte cue)
+{
+  firedMicros[0] = micros();
+  firedCount[0]++;
+}
+
+void SecondStep(byte cue)
+{
+  firedMicros[1] = micros();
+  firedCount[1]++;
+}
+
+const cueStep testSteps[] PROGMEM = {
+    {cueSentience, 0, FirstStep},
+    {cueSentience, STEP_OFFSET_MS, SecondStep}};
+
+unsigned long long MasterMicros(unsigned long local)
+{
+  return masterOffset + local + (long long)local * masterPpm / 1000000;
+}
+
+// Plays a frame in from the master, through position relays a byte time each.
+void FromMaster(byte type, const byte *payload, byte length, byte position)
+{
+  EncodeWire(type, payload, length);
+  AdvanceClock(position * BYTE_MICROS);
+  ReceiveWire(BAUD);
+  CheckControlData();
+}
+
+void SendMasterTime(byte position)
+{
+  byte payload[ControlFrameLength(RING_PANEL_COUNT)];
+  memset(payload, 0, sizeof(payload));
+
+  unsigned long long now = MasterMicros(micros());
+  uint32_t ms = now / 1000;
+  uint16_t us = now % 1000;
+  memcpy(payload + controlTimeMillis, &ms, 4);
+  memcpy(payload + controlTimeMicros, &us, 2);
+  payload[controlPanelCount] = RING_PANEL_COUNT;
+  FromMaster(controlFrame, payload, sizeof(payload), position);
+}
+
+// A panel syncs to the master, then the master sends a cue.
+// Returns when the first step fired, in master time less the cue's fire time.
+long CueSkew(long ppm, byte position)
+{
+  masterPpm = ppm;
+  ringPosition = position;
+  ringTimeLocked = false;
+  ringDrift = 0;
+  ringCueCount = 0;
+  memset(firedCount, 0, sizeof(firedCount));
+
+  for (int frame = 0; frame < 300; frame++)
+  {
+    SendMasterTime(position);
+    AdvanceClock(FRAME_MICROS - wireCount * BYTE_MICROS);
+  }
+
+  // Same payload as SendCue(), sent twice.
+  uint32_t fireAt = MasterMicros(micros()) / 1000 + RING_CUE_LEAD_MS;
+  byte payload[cueFieldCount];
+  payload[cueId] = cueSentience;
+  memcpy(payload + cueFireAt, &fireAt, 4);
+  FromMaster(cueFrame, payload, sizeof(payload), position);
+  FromMaster(cueFrame, payload, sizeof(payload), position);
+
+  // loop() passes every 100 us.
+  for (unsigned int pass = 0; pass < 3000 && firedCount[1] == 0; pass++)
+  {
+    AdvanceClock(100);
+    CheckControlData();
+  }
+
+  TEST_ASSERT_EQUAL(1, firedCount[0]);
+  TEST_ASSERT_EQUAL(1, firedCount[1]);
+  TEST_ASSERT_INT_WITHIN(1200, STEP_OFFSET_MS * 1000L, (long)(MasterMicros(firedMicros[1]) - MasterMicros(firedMicros[0])));
+
+  return MasterMicros(firedMicros[0]) - fireAt * 1000ULL;
+}
+
+void setUp()
+{
+  ClearTx();
+  ClearRx();
+  SetClock(3000, 3000000UL);
+  ringBaudState = baudDone;
+  ringBaudIndex = 0;
+  ringForwarding = false;
+  SetCueSteps(testSteps, sizeof(testSteps) / sizeof(testSteps[0]));
+}
+
+void tearDown()
+{
+}
+
+void test_panels_fire_within_a_millisecond()
+{
+  const long ppms[] = {-150, 0, 150};
+  const byte positions[] = {1, 8, 31};
+  long earliest = 1000000;
+  long latest = -1000000;
+
+  for (byte i = 0; i < 3; i++)
+  {
+    for (byte j = 0; j < 3; j++)
+    {
+      long skew = CueSkew(ppms[i], positions[j]);
+
+      // A step fires in the ring millisecond it is due, never early.
+      TEST_ASSERT_GREATER_OR_EQUAL(-50, skew);
+      TEST_ASSERT_LESS_OR_EQUAL(1100, skew);
+      earliest = min(earliest, skew);
+      latest = max(latest, skew);
+    }
+  }
+
+  TEST_ASSERT_LESS_THAN(1000, latest - earliest);
+}
+
+void test_unlocked_panel_fires_at_once()
+{
+  ringTimeLocked = false;
+  ringCueCount = 0;
+  memset(firedCount, 0, sizeof(firedCount));
+
+  uint32_t fireAt = 123456;
+  byte payload[cueFieldCount];
+  payload[cueId] = cueSentience;
+  memcpy(payload + cueFireAt, &fireAt, 4);
+  FromMaster(cueFrame, payload, sizeof(payload), 1);
+
+  TEST_ASSERT_EQUAL(1, firedCount[0]);
+  TEST_ASSERT_EQUAL(0, firedCount[1]);
+}
+
+void test_master_fires_with_the_panels()
+{
+  long panelSkew = CueSkew(0, 8);
+
+  // The master's ring clock is its own, it never syncs or locks.
+  ringTimeLocked = false;
+  ringBaseMillis = 0;
+  ringBaseMicros = 0;
+  ringBaseLocal = 0;
+  ringDrift = 0;
+  ringCueCount = 0;
+  memset(firedCount, 0, sizeof(firedCount));
+  ClearTx();
+
+  uint32_t fireAt = RingMillis() + RING_CUE_LEAD_MS;
+  SendCue(cueSentience);
+  TEST_ASSERT_EQUAL(0, firedCount[0]);
+
+  for (unsigned int pass = 0; pass < 3000 && firedCount[1] == 0; pass++)
+  {
+    AdvanceClock(100);
+    CheckControlData(true);
+  }
+
+  TEST_ASSERT_EQUAL(1, firedCount[0]);
+  TEST_ASSERT_EQUAL(1, firedCount[1]);
+
+  // Not RING_CUE_LEAD_MS ahead of the panels, in the same millisecond as them.
+  long masterSkew = (long)(firedMicros[0] - fireAt * 1000ULL);
+  TEST_ASSERT_GREATER_OR_EQUAL(0, masterSkew);
+  TEST_ASSERT_LESS_OR_EQUAL(1100, masterSkew);
+  TEST_ASSERT_LESS_THAN(1000, labs(masterSkew - panelSkew));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_panels_fire_within_a_millisecond);
+  RUN_TEST(test_unlocked_panel_fires_at_once);
+  RUN_TEST(test_master_fires_with_the_panels);
+  return UNITY_END();
+}
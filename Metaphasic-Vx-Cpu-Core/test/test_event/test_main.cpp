@@ -0,0 +1,96 @@
+// Event coalescing on a board hosting several panels, each source coalesces on its own.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <common.h>
+#include <ringTest.h>
+
+frameDecoder downstream;
+
+// Decodes the next event frame queued by the board, NULL once there are none.
+const byte *NextEventFrame(unsigned int &index)
+{
+  while (index < txCount)
+  {
+    const byte *frame = downstream.decode(txBytes[index++]);
+
+    if (frame != NULL && FrameType(frame) == eventFrame)
+    {
+      return frame;
+    }
+  }
+  return NULL;
+}
+
+void setUp()
+{
+  ClearTx();
+  ClearRx();
+  downstream = frameDecoder();
+  ringEventCount = 0;
+  ringEventOverflowCount = 0;
+}
+
+void tearDown()
+{
+}
+
+void test_sources_coalesce_independently()
+{
+  // GNDN's board also hosts the grid, events from both are pending at once.
+  PostEvent(gndnPipelineRelay, eventToggle, 1);
+  PostEvent(tachyonSensormaticGrid, eventPot, 10);
+  PostEvent(gndnPipelineRelay, eventToggle, 2);
+  PostEvent(tachyonSensormaticGrid, eventPot, 20);
+  PostEvent(tachyonSensormaticGrid, eventButton, 0);
+
+  TEST_ASSERT_EQUAL(0, ringEventOverflowCount);
+  TEST_ASSERT_EQUAL(3, ringEventCount);
+
+  QueueEvents();
+  DrainTx();
+  TEST_ASSERT_EQUAL(0, ringEventCount);
+
+  // A frame per source, each with only its latest values.
+  unsigned int index = 0;
+  const byte *frame = NextEventFrame(index);
+  TEST_ASSERT_NOT_NULL(frame);
+  TEST_ASSERT_EQUAL(eventList + 2, FrameLength(frame));
+  TEST_ASSERT_EQUAL(gndnPipelineRelay, FramePayload(frame)[eventSource]);
+  TEST_ASSERT_EQUAL(eventToggle, FramePayload(frame)[eventList]);
+  TEST_ASSERT_EQUAL(2, FramePayload(frame)[eventList + 1]);
+
+  frame = NextEventFrame(index);
+  TEST_ASSERT_NOT_NULL(frame);
+  TEST_ASSERT_EQUAL(eventList + 4, FrameLength(frame));
+  TEST_ASSERT_EQUAL(tachyonSensormaticGrid, FramePayload(frame)[eventSource]);
+  TEST_ASSERT_EQUAL(eventPot, FramePayload(frame)[eventList]);
+  TEST_ASSERT_EQUAL(20, FramePayload(frame)[eventList + 1]);
+  TEST_ASSERT_EQUAL(eventButton, FramePayload(frame)[eventList + 2]);
+
+  TEST_ASSERT_NULL(NextEventFrame(index));
+}
+
+void test_full_queue_overflows()
+{
+  for (byte i = 0; i < RING_EVENT_QUEUE_SIZE; i++)
+  {
+    PostEvent(i & 1 ? gndnPipelineRelay : tachyonSensormaticGrid, eventButton + i, i);
+  }
+  TEST_ASSERT_EQUAL(0, ringEventOverflowCount);
+
+  // A new pair is dropped, a pending one still coalesces.
+  PostEvent(gndnPipelineRelay, eventPot, 1);
+  PostEvent(gndnPipelineRelay, eventButton + 1, 9);
+  TEST_ASSERT_EQUAL(1, ringEventOverflowCount);
+  TEST_ASSERT_EQUAL(RING_EVENT_QUEUE_SIZE, ringEventCount);
+  TEST_ASSERT_EQUAL(9, ringEventQueue[1].value);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_sources_coalesce_independently);
+  RUN_TEST(test_full_queue_overflows);
+  return UNITY_END();
+}
@@ -0,0 +1,192 @@
+// Flasher bank: a flasherBank matches an array of flashers, reading the clock once a frame, and the host benchmark of the two.
+
+#include <chrono> // Ahead of Arduino.h, whose min() and max() macros break it.
+#include <stdio.h>
+#include <Arduino.h>
+#include <unity.h>
+
+// Counts the flashers' clock reads.
+unsigned long clockReads = 0;
+
+unsigned long CountedMicros()
+{
+  clockReads++;
+  return micros();
+}
+
+#define FLASHER_CLOCK CountedMicros
+
+#include <common.h>
+#include <flasher.h>
+#include <flasherBank.h>
+
+// The patterns that do not draw random numbers, so both sides can be compared step by step.
+const Pattern patterns[] = {Pattern::Solid, Pattern::OnOff, Pattern::Sin, Pattern::RampUp, Pattern::Flash};
+#define PATTERNS (sizeof(patterns) / sizeof(patterns[0]))
+
+void setUp()
+{
+  SetClock(0, 0);
+  clockReads = 0;
+}
+
+void tearDown()
+{
+}
+
+// Pattern and delay of flasher i, the delays apart so no two share a phase.
+inline Pattern PatternOf(byte i)
+{
+  return patterns[i % PATTERNS];
+}
+
+inline int DelayOf(byte i)
+{
+  return 300 + 97 * i;
+}
+
+template <byte N>
+void CompareWithFlashers()
+{
+  flasher flashers[N];
+  flasherBank<N> bank(Pattern::Sin, 1000, 4095);
+
+  for (byte i = 0; i < N; i++)
+  {
+    flashers[i] = flasher(PatternOf(i), DelayOf(i), 4095);
+    bank.setPattern(i, PatternOf(i));
+    bank.setDelay(i, DelayOf(i));
+  }
+
+  // 10 s of frames, 1 to 20 ms apart.
+  while (fakeMicros < 10000000UL)
+  {
+    AdvanceClock(random(1000, 20000));
+
+    clockReads = 0;
+    bank.update();
+    TEST_ASSERT_EQUAL(1, clockReads);
+
+    clockReads = 0;
+    for (byte i = 0; i < N; i++)
+    {
+      TEST_ASSERT_EQUAL(flashers[i].getPwmValue(), bank.value(i));
+    }
+    TEST_ASSERT_EQUAL(N, clockReads);
+  }
+}
+
+void test_bank_matches_flashers()
+{
+  CompareWithFlashers<6>();
+  CompareWithFlashers<12>();
+  CompareWithFlashers<15>();
+}
+
+void test_update_fills_pwms()
+{
+  flasherBank<15> bank(Pattern::OnOff, 1000, 4095);
+  uint16_t pwms[16];
+
+  pwms[0] = 0xBEEF;
+  AdvanceClock(100000);
+  bank.update(pwms, 1);
+
+  // First half of the cycle, every channel from first on, the one before untouched.
+  TEST_ASSERT_EQUAL(0xBEEF, pwms[0]);
+  for (byte i = 1; i < 16; i++)
+  {
+    TEST_ASSERT_EQUAL(4095, pwms[i]);
+  }
+}
+
+// Nanoseconds per flasher per frame.
+template <byte N>
+double TimeFlashers(unsigned int frames)
+{
+  flasher flashers[N];
+  uint16_t pwms[16];
+
+  for (byte i = 0; i < N; i++)
+  {
+    flashers[i] = flasher(PatternOf(i), DelayOf(i), 4095);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int f = 0; f < frames; f++)
+  {
+    AdvanceClock(10000);
+    for (byte i = 0; i < N; i++)
+    {
+      pwms[i] = flashers[i].getPwmValue();
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  TEST_ASSERT_TRUE(pwms[0] <= 4095);
+  return std::chrono::duration<double, std::nano>(end - start).count() / frames / N;
+}
+
+template <byte N>
+double TimeBank(unsigned int frames)
+{
+  flasherBank<N> bank;
+  uint16_t pwms[16];
+
+  for (byte i = 0; i < N; i++)
+  {
+    bank.setPattern(i, PatternOf(i));
+    bank.setDelay(i, DelayOf(i));
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int f = 0; f < frames; f++)
+  {
+    AdvanceClock(10000);
+    bank.update(pwms);
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  TEST_ASSERT_TRUE(pwms[0] <= 4095);
+  return std::chrono::duration<double, std::nano>(end - start).count() / frames / N;
+}
+
+template <byte N>
+void Benchmark()
+{
+  const unsigned int frames = 200000;
+  char line[120];
+
+  // The clock reads and the RAM are what carry over to the AVR, the host timings only hint.
+  clockReads = 0;
+  double flashers = TimeFlashers<N>(frames);
+  unsigned long flasherReads = clockReads;
+
+  clockReads = 0;
+  double bank = TimeBank<N>(frames);
+  unsigned long bankReads = clockReads;
+
+  snprintf(line, sizeof(line), "N=%2u  flashers %5.1f ns %3u bytes  bank %5.1f ns %3u bytes  clock reads %lu/%lu per frame",
+           N, flashers, (unsigned)(N * sizeof(flasher)), bank, (unsigned)sizeof(flasherBank<N>), flasherReads / frames, bankReads / frames);
+  TEST_MESSAGE(line);
+
+  TEST_ASSERT_EQUAL(N, flasherReads / frames);
+  TEST_ASSERT_EQUAL(1, bankReads / frames);
+  TEST_ASSERT_TRUE(sizeof(flasherBank<N>) < N * sizeof(flasher));
+}
+
+void test_benchmark()
+{
+  Benchmark<6>();
+  Benchmark<12>();
+  Benchmark<15>();
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_bank_matches_flashers);
+  RUN_TEST(test_update_fills_pwms);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
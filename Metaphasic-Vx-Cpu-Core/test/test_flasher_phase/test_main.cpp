@@ -0,0 +1,343 @@
+// Flasher phase: the phase accumulator keeps its period over long runs and uneven call spacing,
+// against the float flasher it replaced, and the host benchmark of the two.
+
+#include <chrono> // Ahead of Arduino.h, whose min() and max() macros break it.
+#include <stdio.h>
+#include <Arduino.h>
+#include <unity.h>
+#include <common.h>
+#include <flasher.h>
+
+// The flasher before the phase accumulator, float steps and a byte sine index, kept as the reference.
+// Random patterns left out, the comparisons below do not use them.
+class floatFlasher
+{
+
+private:
+  Pattern _pattern;
+  int _delay;
+  int _maxPwm;
+  int _pwmValue = 0;
+  float _microsPerStep = 0;
+  unsigned long _oldMicros = FLASHER_CLOCK();
+
+  byte sinIndex = 0;
+  bool toggle = false;
+  bool _endOfCycle = false;
+
+public:
+  floatFlasher(Pattern pattern, int delay, int maxPwm)
+  {
+    _pattern = pattern;
+    _maxPwm = maxPwm;
+    _delay = delay;
+  }
+
+  inline bool endOfCycle()
+  {
+    if (_endOfCycle)
+    {
+      _endOfCycle = false;
+      return true;
+    }
+    return false;
+  }
+
+  int getPwmValue()
+  {
+    unsigned long curMicros = FLASHER_CLOCK();
+
+    if ((curMicros - _oldMicros) > _microsPerStep)
+    {
+      int stepsPassed = (float)(curMicros - _oldMicros) / _microsPerStep;
+
+      if (_pattern == Pattern::Solid)
+      {
+        _pwmValue = _maxPwm;
+      }
+
+      if (_pattern == Pattern::RampUp)
+      {
+        _microsPerStep = 1.0 / (((float)_maxPwm / (float)_delay) / 1000.0);
+        _pwmValue += stepsPassed;
+
+        if (_pwmValue > _maxPwm)
+        {
+          _pwmValue = 0;
+          _endOfCycle = true;
+        }
+      }
+      else if (_pattern == Pattern::Sin)
+      {
+        _microsPerStep = 1.0 / ((180.0 / (float)_delay) / 1000.0);
+        sinIndex += stepsPassed;
+        if (sinIndex > 180)
+        {
+          sinIndex = 0;
+          _endOfCycle = true;
+        }
+        _pwmValue = _maxPwm * sin(radians(sinIndex));
+      }
+      else if (_pattern == Pattern::OnOff)
+      {
+        _microsPerStep = ((float)_delay / 2.0) * 1000.0;
+        toggle = !toggle;
+        _pwmValue = toggle ? _maxPwm : 0;
+      }
+      else if (_pattern == Pattern::Flash)
+      {
+        toggle = !toggle;
+        _microsPerStep = ((float)_delay / 10.0) * 1000.0 * (toggle ? 1 : 9);
+        _pwmValue = toggle ? _maxPwm : 0;
+      }
+
+      _oldMicros = curMicros;
+    }
+
+    return _pwmValue;
+  }
+};
+
+void setUp()
+{
+  SetClock(0, 0);
+  LatchFrameClock();
+  randomSeed(1);
+}
+
+void tearDown()
+{
+}
+
+// One pass of loop() us later.
+void Step(unsigned long us)
+{
+  AdvanceClock(us);
+  LatchFrameClock();
+}
+
+// Phase per microsecond in 1/128ths.
+unsigned long long CycleRate(unsigned long period)
+{
+  uint32_t rate;
+  byte rateFrac;
+  FlasherRate(period, rate, rateFrac);
+  return ((unsigned long long)rate << FLASHER_RATE_FRAC_BITS) + rateFrac;
+}
+
+void test_rate_covers_a_cycle_per_period()
+{
+  // A 1 us period, a 0 ms delay, wraps on every call without a rate.
+  const unsigned long periods[] = {7, 1000, 7919, 400000, 1000000, 3000000, FLASHER_MAX_PERIOD};
+
+  for (byte p = 0; p < sizeof(periods) / sizeof(periods[0]); p++)
+  {
+    // Phase per period in 1/128ths, 2^32 less at most one fraction step per microsecond.
+    unsigned long long cycle = CycleRate(periods[p]);
+    unsigned long long ideal = 1ULL << (32 + FLASHER_RATE_FRAC_BITS);
+    TEST_ASSERT_TRUE(cycle * periods[p] <= ideal);
+    TEST_ASSERT_TRUE(ideal - cycle * periods[p] < periods[p]);
+  }
+}
+
+void test_phase_is_exact_however_time_is_split()
+{
+  unsigned long period = 1000000;
+  uint32_t rate;
+  byte rateFrac;
+  FlasherRate(period, rate, rateFrac);
+
+  // A second in one call, in 1 us calls and in uneven calls all land on the same phase.
+  uint32_t whole = 0, fine = 0, uneven = 0;
+  byte wholeFrac = 0, fineFrac = 0, unevenFrac = 0;
+
+  FlasherAdvance(whole, wholeFrac, rate, rateFrac, period, period / 2);
+  for (unsigned long us = 0; us < period / 2; us++)
+  {
+    FlasherAdvance(fine, fineFrac, rate, rateFrac, period, 1);
+  }
+  for (unsigned long us = 0; us < period / 2;)
+  {
+    unsigned long step = min((unsigned long)random(1, 3000), period / 2 - us);
+    FlasherAdvance(uneven, unevenFrac, rate, rateFrac, period, step);
+    us += step;
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(whole, fine);
+  TEST_ASSERT_EQUAL_UINT32(whole, uneven);
+  TEST_ASSERT_EQUAL(wholeFrac, fineFrac);
+
+  // Half a period is half a cycle, short by under a phase step.
+  TEST_ASSERT_TRUE(FLASHER_PHASE_HALF - whole <= rate);
+}
+
+void test_cycles_do_not_drift()
+{
+  const int delays[] = {7, 400, 1000, 3000};
+
+  for (byte d = 0; d < sizeof(delays) / sizeof(delays[0]); d++)
+  {
+    SetClock(0, 0);
+    LatchFrameClock();
+    flasher sine(Pattern::Sin, delays[d], 255);
+
+    // 100 s of loop() passes 0.5 to 3 ms apart.
+    unsigned long period = delays[d] * 1000UL;
+    unsigned long long rate = CycleRate(period);
+    unsigned long cycles = 0;
+    while (fakeMicros < 100000000UL)
+    {
+      unsigned long step = random(500, 3000);
+      Step(step);
+      sine.getPwmValue();
+
+      if (sine.endOfCycle())
+      {
+        cycles++;
+
+        // The cycle ends on the first pass after the rate completes it, however many came before.
+        unsigned long long end = (((unsigned long long)cycles << (32 + FLASHER_RATE_FRAC_BITS)) + rate - 1) / rate;
+        if (period > 3000)
+        {
+          TEST_ASSERT_TRUE(fakeMicros >= end);
+          TEST_ASSERT_TRUE(fakeMicros - end < step);
+        }
+
+        // The rate rounds down, lagging the ideal by under period^2 / 2^39 us a cycle, 16 us at 3 s.
+        TEST_ASSERT_TRUE(end - (unsigned long long)cycles * period <= cycles * ((period * period >> 39) + 1));
+      }
+    }
+
+    if (period > 3000)
+    {
+      TEST_ASSERT_EQUAL(100000000UL / period, cycles);
+    }
+    else
+    {
+      // Several cycles fall between passes, they end together.
+      TEST_ASSERT_TRUE(cycles > 0);
+    }
+  }
+}
+
+void test_patterns_follow_the_phase()
+{
+  // Quarter and half way through a 1 s cycle.
+  flasher ramp(Pattern::RampUp, 1000, 4095);
+  flasher sine(Pattern::Sin, 1000, 4095);
+  flasher onOff(Pattern::OnOff, 1000, 4095);
+  flasher flash(Pattern::Flash, 1000, 4095);
+
+  Step(99000);
+  TEST_ASSERT_EQUAL(4095, flash.getPwmValue());
+  Step(2000);
+  TEST_ASSERT_EQUAL(0, flash.getPwmValue());
+
+  Step(149000);
+  TEST_ASSERT_INT_WITHIN(1, 1024, ramp.getPwmValue());
+  TEST_ASSERT_INT_WITHIN(2, 2896, sine.getPwmValue()); // sin(45)
+  TEST_ASSERT_EQUAL(4095, onOff.getPwmValue());
+
+  // Just past the half, the phase rounds down.
+  Step(251000);
+  TEST_ASSERT_INT_WITHIN(2, 2052, ramp.getPwmValue());
+  TEST_ASSERT_INT_WITHIN(1, 4095, sine.getPwmValue());
+  TEST_ASSERT_EQUAL(0, onOff.getPwmValue());
+}
+
+// Mean Sin period over 100 s of loop() passes 0.5 to 3 ms apart, in microseconds.
+template <class F>
+double MeasuredPeriod(int delay)
+{
+  SetClock(0, 0);
+  LatchFrameClock();
+  randomSeed(7);
+  F sine(Pattern::Sin, delay, 255);
+
+  unsigned long cycles = 0;
+  unsigned long lastEnd = 0;
+  while (fakeMicros < 100000000UL)
+  {
+    Step(random(500, 3000));
+    sine.getPwmValue();
+    if (sine.endOfCycle())
+    {
+      cycles++;
+      lastEnd = fakeMicros;
+    }
+  }
+
+  return cycles > 0 ? (double)lastEnd / cycles : 0;
+}
+
+// The phase accumulator holds its period to the call spacing spread over the run,
+// the float flasher lost the leftover time of every step.
+#define PERIOD_ERROR_BOUND 0.001
+
+void test_period_error_against_float_flasher()
+{
+  const int delays[] = {400, 1000, 3000};
+  char line[120];
+
+  for (byte d = 0; d < sizeof(delays) / sizeof(delays[0]); d++)
+  {
+    double ideal = delays[d] * 1000.0;
+    double phaseError = fabs(MeasuredPeriod<flasher>(delays[d]) - ideal) / ideal;
+    double floatError = fabs(MeasuredPeriod<floatFlasher>(delays[d]) - ideal) / ideal;
+
+    snprintf(line, sizeof(line), "Sin %4d ms  period error  phase %.4f%%  float %.2f%%", delays[d], phaseError * 100, floatError * 100);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_TRUE(phaseError < PERIOD_ERROR_BOUND);
+    TEST_ASSERT_TRUE(floatError > PERIOD_ERROR_BOUND);
+  }
+}
+
+// Nanoseconds per getPwmValue() with the clock moving 1 ms a call.
+template <class F>
+double TimeCalls(Pattern pattern, unsigned long calls)
+{
+  SetClock(0, 0);
+  LatchFrameClock();
+  F f(pattern, 1000, 255);
+  volatile int value; // Kept, so the calls are not optimized away.
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < calls; i++)
+  {
+    Step(1000);
+    value = f.getPwmValue();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  (void)value;
+  return std::chrono::duration<double, std::nano>(end - start).count() / calls;
+}
+
+void test_benchmark()
+{
+  // The host's FPU makes float cheap, the AVR has none, so the timings are printed, not asserted.
+  const Pattern patterns[] = {Pattern::Sin, Pattern::RampUp, Pattern::OnOff};
+  const char *names[] = {"Sin", "RampUp", "OnOff"};
+  char line[120];
+
+  for (byte p = 0; p < 3; p++)
+  {
+    double phase = TimeCalls<flasher>(patterns[p], 1000000);
+    double floating = TimeCalls<floatFlasher>(patterns[p], 1000000);
+    snprintf(line, sizeof(line), "%-6s  phase %5.1f ns  float %5.1f ns per call", names[p], phase, floating);
+    TEST_MESSAGE(line);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_rate_covers_a_cycle_per_period);
+  RUN_TEST(test_phase_is_exact_however_time_is_split);
+  RUN_TEST(test_cycles_do_not_drift);
+  RUN_TEST(test_patterns_follow_the_phase);
+  RUN_TEST(test_period_error_against_float_flasher);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,366 @@
+// Frame encoding, cut-through relay and CRC inversion of corrupted frames.
+
+#include <chrono> // Ahead of Arduino.h, whose min() and max() macros break it.
+#include <stdio.h>
+#include <Arduino.h>
+#include <unity.h>
+#include <common.h>
+#include <ringTest.h>
+
+// Drains the relay's output through a second decoder, as the next panel would.
+frameDecoder downstream;
+
+const byte *DecodeTx(unsigned int &index)
+{
+  const byte *frame = NULL;
+
+  while (index < txCount && frame == NULL)
+  {
+    frame = downstream.decode(txBytes[index++]);
+  }
+  return frame;
+}
+
+void SendControlFrame()
+{
+  ringForwarding = false;
+  ClearTx();
+  SendControlDataFromMaster(false);
+  DrainTx();
+}
+
+void setUp()
+{
+  ClearTx();
+  ClearRx();
+  ringBaudState = baudDone;
+  ringForwarding = true;
+  activityFlag = false;
+  downstream = frameDecoder();
+  ringDecoder = frameDecoder();
+  state = warning;
+  mode = manualActivity;
+  memset(bootupPanels, 0, sizeof(bootupPanels));
+  bootupPanels[0] = 0xC5;
+}
+
+void tearDown()
+{
+}
+
+void test_stuffed_bytes_round_trip()
+{
+  byte payload[] = {SLIP_END, 1, SLIP_ESC, SLIP_ESC_END, SLIP_END, SLIP_ESC_ESC};
+
+  SendFrame(eventFrame, payload, sizeof(payload));
+  DrainTx();
+
+  // Delimiters only appear at either end.
+  for (unsigned int i = 1; i + 1 < txCount; i++)
+  {
+    TEST_ASSERT_TRUE(txBytes[i] != SLIP_END);
+  }
+
+  unsigned int index = 0;
+  const byte *frame = DecodeTx(index);
+  TEST_ASSERT_NOT_NULL(frame);
+  TEST_ASSERT_EQUAL(eventFrame, FrameType(frame));
+  TEST_ASSERT_EQUAL(sizeof(payload), FrameLength(frame));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, FramePayload(frame), sizeof(payload));
+}
+
+void test_relay_patches_control_frame()
+{
+  SendControlFrame();
+  byte sent[TEST_TX_CAPACITY];
+  unsigned int sentCount = txCount;
+  memcpy(sent, txBytes, txCount);
+
+  ringForwarding = true;
+  activityFlag = true;
+  ClearTx();
+  ReceiveBytes(sent, sentCount);
+
+  unsigned int index = 0;
+  const byte *frame = DecodeTx(index);
+  TEST_ASSERT_NOT_NULL(frame);
+  TEST_ASSERT_EQUAL(controlFrame, FrameType(frame));
+  TEST_ASSERT_EQUAL(warning, FramePayload(frame)[controlState]);
+  TEST_ASSERT_EQUAL(0xC5, FramePayload(frame)[controlBootup]);
+  TEST_ASSERT_EQUAL(CONTROL_FLAG_ACTIVITY, FramePayload(frame)[controlFlags]);
+  TEST_ASSERT_EQUAL(1, FramePayload(frame)[controlHops]);
+  TEST_ASSERT_EQUAL(0, downstream.crcErrorCount);
+
+  // The flag left in a valid frame, so it is cleared.
+  TEST_ASSERT_FALSE(activityFlag);
+  TEST_ASSERT_EQUAL(1, ringPosition);
+}
+
+void test_corrupted_frame_relayed_with_inverted_crc()
+{
+  SendControlFrame();
+  byte sent[TEST_TX_CAPACITY];
+  unsigned int sentCount = txCount;
+  memcpy(sent, txBytes, txCount);
+
+  // Flip a bit in the state field, upstream of this panel.
+  sent[3] ^= 0x01;
+
+  ringForwarding = true;
+  activityFlag = true;
+  ClearTx();
+  ReceiveBytes(sent, sentCount);
+
+  // Patched bytes get a fresh CRC, it must not launder the corruption.
+  unsigned int index = 0;
+  TEST_ASSERT_NULL(DecodeTx(index));
+  TEST_ASSERT_EQUAL(1, downstream.crcErrorCount);
+  TEST_ASSERT_EQUAL(sentCount, txCount);
+
+  // The panel itself rejects it, and keeps the flag for the next frame.
+  TEST_ASSERT_NULL(ReadFrame());
+  TEST_ASSERT_EQUAL(1, ringDecoder.crcErrorCount);
+  TEST_ASSERT_TRUE(activityFlag);
+}
+
+void test_relay_strips_own_events()
+{
+  HostPanel(gndnPipelineRelay);
+
+  byte payload[] = {gndnPipelineRelay, 7, 0};
+  ringForwarding = false;
+  SendFrame(eventFrame, payload, sizeof(payload));
+  DrainTx();
+  byte sent[TEST_TX_CAPACITY];
+  unsigned int sentCount = txCount;
+  memcpy(sent, txBytes, txCount);
+
+  ringForwarding = true;
+  ClearTx();
+  ReceiveBytes(sent, sentCount);
+
+  unsigned int index = 0;
+  TEST_ASSERT_NULL(DecodeTx(index));
+  TEST_ASSERT_EQUAL(0, downstream.crcErrorCount);
+  TEST_ASSERT_LESS_THAN(sentCount, txCount);
+
+  hostedPanels[gndnPipelineRelay >> 3] = 0;
+}
+
+// Several frames back to back as they arrive, for damaging before decoding.
+byte stream[3 * FRAME_WIRE_SIZE(RING_FRAME_MAX_PAYLOAD)];
+unsigned int streamLength;
+
+void PutStream(byte c)
+{
+  stream[streamLength++] = c;
+}
+
+void PutStreamStuffed(byte c)
+{
+  if (c == SLIP_END || c == SLIP_ESC)
+  {
+    PutStream(SLIP_ESC);
+    PutStream(c == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC);
+  }
+  else
+  {
+    PutStream(c);
+  }
+}
+
+// Appends a frame whose payload needs stuffing, its bytes count up from first.
+unsigned int AppendFrame(byte first, byte length)
+{
+  byte payload[RING_FRAME_MAX_PAYLOAD];
+
+  for (byte i = 0; i < length; i++)
+  {
+    payload[i] = i % 4 == 1 ? SLIP_END : i % 4 == 3 ? SLIP_ESC : first + i;
+  }
+
+  unsigned int start = streamLength;
+  EncodeFrame(eventFrame, payload, length, PutStreamStuffed, PutStream);
+  return start;
+}
+
+// Feeds the damaged stream through the decoder, then an intact frame.
+// Returns the number of frames decoded and checks the intact one came through.
+byte DecodeDamaged()
+{
+  AppendFrame(0x40, 8);
+
+  byte decoded = 0;
+  const byte *last = NULL;
+
+  for (unsigned int i = 0; i < streamLength; i++)
+  {
+    const byte *frame = downstream.decode(stream[i]);
+
+    if (frame != NULL)
+    {
+      decoded++;
+      last = frame;
+    }
+  }
+
+  // Resynced on the END that closed the damage, the next frame is intact.
+  TEST_ASSERT_NOT_NULL(last);
+  TEST_ASSERT_EQUAL(8, FrameLength(last));
+  TEST_ASSERT_EQUAL(0x40, FramePayload(last)[0]);
+  TEST_ASSERT_EQUAL(SLIP_END, FramePayload(last)[1]);
+  TEST_ASSERT_TRUE(downstream.idle());
+  return decoded;
+}
+
+void RemoveStream(unsigned int index)
+{
+  memmove(stream + index, stream + index + 1, streamLength - index - 1);
+  streamLength--;
+}
+
+void test_truncated_frame_resyncs()
+{
+  streamLength = 0;
+  AppendFrame(0x10, 12);
+  // Cut off after the header, length and a few payload bytes.
+  streamLength -= 8;
+
+  TEST_ASSERT_EQUAL(1, DecodeDamaged());
+  TEST_ASSERT_EQUAL(1, downstream.crcErrorCount);
+}
+
+void test_dropped_bytes_resync()
+{
+  // Each position a byte can drop from, END delimiters aside.
+  for (unsigned int drop = 1; drop < 20; drop++)
+  {
+    downstream = frameDecoder();
+    streamLength = 0;
+    AppendFrame(0x10, 12);
+    TEST_ASSERT_TRUE(drop < streamLength - 1);
+    RemoveStream(drop);
+
+    TEST_ASSERT_EQUAL(1, DecodeDamaged());
+    TEST_ASSERT_EQUAL(1, downstream.crcErrorCount);
+  }
+}
+
+void test_lost_end_resyncs()
+{
+  // A lost closing END is covered by the next frame's leading END.
+  streamLength = 0;
+  AppendFrame(0x10, 12);
+  streamLength--;
+
+  TEST_ASSERT_EQUAL(2, DecodeDamaged());
+  TEST_ASSERT_EQUAL(0, downstream.crcErrorCount);
+
+  // With both lost, two short frames run together and fail the length and CRC.
+  downstream = frameDecoder();
+  streamLength = 0;
+  AppendFrame(0x10, 4);
+  unsigned int second = AppendFrame(0x20, 4);
+  RemoveStream(second);
+  RemoveStream(second - 1);
+
+  TEST_ASSERT_EQUAL(1, DecodeDamaged());
+  TEST_ASSERT_EQUAL(1, downstream.crcErrorCount);
+
+  // Two long frames run together overflow the decoder, that counts too.
+  downstream = frameDecoder();
+  streamLength = 0;
+  AppendFrame(0x10, RING_FRAME_MAX_PAYLOAD);
+  second = AppendFrame(0x20, RING_FRAME_MAX_PAYLOAD);
+  RemoveStream(second);
+  RemoveStream(second - 1);
+
+  TEST_ASSERT_EQUAL(1, DecodeDamaged());
+  TEST_ASSERT_EQUAL(1, downstream.crcErrorCount);
+}
+
+void test_corrupted_escapes_resync()
+{
+  const byte replacements[] = {SLIP_ESC_ESC, SLIP_ESC_END, 0x00, SLIP_ESC};
+
+  for (byte r = 0; r < sizeof(replacements); r++)
+  {
+    downstream = frameDecoder();
+    streamLength = 0;
+    AppendFrame(0x10, 12);
+
+    // The first escaped payload byte, the END at payload offset 1.
+    unsigned int escape = 4;
+    TEST_ASSERT_EQUAL(SLIP_ESC, stream[escape]);
+    TEST_ASSERT_EQUAL(SLIP_ESC_END, stream[escape + 1]);
+
+    if (replacements[r] == SLIP_ESC_END)
+    {
+      // Corrupt the escape code itself instead, the END becomes a plain byte.
+      stream[escape] = 0x00;
+    }
+    else
+    {
+      stream[escape + 1] = replacements[r];
+    }
+
+    TEST_ASSERT_EQUAL(1, DecodeDamaged());
+    TEST_ASSERT_EQUAL(1, downstream.crcErrorCount);
+  }
+}
+
+void test_benchmark()
+{
+  // A control frame's worth of payload, a quarter of it stuffed.
+  const unsigned long frames = 200000;
+  byte payload[ControlFrameLength(RING_PANEL_COUNT)];
+
+  for (byte i = 0; i < sizeof(payload); i++)
+  {
+    payload[i] = i % 4 == 0 ? SLIP_END : i;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long n = 0; n < frames; n++)
+  {
+    streamLength = 0;
+    payload[2] = n;
+    EncodeFrame(controlFrame, payload, sizeof(payload), PutStreamStuffed, PutStream);
+  }
+  auto encoded = std::chrono::steady_clock::now();
+
+  unsigned long decoded = 0;
+  for (unsigned long n = 0; n < frames; n++)
+  {
+    for (unsigned int i = 0; i < streamLength; i++)
+    {
+      decoded += downstream.decode(stream[i]) != NULL;
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  TEST_ASSERT_EQUAL_UINT32(frames, decoded);
+  TEST_ASSERT_EQUAL(0, downstream.crcErrorCount);
+
+  // Host timings vary too much to assert, they are printed to compare changes.
+  double encodeNs = std::chrono::duration<double, std::nano>(encoded - start).count() / frames / streamLength;
+  double decodeNs = std::chrono::duration<double, std::nano>(end - encoded).count() / frames / streamLength;
+  char line[96];
+  snprintf(line, sizeof(line), "%u wire bytes a frame, encode %.1f ns, decode %.1f ns per byte", streamLength, encodeNs, decodeNs);
+  TEST_MESSAGE(line);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_stuffed_bytes_round_trip);
+  RUN_TEST(test_relay_patches_control_frame);
+  RUN_TEST(test_corrupted_frame_relayed_with_inverted_crc);
+  RUN_TEST(test_relay_strips_own_events);
+  RUN_TEST(test_truncated_frame_resyncs);
+  RUN_TEST(test_dropped_bytes_resync);
+  RUN_TEST(test_lost_end_resyncs);
+  RUN_TEST(test_corrupted_escapes_resync);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
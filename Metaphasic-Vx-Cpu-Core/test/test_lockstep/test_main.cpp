@@ -0,0 +1,154 @@
+// Lockstep random streams: panels drawing from the same effect make the same choices.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <common.h>
+#include <ringTest.h>
+
+#define DRAWS 64
+
+void Draw(lockstepRandom &stream, long *values, byte count)
+{
+  for (byte i = 0; i < count; i++)
+  {
+    values[i] = stream.next(1000);
+  }
+}
+
+void setUp()
+{
+  ClearTx();
+  ClearRx();
+  ringBaudState = baudDone;
+  ringForwarding = false;
+  ringSeed = 0x1235;
+  ringEpoch = 7;
+}
+
+void tearDown()
+{
+}
+
+void test_same_effect_same_values()
+{
+  lockstepRandom a(randomErrors);
+  lockstepRandom b(randomErrors);
+  long valuesA[DRAWS];
+  long valuesB[DRAWS];
+
+  Draw(a, valuesA, DRAWS);
+  Draw(b, valuesB, DRAWS);
+  TEST_ASSERT_TRUE(memcmp(valuesA, valuesB, sizeof(valuesA)) == 0);
+}
+
+void test_effects_and_epochs_differ()
+{
+  lockstepRandom a(randomErrors);
+  lockstepRandom b(randomFlux);
+  long valuesA[DRAWS];
+  long valuesB[DRAWS];
+  long valuesC[DRAWS];
+
+  Draw(a, valuesA, DRAWS);
+  Draw(b, valuesB, DRAWS);
+  TEST_ASSERT_FALSE(memcmp(valuesA, valuesB, sizeof(valuesA)) == 0);
+
+  ringEpoch++;
+  lockstepRandom c(randomErrors);
+  Draw(c, valuesC, DRAWS);
+  TEST_ASSERT_FALSE(memcmp(valuesA, valuesC, sizeof(valuesA)) == 0);
+}
+
+void test_back_in_step_next_epoch()
+{
+  lockstepRandom a(randomRadiation);
+  lockstepRandom b(randomRadiation);
+  long values[DRAWS];
+
+  // One panel drew more this epoch, e.g. it booted late.
+  Draw(a, values, 5);
+  Draw(b, values, 11);
+  TEST_ASSERT_FALSE(a.next(1000000) == b.next(1000000));
+
+  ringEpoch++;
+  for (byte i = 0; i < DRAWS; i++)
+  {
+    TEST_ASSERT_EQUAL(a.next(i + 1, 1000), b.next(i + 1, 1000));
+  }
+}
+
+void test_ranges_and_spread()
+{
+  lockstepRandom stream(randomFlux);
+  unsigned int counts[10] = {0};
+
+  for (unsigned int i = 0; i < 10000; i++)
+  {
+    long value = stream.next(20, 30);
+    TEST_ASSERT_TRUE(value >= 20 && value < 30);
+    counts[value - 20]++;
+  }
+
+  for (byte i = 0; i < 10; i++)
+  {
+    TEST_ASSERT_INT_WITHIN(150, 1000, counts[i]);
+  }
+
+  TEST_ASSERT_EQUAL(5, stream.next(5, 5));
+  TEST_ASSERT_EQUAL(0, stream.next(0));
+}
+
+void test_panel_follows_master_seed_and_epoch()
+{
+  // The master draws with its own seed and epoch, then sends them.
+  SetClock(5000, 5000000UL);
+  ringSeed = 0;
+  RingEpochUpdate();
+  TEST_ASSERT_TRUE(ringSeed != 0);
+
+  for (byte i = 0; i < 3; i++)
+  {
+    AdvanceClock(RING_EPOCH_MS * 1000UL);
+    RingEpochUpdate();
+  }
+  TEST_ASSERT_EQUAL(10, ringEpoch);
+
+  lockstepRandom master(randomErrors);
+  bool masterErrors[3];
+  RandomArrayFill(masterErrors, 2, 3, &master);
+  long masterValues[DRAWS];
+  Draw(master, masterValues, DRAWS);
+
+  SendControlDataFromMaster(false);
+  DrainTx();
+  uint16_t seed = ringSeed;
+  uint16_t epoch = ringEpoch;
+
+  // A panel that has not heard from the master yet.
+  ringSeed = 0;
+  ringEpoch = 0;
+  ReceiveBytes(txBytes, txCount);
+  CheckControlData();
+  TEST_ASSERT_EQUAL(seed, ringSeed);
+  TEST_ASSERT_EQUAL(epoch, ringEpoch);
+
+  lockstepRandom panel(randomErrors);
+  bool panelErrors[3];
+  RandomArrayFill(panelErrors, 2, 3, &panel);
+  long panelValues[DRAWS];
+  Draw(panel, panelValues, DRAWS);
+
+  TEST_ASSERT_TRUE(memcmp(masterErrors, panelErrors, sizeof(masterErrors)) == 0);
+  TEST_ASSERT_TRUE(memcmp(masterValues, panelValues, sizeof(masterValues)) == 0);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_same_effect_same_values);
+  RUN_TEST(test_effects_and_epochs_differ);
+  RUN_TEST(test_back_in_step_next_epoch);
+  RUN_TEST(test_ranges_and_spread);
+  RUN_TEST(test_panel_follows_master_seed_and_epoch);
+  return UNITY_END();
+}
@@ -0,0 +1,160 @@
+// Segmented show: a long strip goes out whole while ring bytes keep arriving, without a USART overrun at any rate.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <common.h>
+#include <ringTest.h>
+#include <Adafruit_NeoPixel.h>
+#include <ringPixels.h>
+
+// Torac's circle.
+#define PIXELS 44
+
+// Ring byte phases tried against the start of a show.
+#define PHASES 16
+
+ringPixels strip(PIXELS, 6, NEO_GRB + NEO_KHZ800);
+
+// The next ring byte to complete, arriving back to back at the current rate.
+double byteMicros;
+double nextByteMicros;
+unsigned long bytesLost;
+
+void ReadRingByte(bool overrun)
+{
+  UDR0 = 0x55;
+  UCSR0A = overrun ? _BV(DOR0) : 0;
+  USART_RX_vect();
+}
+
+// Interrupts are on outside a show, bytes are read as they complete.
+void ReadRing(unsigned long now)
+{
+  while (nextByteMicros <= now)
+  {
+    ReadRingByte(false);
+    nextByteMicros += byteMicros;
+  }
+}
+
+// With interrupts off the USART holds two bytes, later ones overrun and the first read carries DOR0.
+void InterruptsOff(unsigned long start, unsigned long end)
+{
+  ReadRing(start);
+
+  byte held = 0;
+  unsigned long lost = 0;
+  while (nextByteMicros <= end)
+  {
+    if (held < 2)
+    {
+      held++;
+    }
+    else
+    {
+      lost++;
+    }
+    nextByteMicros += byteMicros;
+  }
+
+  for (byte i = 0; i < held; i++)
+  {
+    ReadRingByte(i == 0 && lost > 0);
+  }
+  bytesLost += lost;
+}
+
+void StartRing(byte index, byte phase)
+{
+  SetRingBaud(index);
+  byteMicros = 10000000.0 / RingBaudRate(index);
+  nextByteMicros = micros() + byteMicros * phase / PHASES;
+  bytesLost = 0;
+  ringRxOverrunCount = 0;
+  ClearRx();
+}
+
+void setUp()
+{
+  AdvanceClock(10000);
+  neoPixelLineCount = 0;
+  neoPixelLatches = 0;
+  neoPixelShowHook = InterruptsOff;
+
+  for (byte i = 0; i < PIXELS; i++)
+  {
+    strip.setPixelColor(i, i, 100 + i, 200 - i);
+  }
+}
+
+void tearDown()
+{
+  neoPixelShowHook = NULL;
+}
+
+void AssertLineIsStrip(unsigned int offset)
+{
+  for (byte i = 0; i < PIXELS; i++)
+  {
+    TEST_ASSERT_EQUAL(i, neoPixelLine[offset + i * 3]);
+    TEST_ASSERT_EQUAL(100 + i, neoPixelLine[offset + i * 3 + 1]);
+    TEST_ASSERT_EQUAL(200 - i, neoPixelLine[offset + i * 3 + 2]);
+  }
+}
+
+void test_segments_do_not_overrun()
+{
+  for (byte index = 0; index < RING_BAUD_RATE_COUNT; index++)
+  {
+    for (byte phase = 0; phase < PHASES; phase++)
+    {
+      StartRing(index, phase);
+      neoPixelLineCount = 0;
+      neoPixelLatches = 0;
+
+      strip.show();
+      ReadRing(micros());
+
+      TEST_ASSERT_EQUAL(0, bytesLost);
+      TEST_ASSERT_EQUAL(0, ringRxOverrunCount);
+      TEST_ASSERT_EQUAL(PIXELS * 3, neoPixelLineCount);
+      TEST_ASSERT_EQUAL(0, neoPixelLatches);
+      AssertLineIsStrip(0);
+
+      AdvanceClock(1000);
+    }
+  }
+}
+
+// The same strip in one piece, as the library sends it, loses bytes and counts the overrun.
+void test_whole_strip_overruns()
+{
+  StartRing(0, 0);
+
+  strip.Adafruit_NeoPixel::show();
+
+  TEST_ASSERT_TRUE(bytesLost > 0);
+  TEST_ASSERT_EQUAL(1, ringRxOverrunCount);
+}
+
+void test_frames_latch_between_shows()
+{
+  StartRing(0, 0);
+
+  strip.show();
+  strip.show();
+
+  TEST_ASSERT_EQUAL(PIXELS * 3 * 2, neoPixelLineCount);
+  TEST_ASSERT_EQUAL(1, neoPixelLatches);
+  AssertLineIsStrip(0);
+  AssertLineIsStrip(PIXELS * 3);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_segments_do_not_overrun);
+  RUN_TEST(test_whole_strip_overruns);
+  RUN_TEST(test_frames_latch_between_shows);
+  return UNITY_END();
+}
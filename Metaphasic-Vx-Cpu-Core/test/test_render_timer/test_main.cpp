@@ -0,0 +1,83 @@
+// Render timers: animations stepped from render frames keep the rate their delay in milliseconds asks for.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <renderTick.h>
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// Steps over a second of frames.
+unsigned int StepsPerSecond(renderTimer &timer)
+{
+  unsigned int steps = 0;
+
+  for (int frame = 0; frame < RENDER_TICK_HZ; frame++)
+  {
+    steps += timer.steps();
+  }
+
+  return steps;
+}
+
+void test_delays_keep_their_rate()
+{
+  // Around and under the frame period, where a msTimer polled once a frame halves the rate.
+  const int delays[] = {1, 2, 5, 7, 10, 15, 20, 25, 100, 1000};
+
+  for (byte d = 0; d < sizeof(delays) / sizeof(delays[0]); d++)
+  {
+    renderTimer timer(delays[d]);
+    TEST_ASSERT_EQUAL(1000 / delays[d], StepsPerSecond(timer));
+  }
+}
+
+void test_frame_delay_steps_every_frame()
+{
+  renderTimer timer(RENDER_TICK_MS);
+
+  for (int frame = 0; frame < 10; frame++)
+  {
+    TEST_ASSERT_EQUAL(1, timer.steps());
+  }
+}
+
+void test_set_delay_keeps_the_time_left_over()
+{
+  renderTimer timer(25);
+
+  // 30 ms in, one step taken and 5 ms carried.
+  for (int frame = 0; frame < 30 / RENDER_TICK_MS; frame++)
+  {
+    timer.steps();
+  }
+
+  // Down to 10 ms, the carried 5 ms and the next frame make 15 ms, one step.
+  timer.setDelay(10);
+  TEST_ASSERT_EQUAL(1, timer.steps());
+}
+
+void test_short_delays_are_clamped()
+{
+  // Vortex delays go to 0 and below as the nanogain rises.
+  renderTimer timer(0);
+  TEST_ASSERT_EQUAL(RENDER_TICK_MS, timer.steps());
+
+  timer.setDelay(-50);
+  TEST_ASSERT_EQUAL(RENDER_TICK_MS, timer.steps());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_delays_keep_their_rate);
+  RUN_TEST(test_frame_delay_steps_every_frame);
+  RUN_TEST(test_set_delay_keeps_the_time_left_over);
+  RUN_TEST(test_short_delays_are_clamped);
+  return UNITY_END();
+}
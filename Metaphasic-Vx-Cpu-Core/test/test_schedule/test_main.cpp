@@ -0,0 +1,265 @@
+// The master's share of the line: every frame it sends is charged, control frames and blocks wait on it.
+
+#include <algorithm> // Ahead of Arduino.h, whose min() and max() macros break it.
+#include <Arduino.h>
+#include <unity.h>
+#include <common.h>
+#include <ringTest.h>
+
+#define BAUD 57600UL
+
+frameDecoder wireDecoder;
+unsigned int framesOfType[8];
+unsigned long lastControlMillis;
+unsigned long worstControlGap;
+
+// Decodes what the master sent, as the first panel would.
+void CountTx()
+{
+  for (unsigned int i = 0; i < txCount; i++)
+  {
+    const byte *frame = wireDecoder.decode(txBytes[i]);
+
+    if (frame != NULL)
+    {
+      framesOfType[FrameType(frame)]++;
+
+      if (FrameType(frame) == controlFrame)
+      {
+        worstControlGap = max(worstControlGap, millis() - lastControlMillis);
+        lastControlMillis = millis();
+      }
+    }
+  }
+}
+
+// One pass of the master's loop, as the CPU Core runs it.
+void MasterLoop()
+{
+  LatchFrameClock();
+  CheckControlData(true);
+
+  SendBlocksFromMaster();
+
+  if (ringScheduler.due(ControlDataChanged()))
+  {
+    SendControlDataFromMaster(false);
+  }
+  DrainTx();
+}
+
+void setUp()
+{
+  ClearTx();
+  ClearRx();
+  // No panels answer, so the rate is not negotiated.
+  ringBaudState = baudDone;
+  ringBaudCeiling = 0;
+  ringForwarding = false;
+  memset(framesOfType, 0, sizeof(framesOfType));
+  worstControlGap = 0;
+}
+
+void tearDown()
+{
+}
+
+void test_charge_holds_off_control_frames()
+{
+  SetClock(100000, 100000000UL);
+  ringScheduler.sent();
+  AdvanceClock(RING_SEND_MIN_MS * 1000UL);
+  TEST_ASSERT_TRUE(ringScheduler.due(true));
+
+  // A status frame takes its line time four times over at a 25% share.
+  SendStatusFromMaster();
+  unsigned long share = (statusFieldCount + 5) * 10000000UL / BAUD * 100 / RING_SEND_BUDGET_PERCENT;
+
+  AdvanceClock(share - 100);
+  TEST_ASSERT_FALSE(ringScheduler.due(true));
+  TEST_ASSERT_FALSE(ringScheduler.ready());
+
+  AdvanceClock(100);
+  TEST_ASSERT_TRUE(ringScheduler.due(true));
+}
+
+void test_busy_master_stays_in_budget()
+{
+  SetClock(200000, 200000000UL);
+  BeginParams();
+  ClearTx();
+
+  unsigned long start = millis();
+  lastControlMillis = start;
+  unsigned long sentBytes = 0;
+
+  for (unsigned long ms = 0; ms < 20000; ms++)
+  {
+    // Something changes every pass, users are busy on every panel.
+    state = (states)((ms / 3) % 3);
+
+    if (ms % 50 == 0)
+    {
+      PostEvent(metaphasicVxCpuCore, eventButton, ms);
+    }
+
+    if (ms % 1000 == 500)
+    {
+      SendCue(cueSentience);
+    }
+
+    if (ms % 2000 == 1000)
+    {
+      SendStatusFromMaster();
+    }
+
+    if (ms % 5000 == 0)
+    {
+      SetParam(0, ms);
+    }
+
+    MasterLoop();
+    CountTx();
+    sentBytes += txCount;
+    ClearTx();
+    AdvanceClock(1000);
+  }
+
+  unsigned long lineMicros = sentBytes * 10000000ULL / BAUD;
+  unsigned long elapsedMicros = (millis() - start) * 1000UL;
+
+  // Stuffed bytes are not charged, allow a little over.
+  TEST_ASSERT_LESS_OR_EQUAL(elapsedMicros * (RING_SEND_BUDGET_PERCENT + 2) / 100, lineMicros);
+  TEST_ASSERT_GREATER_OR_EQUAL(elapsedMicros * (RING_SEND_BUDGET_PERCENT - 5) / 100, lineMicros);
+
+  // Control frames keep flowing, blocks, cues and status get through.
+  TEST_ASSERT_LESS_OR_EQUAL(RING_KEEPALIVE_MS, worstControlGap);
+  TEST_ASSERT_GREATER_THAN(0, framesOfType[blockFrame]);
+  TEST_ASSERT_EQUAL(40, framesOfType[cueFrame]);
+  TEST_ASSERT_EQUAL(10, framesOfType[statusFrame]);
+  TEST_ASSERT_GREATER_THAN(0, framesOfType[eventFrame]);
+}
+
+// Button-to-reaction latency across the ring, the master changes state and every panel acts on it.
+#define SIM_PANELS 6
+#define SIM_PRESSES 1000
+
+// The sender before the adaptive schedule, a control frame every 100 ms.
+msTimer timerFixedRate(100);
+
+void FixedRateLoop()
+{
+  LatchFrameClock();
+  CheckControlData(true);
+
+  if (timerFixedRate.elapsed())
+  {
+    SendControlDataFromMaster(false);
+  }
+  DrainTx();
+}
+
+// Returns the micros from the state change until the control frame carrying it leaves the master.
+unsigned long TimeToSend(void (*loop)(), unsigned int *frameBytes)
+{
+  state = (states)((state + 1) % 3);
+  unsigned long changed = micros();
+
+  for (;;)
+  {
+    loop();
+
+    for (unsigned int i = 0; i < txCount; i++)
+    {
+      const byte *frame = wireDecoder.decode(txBytes[i]);
+
+      if (frame != NULL && FrameType(frame) == controlFrame && FramePayload(frame)[controlState] == state)
+      {
+        *frameBytes = txCount;
+        ClearTx();
+        return micros() - changed;
+      }
+    }
+    ClearTx();
+    AdvanceClock(1000);
+  }
+}
+
+// Mean and 99th percentile of one sender's latency, in ms.
+void SimulateLatency(void (*loop)(), unsigned long *meanMs, unsigned long *p99Ms)
+{
+  static unsigned long latency[SIM_PRESSES];
+
+  SetClock(300000, 300000000UL);
+  BeginParams();
+  ClearTx();
+  // The clock went back, so charges from the previous run are forgotten.
+  ringScheduler = sendScheduler();
+  timerFixedRate = msTimer(100);
+  // Both senders see the same presses and panels.
+  randomSeed(10);
+
+  // Panels act on a frame at their next loop(), which takes 2-20 ms.
+  unsigned long loopMicros[SIM_PANELS];
+  for (byte p = 0; p < SIM_PANELS; p++)
+  {
+    loopMicros[p] = random(2000, 20001);
+  }
+
+  unsigned long long sum = 0;
+
+  for (unsigned int n = 0; n < SIM_PRESSES; n++)
+  {
+    // Presses land anywhere in the sender's cycle.
+    for (long idle = random(0, 250); idle > 0; idle--)
+    {
+      loop();
+      ClearTx();
+      AdvanceClock(1000);
+    }
+
+    unsigned int frameBytes = 0;
+    unsigned long sendMicros = TimeToSend(loop, &frameBytes);
+    unsigned long worst = 0;
+
+    for (byte p = 0; p < SIM_PANELS; p++)
+    {
+      // The whole frame is on the line to the first panel, each relay adds two bytes.
+      unsigned long arrive = (frameBytes + 2 * p) * 10000000UL / BAUD;
+      worst = max(worst, arrive + (unsigned long)random(0, loopMicros[p]));
+    }
+
+    latency[n] = sendMicros + worst;
+    sum += latency[n];
+  }
+
+  std::sort(latency, latency + SIM_PRESSES);
+  *meanMs = sum / SIM_PRESSES / 1000;
+  *p99Ms = latency[SIM_PRESSES * 99 / 100] / 1000;
+}
+
+void test_latency_against_fixed_rate()
+{
+  unsigned long fixedMean, fixedP99, adaptiveMean, adaptiveP99;
+
+  SimulateLatency(FixedRateLoop, &fixedMean, &fixedP99);
+  SimulateLatency(MasterLoop, &adaptiveMean, &adaptiveP99);
+
+  char message[96];
+  snprintf(message, sizeof(message), "100 ms tick: mean %lu ms, p99 %lu ms; adaptive: mean %lu ms, p99 %lu ms",
+           fixedMean, fixedP99, adaptiveMean, adaptiveP99);
+  TEST_MESSAGE(message);
+
+  // The tick holds a change for 50 ms on average, the schedule only until the last frame's share is paid back.
+  TEST_ASSERT_LESS_THAN(fixedMean / 2, adaptiveMean);
+  TEST_ASSERT_LESS_THAN(fixedP99 - 50, adaptiveP99);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_charge_holds_off_control_frames);
+  RUN_TEST(test_busy_master_stays_in_budget);
+  RUN_TEST(test_latency_against_fixed_rate);
+  return UNITY_END();
+}
@@ -0,0 +1,175 @@
+// Ring clock sync from control frame stamps, through the receive ring's delimiter stamps.
+
+#include <stdio.h>
+#include <Arduino.h>
+#include <unity.h>
+#include <common.h>
+#include <ringTest.h>
+
+#define BAUD 57600
+#define FRAME_MICROS 20000UL
+
+// Master clock rate relative to the panel's, parts per million.
+long masterPpm = 0;
+unsigned long masterOffset = 5000000UL;
+
+// Master's ring time in microseconds at a panel micros() value.
+unsigned long long MasterMicros(unsigned long local)
+{
+  return masterOffset + local + (long long)local * masterPpm / 1000000;
+}
+
+// Panel's ring time in microseconds at a panel micros() value.
+unsigned long long PanelMicros(unsigned long local)
+{
+  unsigned long ms;
+  unsigned int us;
+  RingTimeAt(local, &ms, &us);
+  return (unsigned long long)ms * 1000 + us;
+}
+
+// Encodes a control frame stamped with the master's time now.
+void EncodeControlFrame()
+{
+  byte payload[ControlFrameLength(RING_PANEL_COUNT)];
+  memset(payload, 0, sizeof(payload));
+
+  unsigned long long now = MasterMicros(micros());
+  unsigned long ms = now / 1000;
+  unsigned int us = now % 1000;
+  memcpy(payload + controlTimeMillis, &ms, 4);
+  memcpy(payload + controlTimeMicros, &us, 2);
+  payload[controlPanelCount] = RING_PANEL_COUNT;
+
+  EncodeWire(controlFrame, payload, sizeof(payload));
+}
+
+void setUp()
+{
+  ClearTx();
+  ClearRx();
+  SetClock(0, 0);
+  ringForwarding = false;
+  ringBaudState = baudDone;
+  ringBaudIndex = 0;
+  ringPosition = 0;
+  ringTimeLocked = false;
+  ringDrift = 0;
+  masterPpm = 0;
+}
+
+void tearDown()
+{
+}
+
+void test_stamps_survive_back_to_back_frames()
+{
+  unsigned long closed[RING_STAMP_SLOTS];
+
+  for (byte i = 0; i < RING_STAMP_SLOTS; i++)
+  {
+    EncodeControlFrame();
+    closed[i] = ReceiveWire(BAUD);
+  }
+
+  // loop() was busy for all of them, they are read late.
+  AdvanceClock(5000);
+
+  for (byte i = 0; i < RING_STAMP_SLOTS; i++)
+  {
+    TEST_ASSERT_NOT_NULL(ReadFrame());
+    TEST_ASSERT_EQUAL_UINT32(closed[i], frameRxMicros);
+  }
+  TEST_ASSERT_NULL(ReadFrame());
+}
+
+void test_first_frame_steps_the_clock()
+{
+  EncodeControlFrame();
+  ReceiveWire(BAUD);
+  AdvanceClock(3000);
+  CheckControlData();
+
+  TEST_ASSERT_TRUE(ringTimeLocked);
+  TEST_ASSERT_INT_WITHIN(20, MasterMicros(micros()), PanelMicros(micros()));
+}
+
+// Receives frames every FRAME_MICROS, returns the worst error in the second half once locked.
+long TrackDrift(int frames)
+{
+  long worst = 0;
+
+  for (int frame = 0; frame < frames; frame++)
+  {
+    EncodeControlFrame();
+    ReceiveWire(BAUD);
+
+    // Every other pass loop() is a frame behind.
+    if (frame & 1)
+    {
+      CheckControlData();
+    }
+
+    AdvanceClock(FRAME_MICROS - wireCount * 10000000UL / BAUD);
+
+    long error = (long)(PanelMicros(micros()) - MasterMicros(micros()));
+    if (frame >= frames / 2 && abs(error) > worst)
+    {
+      worst = abs(error);
+    }
+  }
+  return worst;
+}
+
+void test_tracks_master_drift_with_late_reads()
+{
+  masterPpm = 200;
+  long worst = TrackDrift(1000);
+
+  // Cues need the panels within a millisecond of each other.
+  TEST_ASSERT_LESS_OR_EQUAL(20, worst);
+  TEST_ASSERT_INT_WITHIN(40, masterPpm * 1048576L / 1000000, ringDrift);
+
+  // Frames stop, the learnt drift holds the rate for a second.
+  AdvanceClock(1000000UL);
+  TEST_ASSERT_INT_WITHIN(50, MasterMicros(micros()), PanelMicros(micros()));
+}
+
+void test_sweeps_master_drift()
+{
+  // Ceramic resonators are within 0.5%, both ways.
+  const long ppms[] = {-5000, -2000, -1000, -200, -20, 0, 20, 200, 1000, 2000, 5000};
+  long worstOverall = 0;
+  long worstPpm = 0;
+  char line[64];
+
+  for (byte i = 0; i < sizeof(ppms) / sizeof(ppms[0]); i++)
+  {
+    setUp();
+    masterPpm = ppms[i];
+    long worst = TrackDrift(1000);
+
+    snprintf(line, sizeof(line), "%+6ld ppm: worst error %ld us", masterPpm, worst);
+    TEST_MESSAGE(line);
+
+    if (worst >= worstOverall)
+    {
+      worstOverall = worst;
+      worstPpm = masterPpm;
+    }
+  }
+
+  snprintf(line, sizeof(line), "worst residual error %ld us at %+ld ppm", worstOverall, worstPpm);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_LESS_OR_EQUAL(50, worstOverall);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_stamps_survive_back_to_back_frames);
+  RUN_TEST(test_first_frame_steps_the_clock);
+  RUN_TEST(test_tracks_master_drift_with_late_reads);
+  RUN_TEST(test_sweeps_master_drift);
+  return UNITY_END();
+}
@@ -0,0 +1,172 @@
+// Clock wrap: msTimer and flasher keep their timing through the millis() and micros() wraps.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <common.h>
+#include <flasher.h>
+
+#define WRAP 0x100000000ULL
+
+// Moves the virtual clock to ms before the millis() wrap, micros() well clear of its own.
+void StartBeforeWrap(unsigned long ms)
+{
+  SetClock(WRAP - ms, 0);
+  LatchFrameClock();
+}
+
+// One pass of loop() a millisecond later.
+void Step()
+{
+  AdvanceClock(1000);
+  LatchFrameClock();
+}
+
+// Milliseconds relative to the wrap, negative before it.
+long long SinceWrap()
+{
+  return (long long)fakeMillis - (long long)WRAP;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_elapsed_keeps_its_period()
+{
+  const unsigned long delays[] = {0, 1, 10, 500, 1000};
+
+  for (byte d = 0; d < sizeof(delays) / sizeof(delays[0]); d++)
+  {
+    // Timers started at every offset up to a period before the wrap.
+    for (unsigned long start = 1; start <= delays[d] + 2; start += delays[d] / 7 + 1)
+    {
+      StartBeforeWrap(start);
+      msTimer timer(delays[d]);
+      long long last = SinceWrap();
+      unsigned int fired = 0;
+
+      while (SinceWrap() < 3000)
+      {
+        Step();
+        if (timer.elapsed())
+        {
+          TEST_ASSERT_EQUAL(delays[d] + 1, SinceWrap() - last);
+          last = SinceWrap();
+          fired++;
+        }
+      }
+
+      TEST_ASSERT_EQUAL((3000 + start) / (delays[d] + 1), fired);
+    }
+  }
+}
+
+void test_force_trigger_at_the_wrap()
+{
+  for (unsigned long start = 0; start < 3; start++)
+  {
+    StartBeforeWrap(start);
+    msTimer timer(1000);
+
+    timer.ForceTrigger();
+    TEST_ASSERT_TRUE(timer.elapsed());
+    TEST_ASSERT_FALSE(timer.elapsed());
+
+    // Not again for a full period.
+    for (int i = 0; i < 1000; i++)
+    {
+      Step();
+      TEST_ASSERT_FALSE(timer.elapsed());
+    }
+    Step();
+    TEST_ASSERT_TRUE(timer.elapsed());
+  }
+}
+
+void test_reset_and_set_delay_across_the_wrap()
+{
+  StartBeforeWrap(100);
+  msTimer timer(1000);
+
+  // Reset just before the wrap, the period counts from there.
+  for (int i = 0; i < 50; i++)
+  {
+    Step();
+  }
+  timer.resetDelay();
+  long long reset = SinceWrap();
+
+  while (!timer.elapsed())
+  {
+    Step();
+    TEST_ASSERT_TRUE(SinceWrap() - reset <= 1001);
+  }
+  TEST_ASSERT_EQUAL(1001, SinceWrap() - reset);
+
+  // A new delay restarts the timer, the same delay leaves it running.
+  StartBeforeWrap(10);
+  timer.setDelayAndReset(1000);
+  Step();
+  timer.setDelay(200);
+  long long set = SinceWrap();
+  for (int i = 0; i < 100; i++)
+  {
+    Step();
+    timer.setDelay(200);
+  }
+
+  while (!timer.elapsed())
+  {
+    Step();
+  }
+  TEST_ASSERT_EQUAL(201, SinceWrap() - set);
+}
+
+void test_flasher_across_micros_wrap()
+{
+  // micros() wraps 71.6 minutes in, millis() carries on.
+  SetClock(4294967UL - 50, WRAP - 50000);
+  LatchFrameClock();
+  flasher blink(Pattern::OnOff, 10, 255);
+
+  long long lastChange = 0;
+  int lastValue = blink.getPwmValue();
+  unsigned int changes = 0;
+
+  // 102.5 ms, 20 changes every 5 ms clear of the ends.
+  for (int i = 0; i < 1025; i++)
+  {
+    AdvanceClock(100);
+    LatchFrameClock();
+
+    int value = blink.getPwmValue();
+    if (value != lastValue)
+    {
+      long long now = (long long)fakeMicros;
+      if (changes > 0)
+      {
+        // Half of the 10 ms cycle, within one 100 us step.
+        TEST_ASSERT_TRUE(now - lastChange >= 4900 && now - lastChange <= 5100);
+      }
+      lastChange = now;
+      lastValue = value;
+      changes++;
+    }
+  }
+
+  TEST_ASSERT_EQUAL(20, changes);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_elapsed_keeps_its_period);
+  RUN_TEST(test_force_trigger_at_the_wrap);
+  RUN_TEST(test_reset_and_set_delay_across_the_wrap);
+  RUN_TEST(test_flasher_across_micros_wrap);
+  return UNITY_END();
+}
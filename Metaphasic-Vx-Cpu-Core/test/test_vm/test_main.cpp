@@ -0,0 +1,136 @@
+// Ring VM: the assembled effects verify, load from the master and draw, and programs are threaded as verified.
+
+#define RING_VM_COUNT_OPS
+
+#include <Arduino.h>
+#include <unity.h>
+#include <common.h>
+#include <ringTest.h>
+#include <vmPrograms.h>
+#include "../../src/bench/vmBench.h"
+
+#define PIXELS 12
+
+byte pixels[PIXELS][3];
+byte pixelWrites;
+
+void CapturePixel(byte index, byte r, byte g, byte b)
+{
+  TEST_ASSERT_TRUE(index < PIXELS);
+  pixels[index][0] = r;
+  pixels[index][1] = g;
+  pixels[index][2] = b;
+  pixelWrites++;
+}
+
+void setUp()
+{
+  memset(pixels, 0, sizeof(pixels));
+  pixelWrites = 0;
+  SetVmOutputs(CapturePixel, NULL);
+}
+
+void tearDown()
+{
+  LoadVmProgram(vmOff, sizeof(vmOff));
+}
+
+void test_effects_load()
+{
+  uint16_t version = ringBlocks[blockProgram].version;
+
+  TEST_ASSERT_TRUE(LoadVmProgram(vmSweep, sizeof(vmSweep)));
+  TEST_ASSERT_TRUE(VmLoaded());
+  TEST_ASSERT_TRUE(LoadVmProgram(vmPulse, sizeof(vmPulse)));
+  TEST_ASSERT_TRUE(LoadVmProgram(vmOff, sizeof(vmOff)));
+  TEST_ASSERT_FALSE(VmLoaded());
+  TEST_ASSERT_EQUAL(version + 3, ringBlocks[blockProgram].version);
+}
+
+void test_sweep_draws_one_pixel()
+{
+  LoadVmProgram(vmSweep, sizeof(vmSweep));
+
+  // A quarter of the 2400 ms sweep, the head is halfway across.
+  SetClock(600, 600000UL);
+  RunVm();
+
+  TEST_ASSERT_EQUAL(PIXELS, pixelWrites);
+  for (byte i = 0; i < PIXELS; i++)
+  {
+    TEST_ASSERT_EQUAL(i == 5 ? 255 : 0, pixels[i][0]);
+    TEST_ASSERT_EQUAL(0, pixels[i][1]);
+    TEST_ASSERT_EQUAL(0, pixels[i][2]);
+  }
+}
+
+void test_new_program_is_rethreaded()
+{
+  LoadVmProgram(vmSweep, sizeof(vmSweep));
+  RunVm();
+  LoadVmProgram(vmPulse, sizeof(vmPulse));
+
+  // Stable, a 4000 ms breath, at its peak.
+  state = stable;
+  SetClock(2000, 2000000UL);
+  pixelWrites = 0;
+  RunVm();
+
+  TEST_ASSERT_EQUAL(PIXELS, pixelWrites);
+  for (byte i = 0; i < PIXELS; i++)
+  {
+    TEST_ASSERT_EQUAL(0, pixels[i][0]);
+    TEST_ASSERT_EQUAL(254, pixels[i][1]);
+    TEST_ASSERT_EQUAL(254, pixels[i][2]);
+  }
+}
+
+void test_verify_decodes_in_a_line()
+{
+  byte program[RING_VM_PROGRAM_SIZE];
+
+  // Unreached bytes past the end may be anything.
+  memset(program, 0xFF, sizeof(program));
+  program[0] = opEnd;
+  TEST_ASSERT_TRUE(VmVerify(program));
+
+  // A jump into the operand of a push, opEnd there would run if the verifier allowed it.
+  memset(program, opEnd, sizeof(program));
+  program[0] = opJump;
+  program[1] = 1;
+  program[2] = opPush;
+  program[3] = opEnd;
+  TEST_ASSERT_FALSE(VmVerify(program));
+
+  program[1] = 0;
+  TEST_ASSERT_TRUE(VmVerify(program));
+}
+
+void test_bench_op_count()
+{
+  // vmBench.cpp divides by BENCH_OPS for ops per ms on the board, the count must match the program.
+  LoadVmProgram(vmBench, sizeof(vmBench));
+  RunVm();
+
+  ringVmOps = 0;
+  RunVm();
+  TEST_ASSERT_EQUAL_UINT32(683, ringVmOps);
+
+  // The second run sees the registers the first left, and counts the same.
+  ringVmOps = 0;
+  RunVm();
+  TEST_ASSERT_EQUAL_UINT32(683, ringVmOps);
+}
+
+int main(int argc, char **argv)
+{
+  BeginVm();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_effects_load);
+  RUN_TEST(test_sweep_draws_one_pixel);
+  RUN_TEST(test_new_program_is_rethreaded);
+  RUN_TEST(test_verify_decodes_in_a_line);
+  RUN_TEST(test_bench_op_count);
+  return UNITY_END();
+}
@@ -5,8 +5,10 @@
 #include <JC_Button.h>         // https://github.com/JChristensen/JC_Button
 #include <LiquidCrystal_I2C.h> // https://github.com/fdebrabander/Arduino-LiquidCrystal-I2C-library
 #include "common.h"            // Local libary.
-#include "msTimer.h"           // Local libary.
 #include "flasher.h"           // Local libary.
+#include "ringPixels.h"        // Local libary.
+#define TASK_MAX 11
+#include "taskScheduler.h"     // Local libary.
 
 #define PIN_STRIP_GENERATOR 11
 #define PIN_STRIP_ROUND_1 8
@@ -23,13 +25,12 @@
 #define PIN_POT_CORRECTION A7
 #define PIN_MOTOR 3
 
-#define MAX_VERTEX_BRIGHTNESS 85
 
-Adafruit_NeoPixel stripGenerator = Adafruit_NeoPixel(3, PIN_STRIP_GENERATOR, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripVortex1 = Adafruit_NeoPixel(16, PIN_STRIP_ROUND_1, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripVortex2 = Adafruit_NeoPixel(16, PIN_STRIP_ROUND_2, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripVortex3 = Adafruit_NeoPixel(16, PIN_STRIP_ROUND_3, NEO_GRB + NEO_KHZ800);
-Adafruit_NeoPixel stripCircle = Adafruit_NeoPixel(44, PIN_STRIP_CIRCLE, NEO_GRB + NEO_KHZ800);
+ringPixels stripGenerator = ringPixels(3, PIN_STRIP_GENERATOR, NEO_GRB + NEO_KHZ800);
+ringPixels stripVortex1 = ringPixels(16, PIN_STRIP_ROUND_1, NEO_GRB + NEO_KHZ800);
+ringPixels stripVortex2 = ringPixels(16, PIN_STRIP_ROUND_2, NEO_GRB + NEO_KHZ800);
+ringPixels stripVortex3 = ringPixels(16, PIN_STRIP_ROUND_3, NEO_GRB + NEO_KHZ800);
+ringPixels stripCircle = ringPixels(44, PIN_STRIP_CIRCLE, NEO_GRB + NEO_KHZ800);
 
 PCA9685 pwmController1;
 
@@ -55,16 +56,28 @@ struct TuningValues
   int correction;
   signed int oldNanogain;
   signed int oldCorrection;
-  bool updateFlag;
 } tuningValues;
 
-const int vertexBaseSpeed = 160;
 bool stateLUnit = false;
 
+int lcdMessage = 0;
+int abvPercent = 15;
+
+byte taskNewMessage;
+byte taskLcdRefresh;
+byte taskCircleIndex;
+byte taskCircleFade;
+
 void UpdatePWMs()
 {
   uint16_t pwms1[16];
 
+  if (performActivityFlag)
+  {
+    performActivityFlag = false;
+    stateLUnit = !stateLUnit;
+  }
+
   pwms1[5] = controlStates.injection ? maxPwmGenericLed : 0;
   pwms1[6] = controlStates.agitation ? maxPwmGenericLed : 0;
   pwms1[4] = controlStates.supression ? maxPwmGenericLed : 0;
@@ -85,86 +98,71 @@ void UpdatePWMs()
   pwmController1.setChannelsPWM(0, 16, pwms1);
 }
 
-void UpdateLcdDisplay()
+#define LCD_MESSAGES 4
+
+// Automatic activity picks a new message every 2 seconds.
+void NewMessage()
+{
+  ScheduleTask(taskNewMessage, 2000);
+  if (mode == automaticActivity)
+  {
+    lcdMessage = random(0, LCD_MESSAGES);
+  }
+}
+
+// Shows the tuning values at once, and for 5 seconds before the next message.
+void ShowTuningValues()
 {
-  static msTimer timerNewMessage(1000);
-  static msTimer timerLcdRefresh(100);
-  static int message = 0;
-  const int numMessages = 4;
+  lcdMessage = 1;
+  ScheduleTask(taskNewMessage, 5000);
+  ScheduleTask(taskLcdRefresh, 0);
+}
 
-  buttonCycle.read();
+void UpdateAbv()
+{
+  abvPercent = random(25, 30);
+}
 
-  if (buttonCycle.wasPressed())
+void UpdateLcdDisplay()
+{
+  lcd.setCursor(0, 0);
+
+  if (lcdMessage == 0)
   {
-    if (++message > numMessages)
-    {
-      message = 0;
-    }
-    activityFlag = true;
+    lcd.print(F("PCF8574 is OK.  "));
+    lcd.setCursor(0, 1);
+    lcd.print(F("PCA9685 is OK.  "));
   }
 
-  if (timerNewMessage.elapsed())
+  if (lcdMessage == 1)
   {
-    timerNewMessage.setDelay(2000);
-    if (mode == automaticActivity)
-    {
-      message = random(0, numMessages);
-    }
+    char buf[20];
+    sprintf(buf, "Nanogain: %02unX/s", tuningValues.nanogain);
+    lcd.print(buf);
+    lcd.setCursor(0, 1);
+    sprintf(buf, "C. Corr.: %02upY/m", tuningValues.correction);
+    lcd.print(buf);
   }
 
-  if (timerLcdRefresh.elapsed() || tuningValues.updateFlag)
+  if (lcdMessage == 2)
   {
+    lcd.print(F("Morty status:   "));
+    lcd.setCursor(0, 1);
+    if (state == stable)
+      lcd.print(F("Mellow          "));
+    if (state == warning)
+      lcd.print(F("Annoying        "));
+    if (state == critical)
+      lcd.print(F("Freaking out!   "));
+  }
 
-    if (tuningValues.updateFlag)
-    {
-      timerNewMessage.setDelayAndReset(5000);
-      tuningValues.updateFlag = false;
-      message = 1;
-    }
-
-    lcd.setCursor(0, 0);
-
-    if (message == 0)
-    {
-      lcd.print(F("PCF8574 is OK.  "));
-      lcd.setCursor(0, 1);
-      lcd.print(F("PCA9685 is OK.  "));
-    }
-
-    if (message == 1)
-    {
-      char buf[20];
-      sprintf(buf, "Nanogain: %02unX/s", tuningValues.nanogain);
-      lcd.print(buf);
-      lcd.setCursor(0, 1);
-      sprintf(buf, "C. Corr.: %02upY/m", tuningValues.correction);
-      lcd.print(buf);
-    }
-
-    if (message == 2)
-    {
-      lcd.print(F("Morty status:   "));
-      lcd.setCursor(0, 1);
-      if (state == stable)
-        lcd.print(F("Mellow          "));
-      if (state == warning)
-        lcd.print(F("Annoying        "));
-      if (state == critical)
-        lcd.print(F("Freaking out!   "));
-    }
-
-    if (message == 3)
-    {
-      static int abvPercent = 15;
-      static msTimer timerAbv(2000);
-      if (timerAbv.elapsed())
-        abvPercent = random(25, 30);
-      lcd.print(F("*** Warning *** "));
-      lcd.setCursor(0, 1);
-      lcd.print(F("ABV below 0."));
-      lcd.print(abvPercent, DEC);
-      lcd.print(F("%!"));
-    }
+  if (lcdMessage == 3)
+  {
+    lcd.print(F("*** Warning *** "));
+    lcd.setCursor(0, 1);
+    lcd.print(F("ABV below 0."));
+    lcd.print(abvPercent, DEC);
+    lcd.print(F("%!"));
   }
 }
 
@@ -182,11 +180,22 @@ void UpdateMotor()
 
 void CheckButtons()
 {
+  buttonCycle.read();
   buttonInjection.read();
   buttonAgitation.read();
   buttonSuppression.read();
   buttonPlumbus.read();
 
+  if (buttonCycle.wasPressed())
+  {
+    if (++lcdMessage > LCD_MESSAGES)
+    {
+      lcdMessage = 0;
+    }
+    activityFlag = true;
+    PostEvent(polychromaticToracVertex, eventButton + 4, lcdMessage);
+  }
+
   if (buttonInjection.wasPressed())
   {
     controlStates.injection = !controlStates.injection;
@@ -196,6 +205,7 @@ void CheckButtons()
       controlStates.agitation = false;
     }
     activityFlag = true;
+    PostEvent(polychromaticToracVertex, eventButton, controlStates.injection);
   }
 
   if (buttonAgitation.wasPressed())
@@ -207,18 +217,21 @@ void CheckButtons()
       controlStates.injection = true;
     }
     activityFlag = true;
+    PostEvent(polychromaticToracVertex, eventButton + 1, controlStates.agitation);
   }
 
   if (buttonSuppression.wasPressed())
   {
     controlStates.supression = !controlStates.supression;
     activityFlag = true;
+    PostEvent(polychromaticToracVertex, eventButton + 2, controlStates.supression);
   }
 
   if (buttonPlumbus.wasPressed())
   {
     controlStates.plumbus = !controlStates.plumbus;
     activityFlag = true;
+    PostEvent(polychromaticToracVertex, eventButton + 3, controlStates.plumbus);
   }
 }
 
@@ -230,33 +243,44 @@ void CheckPotentiometers()
   if (tuningValues.nanogain > tuningValues.oldNanogain + 1 ||
       tuningValues.nanogain < tuningValues.oldNanogain - 1)
   {
-    tuningValues.updateFlag = true;
+    ShowTuningValues();
     tuningValues.oldNanogain = tuningValues.nanogain;
     activityFlag = true;
+    PostEvent(polychromaticToracVertex, eventPot, tuningValues.nanogain);
   }
 
   if (tuningValues.correction > tuningValues.oldCorrection + 1 ||
       tuningValues.correction < tuningValues.oldCorrection - 1)
   {
-    tuningValues.updateFlag = true;
+    ShowTuningValues();
     tuningValues.oldCorrection = tuningValues.correction;
     activityFlag = true;
+    PostEvent(polychromaticToracVertex, eventPot + 1, tuningValues.correction);
   }
+
+  byte inputs = buttonInjection.isPressed() | (buttonAgitation.isPressed() << 1) | (buttonSuppression.isPressed() << 2) | (buttonPlumbus.isPressed() << 3);
+  SetPanelInputs(polychromaticToracVertex, inputs, tuningValues.nanogain);
 }
 
 void UpdateVortexStrip1()
 {
-  static msTimer timerVortex(100);
+  static renderTimer timerVortex(100);
   static int pixelIndex;
   static byte wheelVortex;
   int pixelOffset = 0;
 
-  stripVortex1.setBrightness(MAX_VERTEX_BRIGHTNESS);
+  stripVortex1.setBrightness(Param(paramVertexBrightness));
 
-  if (timerVortex.elapsed())
+  timerVortex.setDelay((int)Param(paramVertexBaseSpeed) - (tuningValues.nanogain * 10));
+  byte steps = timerVortex.steps();
+
+  if (steps == 0)
   {
-    timerVortex.setDelay(vertexBaseSpeed - (tuningValues.nanogain * 10));
+    return;
+  }
 
+  while (steps--)
+  {
     if (controlStates.agitation)
     {
       wheelVortex = random(0, 256);
@@ -299,23 +323,29 @@ void UpdateVortexStrip1()
         }
       }
     }
-    stripVortex1.show();
   }
+  stripVortex1.show();
 }
 
 void UpdateVortexStrip2()
 {
-  static msTimer timerVortex(100);
+  static renderTimer timerVortex(100);
   static int pixelIndex;
   static byte wheelVortex;
   int pixelOffset = 5;
 
-  stripVortex2.setBrightness(MAX_VERTEX_BRIGHTNESS);
+  stripVortex2.setBrightness(Param(paramVertexBrightness));
 
-  if (timerVortex.elapsed())
+  timerVortex.setDelay((int)Param(paramVertexBaseSpeed) - (tuningValues.nanogain * 10));
+  byte steps = timerVortex.steps();
+
+  if (steps == 0)
   {
-    timerVortex.setDelay(vertexBaseSpeed - (tuningValues.nanogain * 10));
+    return;
+  }
 
+  while (steps--)
+  {
     if (controlStates.agitation)
     {
       wheelVortex = random(0, 256);
@@ -360,23 +390,29 @@ void UpdateVortexStrip2()
         }
       }
     }
-    stripVortex2.show();
   }
+  stripVortex2.show();
 }
 
 void UpdateVortexStrip3()
 {
-  static msTimer timerVortex(100);
+  static renderTimer timerVortex(100);
   static int pixelIndex;
   static byte wheelVortex;
   int pixelOffset = 10;
 
-  stripVortex3.setBrightness(MAX_VERTEX_BRIGHTNESS);
+  stripVortex3.setBrightness(Param(paramVertexBrightness));
 
-  if (timerVortex.elapsed())
+  timerVortex.setDelay((int)Param(paramVertexBaseSpeed) - (tuningValues.nanogain * 10));
+  byte steps = timerVortex.steps();
+
+  if (steps == 0)
   {
-    timerVortex.setDelay(vertexBaseSpeed - (tuningValues.nanogain * 10));
+    return;
+  }
 
+  while (steps--)
+  {
     if (controlStates.agitation)
     {
       wheelVortex = random(0, 256);
@@ -421,8 +457,8 @@ void UpdateVortexStrip3()
         }
       }
     }
-    stripVortex3.show();
   }
+  stripVortex3.show();
 }
 
 void UpdateVertexAllWarning()
@@ -432,6 +468,15 @@ void UpdateVertexAllWarning()
   static flasher flasherVertex2(Pattern::Sin, 1000, 255);
   static flasher flasherVertex3(Pattern::Sin, 1050, 255);
   static int oldPwmValue1, oldPwmValue2, oldPwmValue3;
+  static renderTimer timerWheel(10);
+  static byte wheelPos = 0;
+
+  // Turned every frame, the strips only pick up the color as their flashers change.
+  wheelPos += timerWheel.steps();
+
+  flasherVertex1.tick(FrameMicros());
+  flasherVertex2.tick(FrameMicros());
+  flasherVertex3.tick(FrameMicros());
 
   static int fillStart1, count1;
   static int fillStart2, count2;
@@ -447,9 +492,9 @@ void UpdateVertexAllWarning()
     count3 = count1;
   }
 
-  if (oldPwmValue1 != flasherVertex1.getPwmValue())
+  if (oldPwmValue1 != flasherVertex1.value())
   {
-    oldPwmValue1 = flasherVertex1.getPwmValue();
+    oldPwmValue1 = flasherVertex1.value();
 
     if ((controlStates.plumbus && flasherVertex1.endOfCycle()) ||
         (!controlStates.plumbus && random(0, maxRandForSupression) == 0))
@@ -460,28 +505,21 @@ void UpdateVertexAllWarning()
 
     if (controlStates.injection)
     {
-      static msTimer timerWheel(10);
-      static byte wheelPos = 0;
-
-      if (timerWheel.elapsed())
-      {
-        wheelPos++;
-      }
       stripVortex1.fill(Wheel(wheelPos), fillStart1, count1);
-      int brightness = map(flasherVertex1.getPwmValue(), 0, 255, 0, MAX_VERTEX_BRIGHTNESS);
+      int brightness = map(flasherVertex1.value(), 0, 255, 0, Param(paramVertexBrightness));
       stripVortex1.setBrightness(brightness);
     }
     else
     {
-      stripVortex1.fill(Color(flasherVertex1.getPwmValue(), 0, 0), fillStart1, count1);
-      stripVortex1.setBrightness(MAX_VERTEX_BRIGHTNESS);
+      stripVortex1.fill(Color(flasherVertex1.value(), 0, 0), fillStart1, count1);
+      stripVortex1.setBrightness(Param(paramVertexBrightness));
     }
     stripVortex1.show();
   }
 
-  if (oldPwmValue2 != flasherVertex2.getPwmValue())
+  if (oldPwmValue2 != flasherVertex2.value())
   {
-    oldPwmValue2 = flasherVertex2.getPwmValue();
+    oldPwmValue2 = flasherVertex2.value();
 
     if ((controlStates.plumbus && flasherVertex2.endOfCycle()) ||
         (!controlStates.plumbus && random(0, maxRandForSupression) == 0))
@@ -492,27 +530,20 @@ void UpdateVertexAllWarning()
 
     if (controlStates.injection)
     {
-      static msTimer timerWheel(10);
-      static byte wheelPos = 0;
-
-      if (timerWheel.elapsed())
-      {
-        wheelPos++;
-      }
       stripVortex2.fill(Wheel(wheelPos), fillStart2, count2);
-      int brightness = map(flasherVertex2.getPwmValue(), 0, 255, 0, MAX_VERTEX_BRIGHTNESS);
+      int brightness = map(flasherVertex2.value(), 0, 255, 0, Param(paramVertexBrightness));
       stripVortex2.setBrightness(brightness);
     }
     else
     {
-      stripVortex2.fill(Color(flasherVertex2.getPwmValue(), 0, 0), fillStart2, count2);
-      stripVortex2.setBrightness(MAX_VERTEX_BRIGHTNESS);
+      stripVortex2.fill(Color(flasherVertex2.value(), 0, 0), fillStart2, count2);
+      stripVortex2.setBrightness(Param(paramVertexBrightness));
     }
     stripVortex2.show();
   }
-  if (oldPwmValue3 != flasherVertex3.getPwmValue())
+  if (oldPwmValue3 != flasherVertex3.value())
   {
-    oldPwmValue3 = flasherVertex3.getPwmValue();
+    oldPwmValue3 = flasherVertex3.value();
 
     if ((controlStates.plumbus && flasherVertex3.endOfCycle()) ||
         (!controlStates.plumbus && random(0, maxRandForSupression) == 0))
@@ -523,21 +554,14 @@ void UpdateVertexAllWarning()
 
     if (controlStates.injection)
     {
-      static msTimer timerWheel(10);
-      static byte wheelPos = 0;
-
-      if (timerWheel.elapsed())
-      {
-        wheelPos++;
-      }
       stripVortex3.fill(Wheel(wheelPos), fillStart3, count3);
-      int brightness = map(flasherVertex3.getPwmValue(), 0, 255, 0, MAX_VERTEX_BRIGHTNESS);
+      int brightness = map(flasherVertex3.value(), 0, 255, 0, Param(paramVertexBrightness));
       stripVortex3.setBrightness(brightness);
     }
     else
     {
-      stripVortex3.fill(Color(flasherVertex3.getPwmValue(), 0, 0), fillStart3, count3);
-      stripVortex3.setBrightness(MAX_VERTEX_BRIGHTNESS);
+      stripVortex3.fill(Color(flasherVertex3.value(), 0, 0), fillStart3, count3);
+      stripVortex3.setBrightness(Param(paramVertexBrightness));
     }
     stripVortex3.show();
   }
@@ -550,9 +574,9 @@ void UpdateVertexAllCritical()
   static flasher flasherVertex3(Pattern::RandomFlash, 750, 255);
   static int oldPwmValue1, oldPwmValue2, oldPwmValue3;
 
-  stripVortex1.setBrightness(MAX_VERTEX_BRIGHTNESS);
-  stripVortex2.setBrightness(MAX_VERTEX_BRIGHTNESS);
-  stripVortex3.setBrightness(MAX_VERTEX_BRIGHTNESS);
+  stripVortex1.setBrightness(Param(paramVertexBrightness));
+  stripVortex2.setBrightness(Param(paramVertexBrightness));
+  stripVortex3.setBrightness(Param(paramVertexBrightness));
 
   if (controlStates.supression)
   {
@@ -567,47 +591,51 @@ void UpdateVertexAllCritical()
     flasherVertex3.setPattern(Pattern::RandomReverseFlash);
   }
 
-  if (oldPwmValue1 != flasherVertex1.getPwmValue())
+  flasherVertex1.tick(FrameMicros());
+  flasherVertex2.tick(FrameMicros());
+  flasherVertex3.tick(FrameMicros());
+
+  if (oldPwmValue1 != flasherVertex1.value())
   {
-    oldPwmValue1 = flasherVertex1.getPwmValue();
+    oldPwmValue1 = flasherVertex1.value();
     if (controlStates.injection)
     {
-      uint32_t color = flasherVertex1.getPwmValue() == flasherVertex1.getMaxPwm() ? Wheel(random(0, 256)) : 0;
+      uint32_t color = flasherVertex1.value() == flasherVertex1.getMaxPwm() ? Wheel(random(0, 256)) : 0;
       stripVortex1.fill(color, 0, stripVortex1.numPixels());
     }
     else
     {
-      stripVortex1.fill(Color(flasherVertex1.getPwmValue(), 0, 0), 0, stripVortex1.numPixels());
+      stripVortex1.fill(Color(flasherVertex1.value(), 0, 0), 0, stripVortex1.numPixels());
     }
     stripVortex1.show();
   }
 
-  if (oldPwmValue2 != flasherVertex2.getPwmValue())
+  if (oldPwmValue2 != flasherVertex2.value())
   {
-    oldPwmValue2 = flasherVertex2.getPwmValue();
+    oldPwmValue2 = flasherVertex2.value();
     if (controlStates.injection)
     {
-      uint32_t color = flasherVertex2.getPwmValue() == flasherVertex2.getMaxPwm() ? Wheel(random(0, 256)) : 0;
+      uint32_t color = flasherVertex2.value() == flasherVertex2.getMaxPwm() ? Wheel(random(0, 256)) : 0;
       stripVortex2.fill(color, 0, stripVortex2.numPixels());
     }
     else
     {
-      stripVortex2.fill(Color(0, flasherVertex2.getPwmValue(), 0), 0, stripVortex2.numPixels());
+      stripVortex2.fill(Color(0, flasherVertex2.value(), 0), 0, stripVortex2.numPixels());
     }
     stripVortex2.show();
   }
 
-  if (oldPwmValue3 != flasherVertex3.getPwmValue())
+  if (oldPwmValue3 != flasherVertex3.value())
   {
-    oldPwmValue3 = flasherVertex3.getPwmValue();
+    oldPwmValue3 = flasherVertex3.value();
     if (controlStates.injection)
     {
-      uint32_t color = flasherVertex3.getPwmValue() == flasherVertex3.getMaxPwm() ? Wheel(random(0, 256)) : 0;
+      uint32_t color = flasherVertex3.value() == flasherVertex3.getMaxPwm() ? Wheel(random(0, 256)) : 0;
       stripVortex3.fill(color, 0, stripVortex3.numPixels());
     }
     else
     {
-      stripVortex3.fill(Color(0, 0, flasherVertex3.getPwmValue()), 0, stripVortex3.numPixels());
+      stripVortex3.fill(Color(0, 0, flasherVertex3.value()), 0, stripVortex3.numPixels());
     }
     stripVortex3.show();
   }
@@ -615,32 +643,33 @@ void UpdateVertexAllCritical()
 
 void UpdateGenerator()
 {
-  static flasher flasherGenerator(Pattern::Sin, 1000, 255);
-  flasherGenerator.setDelay(2000 - (tuningValues.nanogain * 100));
-  stripGenerator.fill(stripGenerator.Color(0, 0, flasherGenerator.getPwmValue()), 0, stripGenerator.numPixels());
+  // Phased to the ring clock so the generator pulses with the other panels.
+  int pwmValue = RingSinPwm(2000 - (tuningValues.nanogain * 100), 255);
+  stripGenerator.fill(stripGenerator.Color(0, 0, pwmValue), 0, stripGenerator.numPixels());
   stripGenerator.show();
 }
 
+// Automatic activity presses the buttons itself every 4 seconds.
 void UpdateControlStates()
 {
-  static msTimer timerActive(4000);
-  if (timerActive.elapsed())
+  if (mode != automaticActivity)
   {
+    return;
+  }
 
-    controlStates.injection = random(0, 2) == 0 ? true : false;
-
-    if (controlStates.injection)
-    {
-      controlStates.agitation = random(0, 2) == 0 ? true : false;
-    }
-    else
-    {
-      controlStates.agitation = false;
-    }
+  controlStates.injection = random(0, 2) == 0 ? true : false;
 
-    controlStates.supression = random(0, 2) == 0 ? true : false;
-    controlStates.plumbus = random(0, 2) == 0 ? true : false;
+  if (controlStates.injection)
+  {
+    controlStates.agitation = random(0, 2) == 0 ? true : false;
   }
+  else
+  {
+    controlStates.agitation = false;
+  }
+
+  controlStates.supression = random(0, 2) == 0 ? true : false;
+  controlStates.plumbus = random(0, 2) == 0 ? true : false;
 }
 
 void CheckToggle()
@@ -652,6 +681,7 @@ void CheckToggle()
   {
     oldBreakState = breakState;
     activityFlag = true;
+    PostEvent(polychromaticToracVertex, eventToggle, breakState);
   }
 }
 
@@ -684,41 +714,96 @@ void ShutdownPanel()
   pwmController1.setChannelsPWM(0, 16, pwms1);
 }
 
-void UpdateCenterCircle()
+// The center circle's head steps round, and its trail fades, faster as the nanogain rises.
+void AdvanceCenterCircle()
 {
-  static msTimer timerFade(5);
   static byte wheelPos;
-  static msTimer timerIndex(100);
   static signed int index = 0;
 
-  timerFade.setDelay(6 - map(tuningValues.nanogain, 0, 10, 1, 5));
-  timerIndex.setDelay(101 - map(tuningValues.nanogain, 0, 10, 25, 100));
+  ScheduleTask(taskCircleIndex, 101 - map(tuningValues.nanogain, 0, 10, 25, 100));
 
-  if (timerIndex.elapsed())
+  if (--index < 0)
   {
-    if (--index < 0)
-    {
-      index = stripCircle.numPixels() -1;
-    }
+    index = stripCircle.numPixels() -1;
+  }
+
+  wheelPos += 1 + tuningValues.correction;
+  stripCircle.setPixelColor(index, Wheel(wheelPos));
+}
 
-    wheelPos += 1 + tuningValues.correction;
-    stripCircle.setPixelColor(index, Wheel(wheelPos));
+void FadeCenterCircle()
+{
+  ScheduleTask(taskCircleFade, 6 - map(tuningValues.nanogain, 0, 10, 1, 5));
+
+  for (int i = 0; i < (int)stripCircle.numPixels(); i++)
+  {
+    stripCircle.setPixelColor(i, Fade(stripCircle.getPixelColor(i), 3));
   }
 
-  if (timerFade.elapsed())
+  stripCircle.show();
+}
+
+void PerformActivity(byte source, byte id, byte value)
+{
+  performActivityFlag = true;
+}
+
+// The CPU core's buttons and toggle switch the L-unit.
+const eventHandler eventHandlers[] PROGMEM = {
+    {metaphasicVxCpuCore, 0, 0, PerformActivity}};
+
+void CueActivity(byte cue)
+{
+  performActivityFlag = true;
+}
+
+// Sentience sweeps across the wall then flashes every panel, an abort flashes them together.
+const cueStep cueSteps[] PROGMEM = {
+    {cueSentience, 600, CueActivity},
+    {cueSentience, 1500, CueActivity},
+    {cueAbort, 0, CueActivity}};
+
+// The panel is held dark until it is booted.
+void CheckBootup()
+{
+  if (!IsPanelBootup(polychromaticToracVertex))
   {
-    for (int i = 0; i < (int)stripCircle.numPixels(); i++)
-    {
-      stripCircle.setPixelColor(i, Fade(stripCircle.getPixelColor(i), 3));
-    }
+    ShutdownPanel();
+  }
+}
+
+// Generator and vortex strips, run once per render frame so their speed no longer follows the LCD's refresh.
+void RenderPanel()
+{
+  if (!IsPanelBootup(polychromaticToracVertex))
+  {
+    return;
+  }
 
-    stripCircle.show();
+  UpdateGenerator();
+
+  if (state == stable)
+  {
+    UpdateVortexStrip1();
+    UpdateVortexStrip2();
+    UpdateVortexStrip3();
+  }
+  else if (state == warning)
+  {
+    UpdateVertexAllWarning();
+  }
+  else if (state == critical)
+  {
+    UpdateVertexAllCritical();
   }
 }
 
 void setup()
 {
-  Serial.begin(BAUD_RATE);
+  BeginControlData();
+  HostPanel(polychromaticToracVertex);
+  SetEventHandlers(eventHandlers, sizeof(eventHandlers) / sizeof(eventHandlers[0]));
+  SetCueSteps(cueSteps, sizeof(cueSteps) / sizeof(cueSteps[0]));
 
   pinMode(PIN_MOTOR, OUTPUT);
   pinMode(PIN_TOGGLE_BRAKE, INPUT);
@@ -730,9 +815,9 @@ void setup()
   buttonSuppression.begin();
   buttonPlumbus.begin();
 
-  stripVortex1.setBrightness(MAX_VERTEX_BRIGHTNESS);
-  stripVortex2.setBrightness(MAX_VERTEX_BRIGHTNESS);
-  stripVortex3.setBrightness(MAX_VERTEX_BRIGHTNESS);
+  stripVortex1.setBrightness(Param(paramVertexBrightness));
+  stripVortex2.setBrightness(Param(paramVertexBrightness));
+  stripVortex3.setBrightness(Param(paramVertexBrightness));
 
   stripGenerator.begin();
   stripVortex1.begin();
@@ -746,56 +831,31 @@ void setup()
   pwmController1.setPWMFrequency(1500);
 
   lcd.begin(20, 4);
+
+  AddTask(CheckBootup, TASK_FRAME_MS);
+  AddPanelTask(polychromaticToracVertex, UpdateMotor, TASK_FRAME_MS);
+  AddPanelTask(polychromaticToracVertex, CheckButtons, TASK_FRAME_MS);
+  AddPanelTask(polychromaticToracVertex, CheckPotentiometers, TASK_FRAME_MS);
+  AddPanelTask(polychromaticToracVertex, UpdatePWMs, TASK_FRAME_MS);
+  taskNewMessage = AddPanelTask(polychromaticToracVertex, NewMessage, 1000, 1000);
+  taskLcdRefresh = AddPanelTask(polychromaticToracVertex, UpdateLcdDisplay, 100, 100);
+  AddPanelTask(polychromaticToracVertex, UpdateAbv, 2000, 2000);
+  AddPanelTask(polychromaticToracVertex, UpdateControlStates, 4000, 4000);
+  taskCircleIndex = AddPanelTask(polychromaticToracVertex, AdvanceCenterCircle, 100, 100);
+  taskCircleFade = AddPanelTask(polychromaticToracVertex, FadeCenterCircle, 5, 5);
+  BeginRenderTick();
 }
 
 void loop()
 {
-  CheckControlData();
-
-  if (IsPanelBootup(polychromaticToracVertex))
-  {
-    if (performActivityFlag)
-    {
-      performActivityFlag = false;
-      stateLUnit = !stateLUnit;
-    }
-
-    UpdateMotor();
-
-    CheckButtons();
-
-    CheckPotentiometers();
+  LatchFrameClock();
 
-    UpdatePWMs();
-
-    UpdateLcdDisplay();
-
-    UpdateGenerator();
-
-    if (state == stable)
-    {
-      UpdateVortexStrip1();
-      UpdateVortexStrip2();
-      UpdateVortexStrip3();
-    }
-    else if (state == warning)
-    {
-      UpdateVertexAllWarning();
-    }
-    else if (state == critical)
-    {
-      UpdateVertexAllCritical();
-    }
-
-    if (mode == automaticActivity)
-    {
-      UpdateControlStates();
-    }
+  CheckControlData();
 
-    UpdateCenterCircle();
-  }
-  else
+  if (RenderTickDue())
   {
-    ShutdownPanel();
+    RenderPanel();
   }
-}
\ No newline at end of file
+
+  RunTasks();
+}
@@ -4,14 +4,40 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+// Panels addressable on the ring, frames only carry the panels in use.
+#define MAX_PANELS 32
+#define PANEL_BITMAP_SIZE ((MAX_PANELS + 7) / 8)
+
+// Largest frame is a control frame addressing MAX_PANELS.
+#define RING_FRAME_MAX_PAYLOAD (20 + MAX_PANELS * 2)
+
+// Panels on this wall, set by the master. Override in the master's build_flags as panels are added.
+#ifndef RING_PANEL_COUNT
+#define RING_PANEL_COUNT 8
+#endif
+
 #include<msTimer.h>
+#include<ringSerial.h>
+#include<ringFrame.h>
+#include<ringTime.h>
+#include<ringStats.h>
+#include<ringSchedule.h>
+#include<ringRandom.h>
+#include<ringBlock.h>
+#include<ringParams.h>
+#include<renderTick.h>
 
 #define BAUD_RATE 57600
 
+#include<ringBaud.h>
+#include<ringCue.h>
+
 // When user interacts with a panel. (presses a button, toggles a switch, adjusts a pot).
-bool activityFlag = false;
+// Read and cleared by the RX interrupt while relaying a control frame.
+volatile bool activityFlag = false;
 
 // Indicates to a panel to perform an activity as feedback to a user interacting with another panel.
+// Set by the panel's event handlers, or by the master on legacy rings. Cleared by the panel.
 bool performActivityFlag = false;
 
 const int startupFlashDelay = 500;
@@ -32,19 +58,31 @@ enum modes
 } mode;
 
 // Controls panel bootup (determined by the master panel).
+// Panel addresses, new panels continue from 8 up to MAX_PANELS - 1.
 enum Panels
 {
-	noPanel = 0,
-	dilithumPowerFrame = 1,
-	metaphasicVxCpuCore = 2,
-	realTimeSystemStatus = 4,
-	gndnPipelineRelay = 8,
-	metaphasicSporation = 16,
-	tachyonSensormaticGrid = 32,
-	biTriaxialForceAlignment = 64,
-	polychromaticToracVertex = 128
+	dilithumPowerFrame = 0,
+	metaphasicVxCpuCore = 1,
+	realTimeSystemStatus = 2,
+	gndnPipelineRelay = 3,
+	metaphasicSporation = 4,
+	tachyonSensormaticGrid = 5,
+	biTriaxialForceAlignment = 6,
+	polychromaticToracVertex = 7
 };
-Panels bootupPanel = noPanel;
+
+// One bit per panel address, lowest address in bit 0 of the first byte.
+byte bootupPanels[PANEL_BITMAP_SIZE];
+
+inline bool PanelBit(const volatile byte *bitmap, byte panel)
+{
+	return bitmap[panel >> 3] & (1 << (panel & 7));
+}
+
+inline void SetPanelBit(volatile byte *bitmap, byte panel)
+{
+	bitmap[panel >> 3] |= 1 << (panel & 7);
+}
 
 const int maxPwmGenericLed = 4095;
 const int maxPwmRedLed = 1000;
@@ -54,105 +92,1124 @@ const int maxPwmYellowLed = 4095;
 
 bool IsPanelBootup(Panels panel)
 {
-	return (bootupPanel & panel);
+	return PanelBit(bootupPanels, panel);
 }
 
+// Input slot, one per panel in the control frame, written by the panel as the frame passes through.
+enum InputSlotFields
+{
+	inputBits = 0,  // Panel defined switch and button states.
+	inputValue,     // Panel defined analog value.
+	inputSlotSize
+};
+
+// This board's input summaries, and on the master every panel's summary from the last returned frame.
+volatile byte panelInputs[MAX_PANELS][inputSlotSize];
+
+// Panels hosted by this board, their slots are written by the relay.
+volatile byte hostedPanels[PANEL_BITMAP_SIZE];
+
+// Master only, panels whose slot changed since last cleared.
+byte panelInputsChanged[PANEL_BITMAP_SIZE];
+
 // Shared method among the projects.
-// triggerActivity should only be raised by the master panel.
-void SendControlDataFromMaster(bool performActivity)
+// Declares a panel driven by this board, call from setup().
+void HostPanel(Panels panel)
 {
-	byte checkSum = (byte)state + (byte)mode + 0 + (byte)performActivity + (byte)bootupPanel;
+	byte oldSREG = SREG;
+	cli();
+	SetPanelBit(hostedPanels, panel);
+	SREG = oldSREG;
+}
 
-	Serial.write((byte)state);
-	Serial.write((byte)mode);
-	Serial.write((byte) false); // activityFlag
-	Serial.write((byte)performActivity);
-	Serial.write((byte)bootupPanel);
-	Serial.write((checkSum));
-	Serial.write(13);
+// Shared method among the projects.
+// Publishes a panel's input summary, the master sees it within one ring cycle.
+void SetPanelInputs(Panels panel, byte bits, byte value)
+{
+	byte oldSREG = SREG;
+	cli();
+	panelInputs[panel][inputBits] = bits;
+	panelInputs[panel][inputValue] = value;
+	SetPanelBit(hostedPanels, panel);
+	SREG = oldSREG;
 }
 
+#include<ringEvent.h>
+#include<ringVm.h>
+
+// Master only, counts and clears the panels whose input slot changed.
+byte CountPanelInputsChanged()
+{
+	byte count = 0;
+	for (byte i = 0; i < MAX_PANELS; i++)
+	{
+		count += PanelBit(panelInputsChanged, i);
+	}
+	memset(panelInputsChanged, 0, sizeof(panelInputsChanged));
+	return count;
+}
+
+// Master only, returns true once per change of a panel's input slot.
+bool PanelInputsChanged(Panels panel)
+{
+	bool changed = PanelBit(panelInputsChanged, panel);
+	panelInputsChanged[panel >> 3] &= ~(1 << (panel & 7));
+	return changed;
+}
+
+// Control frame payload layout.
+enum ControlFields
+{
+	controlState = 0,
+	controlMode,
+	controlFlags,
+	controlBootup, // Bootup bitmap, panels 0 to 7.
+	controlBaseFieldCount,
+	// Master ring time, milliseconds then microseconds, little endian.
+	controlTimeMillis = controlBaseFieldCount,
+	controlTimeMicros = controlTimeMillis + 4,
+	// Sequence number set by the master, hop count incremented by each relaying panel.
+	controlSeq = controlTimeMicros + 2,
+	controlHops,
+	// Shared random streams, see ringRandom.h. Seed then epoch, little endian.
+	controlSeed,
+	controlEpoch = controlSeed + 2,
+	// Panels addressed by the frame, sizes the fields that follow.
+	controlPanelCount = controlEpoch + 2,
+	// Bootup bitmap for panels 8 and up, then one input slot per panel.
+	controlPanelFields
+};
+
+// Offset of the first input slot in a control frame addressing panelCount panels.
+inline byte ControlInputsOffset(byte panelCount)
+{
+	return controlPanelFields + (panelCount > 8 ? (panelCount - 1) / 8 : 0);
+}
+
+inline byte ControlFrameLength(byte panelCount)
+{
+	return ControlInputsOffset(panelCount) + panelCount * inputSlotSize;
+}
+
+#define CONTROL_FLAG_ACTIVITY 1
+#define CONTROL_FLAG_PERFORM_ACTIVITY 2
+
+// Legacy frame: state, mode, activity, performActivity, bootupPanel, additive checksum, 13.
+#define LEGACY_FRAME_SIZE 7
+
 // Shared method among the projects.
-// Master panel shall not echo the data.
-void CheckControlData(bool masterPanel = false)
+// Opens the ring serial port, non-master panels relay frames downstream from the RX interrupt.
+void BeginControlData(bool masterPanel = false)
+{
+	LatchFrameClock();
+	RingSerialBegin(BAUD_RATE, !masterPanel);
+	BeginParams();
+}
+
+// Master only, control fields as last sent.
+byte sentState;
+byte sentMode;
+byte sentBootupPanels[PANEL_BITMAP_SIZE];
+uint16_t sentEpoch;
+
+// Master only, true while the panels have not been sent the current state, mode, bootup, epoch or events.
+bool ControlDataChanged()
 {
-	static byte data[10];
-	static unsigned int index;
-	bool dataReadyFlag = false;
+	RingEpochUpdate();
+	return state != sentState || mode != sentMode || memcmp(bootupPanels, sentBootupPanels, sizeof(bootupPanels)) != 0 || ringEpoch != sentEpoch || ringEventCount > 0;
+}
 
-	while (Serial.available())
+// Shared method among the projects.
+// performActivity is only sent on legacy rings, framed rings carry typed events.
+void SendControlDataFromMaster(bool performActivity)
+{
+	// Frames in flight while rates switch would be garbled.
+	if (RingBaudNegotiating())
 	{
-		byte c = Serial.read();
-		data[index] = c;
+		return;
+	}
+
+	sentState = state;
+	sentMode = mode;
+	memcpy(sentBootupPanels, bootupPanels, sizeof(bootupPanels));
+	RingEpochUpdate();
+	sentEpoch = ringEpoch;
+
+	if (ringLegacyProtocol)
+	{
+		byte checkSum = (byte)state + (byte)mode + 0 + (byte)performActivity + bootupPanels[0];
+
+		RingSerialWrite((byte)state);
+		RingSerialWrite((byte)mode);
+		RingSerialWrite((byte) false); // activityFlag
+		RingSerialWrite((byte)performActivity);
+		RingSerialWrite(bootupPanels[0]);
+		RingSerialWrite((checkSum));
+		RingSerialWrite(13);
+		ringScheduler.charge(LEGACY_FRAME_SIZE);
+		ringScheduler.sent();
+		return;
+	}
+
+	byte payload[ControlFrameLength(RING_PANEL_COUNT)];
+	payload[controlState] = state;
+	payload[controlMode] = mode;
+	// Panels react to specific events instead, see ringEvent.h.
+	payload[controlFlags] = 0;
+	payload[controlBootup] = bootupPanels[0];
+
+	unsigned long ms;
+	unsigned int us;
+	RingTimeAt(micros(), &ms, &us);
+	memcpy(payload + controlTimeMillis, &ms, 4);
+	memcpy(payload + controlTimeMicros, &us, 2);
+	payload[controlSeq] = ringStats.sent(micros());
+	payload[controlHops] = 0;
+	memcpy(payload + controlSeed, &ringSeed, 2);
+	memcpy(payload + controlEpoch, &ringEpoch, 2);
+	payload[controlPanelCount] = RING_PANEL_COUNT;
+	memcpy(payload + controlPanelFields, bootupPanels + 1, ControlInputsOffset(RING_PANEL_COUNT) - controlPanelFields);
+
+	byte *slot = payload + ControlInputsOffset(RING_PANEL_COUNT);
+	for (byte i = 0; i < RING_PANEL_COUNT; i++, slot += inputSlotSize)
+	{
+		slot[inputBits] = panelInputs[i][inputBits];
+		slot[inputValue] = panelInputs[i][inputValue];
+	}
+
+	SendFrame(controlFrame, payload, sizeof(payload));
+	SendEvents();
+	ringScheduler.sent();
+}
+
+// Master only, pushes each block a chunk at a time, call every loop.
+// A new version is pushed at once, every block is repeated for panels that missed it.
+void SendBlocksFromMaster()
+{
+	static msTimer timerChunk(RING_BLOCK_CHUNK_MS);
+	static msTimer timerRepeat(RING_BLOCK_REPEAT_MS);
+	static uint16_t sentVersions[blockCount];
+	static byte id = blockCount;
+	static byte chunk = 0;
+	static bool started = false;
+
+	// Push every block once at startup, panels may hold saved blocks the master has since replaced.
+	if (!started)
+	{
+		memset(sentVersions, 0xFF, sizeof(sentVersions));
+		started = true;
+	}
+
+	// Chunks wait their turn of the master's share, at most one per RING_BLOCK_CHUNK_MS so control frames still get theirs.
+	if (RingBaudNegotiating() || ringLegacyProtocol || !ringScheduler.ready() || !timerChunk.elapsed())
+	{
+		return;
+	}
+
+	// Finished the block in progress, start a changed block or the next repeat.
+	if (id == blockCount || chunk >= BlockChunkCount(ringBlocks[id].size))
+	{
+		id = blockCount;
+		chunk = 0;
+
+		for (byte i = 0; i < blockCount && id == blockCount; i++)
+		{
+			if (ringBlocks[i].data != NULL && ringBlocks[i].version != sentVersions[i])
+			{
+				id = i;
+			}
+		}
 
-		if (++index > sizeof(data))
+		if (id == blockCount && timerRepeat.elapsed())
 		{
-			index = 0;
+			memset(sentVersions, 0xFF, sizeof(sentVersions));
+			return;
 		}
 
-		if (c == 13)
+		if (id == blockCount)
 		{
-			index = 0;
-			dataReadyFlag = true;
+			return;
 		}
+
+		sentVersions[id] = ringBlocks[id].version;
 	}
 
-	if (dataReadyFlag)
+	SendBlockChunk(id, chunk++);
+}
+
+// Master only, 0 while the ring is intact. Otherwise the hop into the first silent
+// panel (hop 1 leads from the master to position 1), 255 until a panel past the break reports.
+byte ringBreakHop = 0;
+
+// Master only, USART overruns on every board, from the last status frame to return.
+unsigned int ringOverruns = 0;
+
+// Master only, render frames dropped on every board, from the last status frame to return.
+unsigned int ringDroppedFrames = 0;
+
+// Master only, time from the start of the startup sequence until a control frame carrying every
+// bootup bit returned, so every panel had it. 0 until then.
+unsigned long bootStartMillis;
+bool bootLitPending = false;
+unsigned int ringBootMillis = 0;
+
+// Master only, time the ring rate negotiation after the boot took. 0 until it ends.
+unsigned int ringBaudMillis = 0;
+
+// Status frame payload layout. Sent around the ring by the master, readable on its USB serial port.
+enum StatusFields
+{
+	statusBaudIndex = 0,
+	statusCrcErrors,
+	statusRxOverflows = statusCrcErrors + 2,
+	statusBaudErrors = statusRxOverflows + 2,
+	// Round trip times in microseconds, loss in frames per thousand.
+	statusRttMin = statusBaudErrors + RING_BAUD_RATE_COUNT,
+	statusRttAvg = statusRttMin + 2,
+	statusRttP99 = statusRttAvg + 2,
+	statusLoss = statusRttP99 + 2,
+	statusRingLength = statusLoss + 2,
+	statusBreakHop,
+	// USART overruns, each panel adds its own as the frame passes. Then the total of the last round.
+	statusRxOverruns,
+	statusRingOverruns = statusRxOverruns + 2,
+	statusBootMillis = statusRingOverruns + 2, // Time to a fully lit wall, 0 while booting.
+	// Render frames dropped, each board adds its own as the frame passes.
+	statusDroppedFrames = statusBootMillis + 2,
+	statusBaudMillis = statusDroppedFrames + 2, // Time the rate negotiation after the boot took, 0 until it ends.
+	statusFieldCount = statusBaudMillis + 2
+};
+
+// Reports the negotiated rate, ring error counts and round trip metrics, counts saturate.
+void SendStatusFromMaster()
+{
+	// Legacy panels would take the frame for a garbled control frame.
+	if (RingBaudNegotiating() || ringLegacyProtocol)
+	{
+		return;
+	}
+
+	byte payload[statusFieldCount];
+	unsigned int rxOverflows = ringRxOverflowCount;
+
+	payload[statusBaudIndex] = ringBaudIndex;
+	memcpy(payload + statusCrcErrors, &ringDecoder.crcErrorCount, 2);
+	memcpy(payload + statusRxOverflows, &rxOverflows, 2);
+
+	for (byte i = 0; i < RING_BAUD_RATE_COUNT; i++)
 	{
-		byte checkSum = data[0] + data[1] + data[2] + data[3] + data[4];
+		payload[statusBaudErrors + i] = min(ringBaudErrorCounts[i], 255);
+	}
+
+	unsigned int rttMin = ringStats.minMicros();
+	unsigned int rttAvg = ringStats.avgMicros();
+	unsigned int rttP99 = ringStats.p99Micros();
+	unsigned int loss = ringStats.lossPerMille();
+	memcpy(payload + statusRttMin, &rttMin, 2);
+	memcpy(payload + statusRttAvg, &rttAvg, 2);
+	memcpy(payload + statusRttP99, &rttP99, 2);
+	memcpy(payload + statusLoss, &loss, 2);
+	payload[statusRingLength] = ringStats.ringLength;
+	payload[statusBreakHop] = ringBreakHop;
+
+	unsigned int rxOverruns = ringRxOverrunCount;
+	memcpy(payload + statusRxOverruns, &rxOverruns, 2);
+	memcpy(payload + statusRingOverruns, &ringOverruns, 2);
+	memcpy(payload + statusBootMillis, &ringBootMillis, 2);
+	unsigned int droppedFrames = renderFramesDropped;
+	memcpy(payload + statusDroppedFrames, &droppedFrames, 2);
+	memcpy(payload + statusBaudMillis, &ringBaudMillis, 2);
+
+	SendFrame(statusFrame, payload, sizeof(payload));
+}
 
-		if (checkSum != data[5])
+// Set while the relay holds activityFlag in the frame passing through.
+volatile bool relayedActivity;
+
+// Panels only, position in the ring counted from the master, 0 until a control frame has passed.
+volatile byte ringPosition = 0;
+
+// Framed relay hook, OR's the panel's activityFlag into the control flags, counts the hop,
+// writes the input slots of the panels hosted by this board and adds its overruns and dropped frames to the status frame.
+byte PatchRelayedByte(byte type, byte offset, byte c)
+{
+	static byte inputsOffset;
+	static byte inputsEnd;
+	static byte overrunCarry;
+	static byte droppedCarry;
+
+	if (type == controlFrame && offset == controlState)
+	{
+		inputsEnd = 0;
+	}
+
+	if (type == controlFrame && offset == controlPanelCount && c <= MAX_PANELS)
+	{
+		inputsOffset = ControlInputsOffset(c);
+		inputsEnd = inputsOffset + c * inputSlotSize;
+	}
+
+	if (type == controlFrame && offset >= controlPanelFields && offset >= inputsOffset && offset < inputsEnd)
+	{
+		byte slot = (offset - inputsOffset) / inputSlotSize;
+		return PanelBit(hostedPanels, slot) ? panelInputs[slot][(offset - inputsOffset) % inputSlotSize] : c;
+	}
+
+	if (type == controlFrame && offset == controlFlags)
+	{
+		relayedActivity = activityFlag;
+		return c | (relayedActivity ? CONTROL_FLAG_ACTIVITY : 0);
+	}
+
+	if (type == controlFrame && offset == controlHops && c < 255)
+	{
+		ringPosition = c + 1;
+		return c + 1;
+	}
+
+	// Little endian, the carry follows into the high byte, which saturates.
+	if (type == statusFrame && offset == statusRxOverruns)
+	{
+		unsigned int sum = c + lowByte(ringRxOverrunCount);
+		overrunCarry = sum >> 8;
+		return sum;
+	}
+
+	if (type == statusFrame && offset == statusRxOverruns + 1)
+	{
+		return min(c + highByte(ringRxOverrunCount) + overrunCarry, 255);
+	}
+
+	if (type == statusFrame && offset == statusDroppedFrames)
+	{
+		unsigned int sum = c + lowByte(renderFramesDropped);
+		droppedCarry = sum >> 8;
+		return sum;
+	}
+
+	if (type == statusFrame && offset == statusDroppedFrames + 1)
+	{
+		return min(c + highByte(renderFramesDropped) + droppedCarry, 255);
+	}
+
+	return c;
+}
+
+// Framed relay hook, activityFlag is only cleared once it left in a valid frame.
+void FrameRelayed(byte type, bool valid)
+{
+	if (type == controlFrame && valid && relayedActivity)
+	{
+		activityFlag = false;
+	}
+	relayedActivity = false;
+}
+
+// Framed relay hook, strips this board's event frames once they have been around the ring.
+bool StripRelayedFrame(byte type, byte c)
+{
+	return type == eventFrame && c < MAX_PANELS && PanelBit(hostedPanels, c);
+}
+
+
+// Position of the legacy relay within the current frame, 0 between frames.
+volatile byte legacyRelayIndex = 0;
+
+// Cut-through relay of a legacy frame.
+// OR's the panel's activityFlag into byte 2 and patches the checksum to match.
+void RelayLegacyByte(byte c)
+{
+	static byte checkSum;
+	static byte checkSumDelta;
+
+	byte index = legacyRelayIndex;
+	byte out = c;
+
+	if (index == 2)
+	{
+		relayedActivity = activityFlag;
+		out = c | relayedActivity;
+		checkSumDelta = out - c;
+	}
+	else if (index == 5)
+	{
+		if (c == checkSum && relayedActivity)
+		{
+			activityFlag = false;
+		}
+		relayedActivity = false;
+		out = c + checkSumDelta;
+	}
+
+	if (index < 5)
+	{
+		checkSum += c;
+	}
+
+	RingSerialQueue(out);
+
+	if (c == 13 || ++index >= LEGACY_FRAME_SIZE)
+	{
+		index = 0;
+		checkSum = 0;
+		checkSumDelta = 0;
+	}
+	legacyRelayIndex = index;
+}
+
+// Set while the relay is passing a legacy stream.
+volatile bool relayLegacy;
+
+// Cut-through relay, called from the RX interrupt for each received byte.
+// A SLIP END switches to framed, a byte that cannot start a frame switches to legacy.
+void ForwardRingByte(byte c)
+{
+	bool legacy = relayLegacy;
+
+	if (legacy)
+	{
+		if (c == SLIP_END && legacyRelayIndex == 0)
+		{
+			legacy = false;
+		}
+	}
+	else if (relayIndex == 0 && c != SLIP_END && c != SLIP_ESC && (c >> 4) != RING_PROTOCOL_VERSION)
+	{
+		legacy = true;
+	}
+
+	relayLegacy = legacy;
+
+	if (legacy)
+	{
+		RelayLegacyByte(c);
+	}
+	else
+	{
+		RelayFramedByte(c);
+	}
+}
+
+// Panels only, sends this board's pending events as soon as the relay is between frames.
+// Queued as a whole, so bytes arriving meanwhile follow the event frame downstream.
+void InjectEvents()
+{
+	static unsigned long sentMillis;
+
+	if (ringEventCount == 0 || millis() - sentMillis < RING_EVENT_MIN_MS)
+	{
+		return;
+	}
+
+	byte oldSREG = SREG;
+	cli();
+
+	if (relayIndex == 0 && !relayLegacy)
+	{
+		QueueEvents();
+		sentMillis = millis();
+	}
+
+	SREG = oldSREG;
+}
+
+// Link frame payload: kind, the sender's ring position, the sender's hosted panels.
+enum LinkFields
+{
+	linkKind = 0,
+	linkPosition,
+	linkPanels,
+	linkFieldCount = linkPanels + PANEL_BITMAP_SIZE
+};
+
+enum LinkKinds
+{
+	linkLost = 0,   // Sender has had no frames from the master, sent while autonomous.
+	linkJoined = 1  // Sender has received its first control frame since reset.
+};
+
+#define RING_BREAK_MISSES 3           // Unanswered frames in a row before the master declares the ring broken.
+#define RING_BREAK_PROBE_MS 100       // Master probes a broken ring this often.
+#define RING_UPSTREAM_TIMEOUT_MS 1500 // Panels run autonomously after this long without a frame from the master.
+#define RING_LINK_LOST_MS 250         // Autonomous panels report this often.
+
+// Panels only, cut off from the master and running on their own.
+bool ringAutonomous = false;
+
+// Supply current each panel draws in mA, while its lights come up and once running.
+// Estimates, tune with RING_BOOT_BUDGET_MA for the wall's supply.
+struct bootCurrent
+{
+	unsigned int inrushMa;
+	unsigned int runningMa;
+};
+
+const bootCurrent bootCurrents[] PROGMEM = {
+	{600, 300},  // dilithumPowerFrame, display and 14 pixels.
+	{500, 350},  // metaphasicVxCpuCore, LED matrices.
+	{600, 300},  // realTimeSystemStatus, hosted by Sporation.
+	{900, 450},  // gndnPipelineRelay, 27 pixels.
+	{1200, 500}, // metaphasicSporation, 87 pixels.
+	{400, 200},  // tachyonSensormaticGrid, hosted by GNDN.
+	{1500, 300}, // biTriaxialForceAlignment, servos homing.
+	{1800, 800}  // polychromaticToracVertex, 95 pixels.
+};
+#define BOOT_CURRENT_COUNT (sizeof(bootCurrents) / sizeof(bootCurrents[0]))
+
+// Panels past the table.
+#define RING_BOOT_DEFAULT_INRUSH_MA 1000
+#define RING_BOOT_DEFAULT_RUNNING_MA 500
+
+#ifndef RING_BOOT_BUDGET_MA
+#define RING_BOOT_BUDGET_MA 5000
+#endif
+
+// Panels draw their inrush current this long after their bootup bit is set.
+#define RING_BOOT_INRUSH_MS 200
+
+bootCurrent BootCurrent(byte panel)
+{
+	bootCurrent current = {RING_BOOT_DEFAULT_INRUSH_MA, RING_BOOT_DEFAULT_RUNNING_MA};
+
+	if (panel < BOOT_CURRENT_COUNT)
+	{
+		memcpy_P(&current, &bootCurrents[panel], sizeof(current));
+	}
+	return current;
+}
+
+// Master only, panels waiting to boot, panels still drawing their inrush and when their bootup bit was set.
+byte bootPending[PANEL_BITMAP_SIZE];
+byte bootInrush[PANEL_BITMAP_SIZE];
+unsigned int bootMillis[RING_PANEL_COUNT];
+
+// Master only, clears bootLitPending once a returned control frame carries every bootup bit.
+void CheckBootLit(const byte *data)
+{
+	byte lit[PANEL_BITMAP_SIZE];
+	lit[0] = data[controlBootup];
+	memcpy(lit + 1, data + controlPanelFields, ControlInputsOffset(RING_PANEL_COUNT) - controlPanelFields);
+
+	for (byte i = 0; i < RING_PANEL_COUNT; i++)
+	{
+		if (!PanelBit(lit, i))
 		{
 			return;
 		}
+	}
+
+	bootLitPending = false;
+	ringBootMillis = millis() - bootStartMillis;
+}
+
+// Master only, takes down panels that reset while the rest of the wall stays up, CheckStartupSequence() boots them again.
+// Panels that were not booted yet are left to the startup sequence.
+void RebootPanels(const byte *panels)
+{
+	for (byte i = 0; i < PANEL_BITMAP_SIZE; i++)
+	{
+		byte booted = bootupPanels[i] & panels[i];
+		bootupPanels[i] &= ~booted;
+		bootPending[i] |= booted;
+	}
+}
+
+// Panels only, queues a frame between relayed frames, returns false if the relay is busy.
+bool InjectFrame(byte type, const byte *payload, byte length)
+{
+	bool sent = false;
+	byte oldSREG = SREG;
+	cli();
+
+	if (relayIndex == 0 && !relayLegacy && RingSerialTxFree() >= FRAME_WIRE_SIZE(length))
+	{
+		QueueFrame(type, payload, length);
+		sent = true;
+	}
+
+	SREG = oldSREG;
+	return sent;
+}
+
+bool SendLinkFrame(byte kind)
+{
+	byte payload[linkFieldCount];
+	payload[linkKind] = kind;
+	payload[linkPosition] = ringPosition;
+	memcpy(payload + linkPanels, (const byte *)hostedPanels, PANEL_BITMAP_SIZE);
+	return InjectFrame(linkFrame, payload, sizeof(payload));
+}
+
+// Automatic state changes while no user is interacting.
+// Run by the master, and by panels cut off from the master.
+void UpdateAutomaticState()
+{
+	static msTimer timerState(10000);
+
+	if (timerState.elapsed())
+	{
+		unsigned int delay = Param(paramStateDelay + state);
+		timerState.setDelayAndReset(random(delay, delay * 2UL));
+
+		int randMax = Param(paramStateRandMax + state);
+
+		if (random(0, randMax) == 0)
+		{
+			// Increment state.
+			if (state == stable)
+				state = warning;
+			else if (state == warning)
+				state = critical;
+			else if (state == critical)
+				state = critical;
+		}
+		else
+		{
+			// Decrement state.
+			if (state == stable)
+				state = stable;
+			else if (state == warning)
+				state = stable;
+			else if (state == critical)
+				state = warning;
+		}
+	}
+}
+
+// Panels only, called with every frame from the master (upstream is true) and every loop.
+// Announces a reset to the master, and runs autonomously while upstream is silent.
+void UpdateRingLink(bool upstream)
+{
+	static unsigned long upstreamMillis;
+	static bool joined;
+	static bool joinPending;
+	static msTimer timerLost(RING_LINK_LOST_MS);
+
+	if (upstream)
+	{
+		upstreamMillis = millis();
+		ringAutonomous = false;
+
+		if (!joined)
+		{
+			joined = true;
+			joinPending = true;
+		}
+		return;
+	}
+
+	if (joinPending && ringPosition != 0)
+	{
+		joinPending = !SendLinkFrame(linkJoined);
+	}
+
+	// Nothing to lose before the first frame.
+	if (!joined || millis() - upstreamMillis < RING_UPSTREAM_TIMEOUT_MS)
+	{
+		return;
+	}
+
+	if (!ringAutonomous)
+	{
+		ringAutonomous = true;
+		mode = automaticActivity;
+		timerLost.ForceTrigger();
+	}
+
+	UpdateAutomaticState();
+
+	if (timerLost.elapsed())
+	{
+		SendLinkFrame(linkLost);
+	}
+}
+
+// Master only, true when a frame should be resent to probe for a missing echo.
+bool RingEchoOverdue()
+{
+	if (!ringStats.echoOverdue(micros()))
+	{
+		return false;
+	}
+
+	return ringBreakHop == 0 || ringScheduler.sinceSent() >= RING_BREAK_PROBE_MS;
+}
+
+// Master only, handles a link frame from a panel.
+void RingLinkFrame(const byte *payload)
+{
+	if (payload[linkKind] == linkJoined)
+	{
+		RebootPanels(payload + linkPanels);
+	}
+	else if (payload[linkKind] == linkLost && payload[linkPosition] != 0)
+	{
+		// The most upstream silent panel is just past the break.
+		ringBreakHop = ringBreakHop == 0 ? payload[linkPosition] : min(ringBreakHop, payload[linkPosition]);
+	}
+}
+
+// Resynchronizing legacy frame parser.
+// Every 13 is a candidate terminator and is validated against the bytes before it,
+// so a dropped or stray byte costs only the frame it landed in.
+// Returns the frame converted to the framed layout or NULL.
+const byte *DecodeLegacyByte(byte c)
+{
+	// Twice the frame size so a candidate frame is always contiguous.
+	static byte data[LEGACY_FRAME_SIZE * 2];
+	static byte index;
+	static byte frame[2 + controlBaseFieldCount];
+
+	if (index == sizeof(data))
+	{
+		// Keep the newest bytes, they may hold the start of the next frame.
+		memmove(data, data + LEGACY_FRAME_SIZE, LEGACY_FRAME_SIZE);
+		index = LEGACY_FRAME_SIZE;
+	}
+
+	data[index++] = c;
+
+	if (c != 13 || index < LEGACY_FRAME_SIZE)
+	{
+		return NULL;
+	}
+
+	byte *legacy = data + index - LEGACY_FRAME_SIZE;
+	byte checkSum = legacy[0] + legacy[1] + legacy[2] + legacy[3] + legacy[4];
+
+	if (checkSum != legacy[5] || legacy[0] > critical || legacy[1] > manualActivity)
+	{
+		return NULL;
+	}
+
+	index = 0;
+
+	frame[0] = (RING_PROTOCOL_VERSION << 4) | controlFrame;
+	frame[1] = controlBaseFieldCount;
+	frame[2 + controlState] = legacy[0];
+	frame[2 + controlMode] = legacy[1];
+	frame[2 + controlFlags] = (legacy[2] ? CONTROL_FLAG_ACTIVITY : 0) | (legacy[3] ? CONTROL_FLAG_PERFORM_ACTIVITY : 0);
+	frame[2 + controlBootup] = legacy[4];
+	return frame;
+}
+
+// micros() when the frame last returned by ReadFrame() finished arriving.
+unsigned long frameRxMicros;
+
+// Frame parser, drains the receive ring.
+// Framed and legacy streams are told apart the same way as ForwardRingByte().
+// Returns a pointer to the next validated frame (valid until the next call) or NULL.
+const byte *ReadFrame()
+{
+	static bool legacy;
+
+	while (RingSerialAvailable())
+	{
+		unsigned long stamp = RingSerialStamp();
+		byte c = RingSerialRead();
+		const byte *frame;
+
+		if (legacy)
+		{
+			if (c == SLIP_END)
+			{
+				legacy = false;
+			}
+		}
+		else if (ringDecoder.idle() && c != SLIP_END && c != SLIP_ESC && (c >> 4) != RING_PROTOCOL_VERSION)
+		{
+			legacy = true;
+		}
+
+		frame = legacy ? DecodeLegacyByte(c) : ringDecoder.decode(c);
+
+		if (frame != NULL)
+		{
+			frameRxMicros = stamp;
+			return frame;
+		}
+	}
+
+	return NULL;
+}
+
+// Shared method among the projects.
+// Master panel shall not echo the data, other panels relay it from the RX interrupt.
+void CheckControlData(bool masterPanel = false)
+{
+	const byte *frame;
+
+	while ((frame = ReadFrame()) != NULL)
+	{
+		RingBaudFrameValid();
+
+		if (FrameType(frame) == baudFrame && FrameLength(frame) >= 2)
+		{
+			RingBaudFrame(FramePayload(frame), masterPanel);
+
+			if (!masterPanel)
+			{
+				UpdateRingLink(true);
+			}
+			continue;
+		}
+
+		if (FrameType(frame) == blockFrame && FrameLength(frame) >= blockFrameSize)
+		{
+			// The master pushes a new block on by itself, see SendBlocksFromMaster().
+			RingBlockFrame(FramePayload(frame));
+			continue;
+		}
+
+		if (FrameType(frame) == cueFrame && FrameLength(frame) >= cueFieldCount)
+		{
+			// The master scheduled its own cues as it sent them.
+			if (!masterPanel)
+			{
+				RingCueFrame(FramePayload(frame));
+			}
+			continue;
+		}
+
+		if (FrameType(frame) == statusFrame && FrameLength(frame) >= statusFieldCount)
+		{
+			if (masterPanel)
+			{
+				memcpy(&ringOverruns, FramePayload(frame) + statusRxOverruns, 2);
+				memcpy(&ringDroppedFrames, FramePayload(frame) + statusDroppedFrames, 2);
+			}
+			continue;
+		}
+
+		if (FrameType(frame) == linkFrame && FrameLength(frame) >= linkFieldCount)
+		{
+			if (masterPanel)
+			{
+				RingLinkFrame(FramePayload(frame));
+			}
+			continue;
+		}
+
+		if (FrameType(frame) == eventFrame && FrameLength(frame) > eventSource)
+		{
+			byte source = FramePayload(frame)[eventSource];
+
+			// Panels between the master and the source have not seen it yet, the source strips it.
+			if (masterPanel && source < MAX_PANELS && !PanelBit(hostedPanels, source) && !RingBaudNegotiating())
+			{
+				SendFrame(eventFrame, FramePayload(frame), FrameLength(frame));
+			}
+
+			DispatchEvents(FramePayload(frame), FrameLength(frame));
+			continue;
+		}
+
+		// Fields past controlBaseFieldCount are absent from legacy and older frames.
+		if (FrameType(frame) != controlFrame || FrameLength(frame) < controlBaseFieldCount)
+		{
+			continue;
+		}
+
+		const byte *data = FramePayload(frame);
 
 		if (masterPanel)
 		{
-			activityFlag = (bool)data[2] | activityFlag;
+			activityFlag = (data[controlFlags] & CONTROL_FLAG_ACTIVITY) | activityFlag;
+
+			if (FrameLength(frame) >= controlHops + 1)
+			{
+				ringStats.received(data[controlSeq], data[controlHops], frameRxMicros);
+			}
+
+			byte panelCount = FrameLength(frame) > controlPanelCount ? data[controlPanelCount] : 0;
+
+			if (panelCount <= MAX_PANELS && FrameLength(frame) >= ControlFrameLength(panelCount))
+			{
+				if (bootLitPending && panelCount == RING_PANEL_COUNT)
+				{
+					CheckBootLit(data);
+				}
+
+				const byte *slot = data + ControlInputsOffset(panelCount);
+				for (byte i = 0; i < panelCount; i++, slot += inputSlotSize)
+				{
+					// The master's own slots are current already.
+					if (!PanelBit(hostedPanels, i) && (slot[inputBits] != panelInputs[i][inputBits] || slot[inputValue] != panelInputs[i][inputValue]))
+					{
+						panelInputs[i][inputBits] = slot[inputBits];
+						panelInputs[i][inputValue] = slot[inputValue];
+						SetPanelBit(panelInputsChanged, i);
+					}
+				}
+			}
 		}
 		else
 		{
-			state = (states)data[0];
-			mode = (modes)data[1];
-			performActivityFlag = (bool)data[3];
-			bootupPanel = (Panels)data[4];
+			UpdateRingLink(true);
 
-			byte checkSum = data[0] + data[1] + (data[2] | activityFlag) + data[3] + data[4];
+			state = (states)data[controlState];
+			mode = (modes)data[controlMode];
+			if (data[controlFlags] & CONTROL_FLAG_PERFORM_ACTIVITY)
+			{
+				performActivityFlag = true;
+			}
+			// Panels past the frame's panel count, or past 8 in older frames, stay shut down.
+			byte panelCount = FrameLength(frame) > controlPanelCount ? data[controlPanelCount] : 0;
+			memset(bootupPanels, 0, sizeof(bootupPanels));
+			bootupPanels[0] = data[controlBootup];
 
-			Serial.write(data[0]);
-			Serial.write(data[1]);
-			Serial.write(data[2] | activityFlag);
-			Serial.write(data[3]);
-			Serial.write(data[4]);
-			Serial.write((checkSum));
-			Serial.write(13);
+			if (panelCount <= MAX_PANELS && FrameLength(frame) >= ControlInputsOffset(panelCount))
+			{
+				memcpy(bootupPanels + 1, data + controlPanelFields, ControlInputsOffset(panelCount) - controlPanelFields);
+			}
 
-			activityFlag = false;
+			if (FrameLength(frame) >= controlTimeMicros + 2)
+			{
+				uint32_t ms;
+				uint16_t us;
+				memcpy(&ms, data + controlTimeMillis, 4);
+				memcpy(&us, data + controlTimeMicros, 2);
+
+				// The stamp left the master a frame and one byte per relay ago, cues need panels within a millisecond.
+				// Stuffed bytes count, a byte time is a fifth of the error budget at 57600.
+				unsigned long transit = (FrameLength(frame) + 5UL + ringDecoder.stuffedCount + ringPosition) * 10000000UL / RingBaudRate(ringBaudIndex) + us;
+				RingTimeSync(ms + transit / 1000, transit % 1000, frameRxMicros);
+			}
+
+			if (FrameLength(frame) >= controlEpoch + 2)
+			{
+				memcpy(&ringSeed, data + controlSeed, 2);
+				memcpy(&ringEpoch, data + controlEpoch, 2);
+			}
 		}
 	}
+
+	if (masterPanel)
+	{
+		if (ringStats.missedEchoes < RING_BREAK_MISSES)
+		{
+			ringBreakHop = 0;
+		}
+		else if (ringBreakHop == 0)
+		{
+			ringBreakHop = 255;
+		}
+	}
+	else
+	{
+		InjectEvents();
+		UpdateRingLink(false);
+	}
+
+	UpdateCues();
+	RingBaudUpdate(masterPanel);
 }
 
 
-// Startup sequence to bootup all panels, only performed by the master panel.  
+// Startup sequence to bootup all panels, only performed by the master panel.
+// Panels boot in address order, as many at once as the supply budget allows, see bootCurrents.
+// The ring stays at its committed rate until a control frame carrying every bootup bit has returned,
+// then negotiates upward. ringBootMillis is taken as that frame returns, ringBaudMillis once the negotiation ends.
 bool CheckStartupSequence(bool reboot = false)
-{	
-	static msTimer timer(1000);
-	static byte rebootIndex = 0;
+{
+	static bool started = false;
+	static bool negotiate = false;
+	static bool negotiating = false;
+	static unsigned long negotiateMillis;
+
+	if (reboot || !started)
+	{
+		memset(bootupPanels, 0, sizeof(bootupPanels));
+		memset(bootPending, 0, sizeof(bootPending));
+		memset(bootInrush, 0, sizeof(bootInrush));
+		for (byte i = 0; i < RING_PANEL_COUNT; i++)
+		{
+			SetPanelBit(bootPending, i);
+		}
+		bootStartMillis = millis();
+		bootLitPending = true;
+		ringBootMillis = 0;
+		ringBaudMillis = 0;
+
+		// Renegotiate the ring rate from the committed rate upward once the panels are up.
+		ringBaudCeiling = RING_BAUD_RATE_COUNT - 1;
+		negotiate = true;
+		negotiating = false;
+
+		// Held at a cold start before the first probe is sent.
+		if (!started && ringBaudState == baudIdle)
+		{
+			ringBaudState = baudDone;
+		}
+		started = true;
+	}
+
+	// Bootup bits are not sent while the rate is being negotiated.
+	if (RingBaudNegotiating())
+	{
+		return false;
+	}
 
-	if (reboot) 
-	{		
-		bootupPanel = noPanel;
-		rebootIndex = 0;
-		timer.resetDelay();
-	}	
-	
-	if (timer.elapsed())
+	if (negotiating)
 	{
-		bootupPanel = (Panels)(bootupPanel | (1 << rebootIndex));
-		if ((++rebootIndex) > 7) rebootIndex = 7;
+		negotiating = false;
+		ringBaudMillis = millis() - negotiateMillis;
 	}
 
-	return  rebootIndex == 7;	
+	unsigned int now = millis();
+	unsigned int drawMa = 0;
+	bool inrush = false;
+	bool pending = false;
+
+	for (byte i = 0; i < RING_PANEL_COUNT; i++)
+	{
+		if (PanelBit(bootInrush, i) && (unsigned int)(now - bootMillis[i]) >= RING_BOOT_INRUSH_MS)
+		{
+			bootInrush[i >> 3] &= ~(1 << (i & 7));
+		}
+
+		if (PanelBit(bootupPanels, i))
+		{
+			bootCurrent current = BootCurrent(i);
+			drawMa += PanelBit(bootInrush, i) ? current.inrushMa : current.runningMa;
+			inrush |= PanelBit(bootInrush, i);
+		}
+		pending |= PanelBit(bootPending, i);
+	}
+
+	for (byte i = 0; i < RING_PANEL_COUNT && pending; i++)
+	{
+		if (!PanelBit(bootPending, i))
+		{
+			continue;
+		}
+
+		// Later panels wait their turn, the wall lights in order.
+		// A panel over budget by itself boots once the others have settled.
+		unsigned int inrushMa = BootCurrent(i).inrushMa;
+		if (drawMa + inrushMa > RING_BOOT_BUDGET_MA && inrush)
+		{
+			return false;
+		}
+
+		drawMa += inrushMa;
+		inrush = true;
+		bootMillis[i] = now;
+		SetPanelBit(bootInrush, i);
+		bootPending[i >> 3] &= ~(1 << (i & 7));
+		SetPanelBit(bootupPanels, i);
+	}
+
+	// A rate change before every panel has seen its bootup bit could lose the frame that carries it.
+	if (negotiate && !bootLitPending)
+	{
+		negotiate = false;
+		negotiating = true;
+		negotiateMillis = millis();
+		ringBaudState = baudIdle;
+	}
+
+	return true;
 }
 
 
@@ -236,7 +1293,8 @@ int CountTruesInArray(bool *arr, int size)
 }
 
 // Disperses a quantity of true values within a bool array.
-bool RandomArrayFill(bool *array, int amountOfTrues, int size)
+// Pass a stream to make the same choice on every panel drawing from it.
+bool RandomArrayFill(bool *array, int amountOfTrues, int size, lockstepRandom *stream = NULL)
 {
 	if (amountOfTrues > size)
 	{
@@ -250,7 +1308,7 @@ bool RandomArrayFill(bool *array, int amountOfTrues, int size)
 
 	while (CountTruesInArray(array, size) != amountOfTrues)
 	{
-		array[random(0, size)] = true;
+		array[stream ? stream->next(0, size) : random(0, size)] = true;
 	}
 
 	return true;
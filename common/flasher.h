@@ -1,6 +1,9 @@
 
 // Crude LED flashing pattern generator.
-// Not intended for precise timer.
+// Each flasher is a phase accumulator, elapsed micros are added to a 32 bit
+// phase at a fixed point rate worked out when the delay or pattern changes.
+// Leftover time carries into the next call, so periods do not drift, and a
+// call costs a few integer multiplies rather than float math.
 //
 // Version 1.0
 
@@ -8,6 +11,25 @@
 #define FLASHER_H
 
 #include <Arduino.h>
+#include <frameClock.h>
+#include <waveTable.h>
+
+// Clock the flashers read, the time latched for this pass of loop().
+// A host build can point it at a simulated clock.
+// Steps are timed as unsigned differences, so flashers run through the micros() wrap every 71.6 minutes.
+#ifndef FLASHER_CLOCK
+#define FLASHER_CLOCK FrameMicros
+#endif
+
+// Half a cycle, in FLASHER_PHASE units.
+#define FLASHER_PHASE_HALF 0x80000000UL
+
+// Fraction bits of the phase rate, periods are limited to FLASHER_MAX_PERIOD so the fraction fits 32 bits.
+#define FLASHER_RATE_FRAC_BITS 7
+#define FLASHER_MAX_PERIOD 0x1FFFFFFUL
+
+// On time of the random patterns' flash.
+#define FLASHER_RANDOM_ON_MICROS 100000UL
 
 enum class Pattern
 {
@@ -20,6 +42,90 @@ enum class Pattern
     RandomReverseFlash
 };
 
+inline bool FlasherRandom(Pattern pattern)
+{
+    return pattern == Pattern::RandomFlash || pattern == Pattern::RandomReverseFlash;
+}
+
+// Cycle length in micros, for the random patterns the current on or off time.
+unsigned long FlasherPeriod(Pattern pattern, int delay, bool on)
+{
+    unsigned long period;
+
+    if (FlasherRandom(pattern))
+    {
+        period = on ? FLASHER_RANDOM_ON_MICROS : random(delay / 2, delay + delay / 2) * 1000UL;
+    }
+    else
+    {
+        period = delay * 1000UL;
+    }
+
+    if (period == 0)
+    {
+        return 1;
+    }
+
+    return period > FLASHER_MAX_PERIOD ? FLASHER_MAX_PERIOD : period;
+}
+
+// Phase per microsecond, 2^32 / period. Divides, so only called when the period changes.
+void FlasherRate(unsigned long period, uint32_t &rate, byte &rateFrac)
+{
+    // The remainder is below the period so it shifts into the fraction without overflow.
+    rate = 0xFFFFFFFFUL / period;
+    unsigned long remainder = 0xFFFFFFFFUL % period + 1;
+    if (remainder == period)
+    {
+        rate++;
+        remainder = 0;
+    }
+    rateFrac = (remainder << FLASHER_RATE_FRAC_BITS) / period;
+}
+
+// Adds elapsed micros to a phase, returns true if a cycle ended.
+bool FlasherAdvance(uint32_t &phase, byte &phaseFrac, uint32_t rate, byte rateFrac, unsigned long period, unsigned long elapsed)
+{
+    bool wrapped = false;
+
+    if (elapsed >= period)
+    {
+        elapsed %= period;
+        wrapped = true;
+    }
+
+    unsigned long frac = elapsed * rateFrac + phaseFrac;
+    uint32_t oldPhase = phase;
+
+    phaseFrac = frac & ((1 << FLASHER_RATE_FRAC_BITS) - 1);
+    phase += elapsed * rate + (frac >> FLASHER_RATE_FRAC_BITS);
+
+    return wrapped || phase < oldPhase;
+}
+
+// Pattern value at a phase, on is the random patterns' on time.
+int FlasherValue(Pattern pattern, uint32_t phase, bool on, int maxPwm)
+{
+    switch (pattern)
+    {
+    case Pattern::RampUp:
+        return ((long)(maxPwm + 1) * (phase >> 16)) >> 16;
+    case Pattern::Sin:
+        return WavePwm(WaveHalfSin(phase >> 16), maxPwm);
+    case Pattern::OnOff:
+        return phase < FLASHER_PHASE_HALF ? maxPwm : 0;
+    case Pattern::Flash:
+        // On for the first tenth.
+        return phase < 0xFFFFFFFFUL / 10 ? maxPwm : 0;
+    case Pattern::RandomFlash:
+        return on ? maxPwm : 0;
+    case Pattern::RandomReverseFlash:
+        return on ? 0 : maxPwm;
+    default:
+        return maxPwm;
+    }
+}
+
 class flasher
 {
 
@@ -29,12 +135,26 @@ private:
     int _maxPwm;
     int _pwmValue = 0;
     bool _repeat = true;
-    float _microsPerStep;
-    unsigned long _oldMicros;
+    uint32_t _oldMicros = FLASHER_CLOCK(); // 32 bits as on the AVR, so differences wrap with micros() on a host too.
+
+    // A full cycle is 2^32, the random patterns count each on and off time as a cycle.
+    // Phases are uint32_t rather than unsigned long so they wrap at a cycle on a host too.
+    uint32_t _phase = 0;
+    byte _phaseFrac = 0;
+    unsigned long _period;
+    uint32_t _rate; // Phase per microsecond.
+    byte _rateFrac;
 
-    byte sinIndex;
-    bool toggle = false;
+    bool toggle = true; // Random patterns, in the on time.
     bool _endOfCycle;
+    bool _ticked = false; // _pwmValue is current for _oldMicros.
+
+    inline void updateRate()
+    {
+        _period = FlasherPeriod(_pattern, _delay, toggle);
+        FlasherRate(_period, _rate, _rateFrac);
+        _ticked = false;
+    }
 
 public:
     // Default Constructor
@@ -43,6 +163,7 @@ public:
         _pattern = Pattern::Sin;
         _maxPwm = 255;
         _delay = 1000;
+        updateRate();
     }
 
     // Constructor.
@@ -52,24 +173,35 @@ public:
         _pattern = pattern;
         _maxPwm = maxPwm;
         _delay = delay;
+        updateRate();
     }
 
     inline void setDelay(int delay)
     {
-        _delay = delay;
+        if (_delay != delay)
+        {
+            _delay = delay;
+            updateRate();
+        }
     }
 
     inline void setPattern(Pattern pattern)
     {
-        _pattern = pattern;
+        if (_pattern != pattern)
+        {
+            _pattern = pattern;
+            updateRate();
+        }
     }
 
     inline void reset()
     {
-        _oldMicros = micros();
-        sinIndex = 0;
+        _oldMicros = FLASHER_CLOCK();
+        _phase = 0;
+        _phaseFrac = 0;
         _pwmValue = 0;
         _endOfCycle = false;
+        _ticked = false;
     }
 
     inline void repeat(bool repeat)
@@ -92,105 +224,47 @@ public:
         return _maxPwm;
     }
 
-    inline int getPwmValue()
+    // Advances to now, call once per frame. Ticks at the same time again are free.
+    void tick(unsigned long now)
     {
-
-        if (_endOfCycle && !_repeat)
+        if ((_endOfCycle && !_repeat) || (_ticked && now == _oldMicros))
         {
-            return 0;
+            return;
         }
 
-        unsigned long curMicros = micros();
+        bool wrapped = FlasherAdvance(_phase, _phaseFrac, _rate, _rateFrac, _period, (uint32_t)(now - _oldMicros));
+        _oldMicros = now;
 
-        if ((curMicros - _oldMicros) > _microsPerStep)
+        if (wrapped && FlasherRandom(_pattern))
         {
-            int stepsPassed = (float)(curMicros - _oldMicros) / _microsPerStep;
-
-            if (_pattern == Pattern::Solid)
+            if (toggle && _pattern == Pattern::RandomFlash)
             {
-                //_microsPerStep = (float)_delay * 1000.0;
-
-                _pwmValue = _maxPwm;
+                _endOfCycle = true;
             }
+            toggle = !toggle;
+            updateRate();
+        }
+        else if (wrapped && (_pattern == Pattern::RampUp || _pattern == Pattern::Sin))
+        {
+            _endOfCycle = true;
+        }
 
-            if (_pattern == Pattern::RampUp)
-            {
-                _microsPerStep = 1.0 / (((float)_maxPwm / (float)_delay) / 1000.0);
-                _pwmValue += stepsPassed;
-
-                if (_pwmValue > _maxPwm)
-                {
-                    _pwmValue = 0;
-                    _endOfCycle = true;
-                }
-            }
-            else if (_pattern == Pattern::Sin)
-            {
-                _microsPerStep = 1.0 / ((180.0 / (float)_delay) / 1000.0);
-                sinIndex += stepsPassed;
-                if (sinIndex > 180)
-                {
-                    sinIndex = 0;
-                    _endOfCycle = true;
-                }
-				// TODO: use sin look up table.
-                _pwmValue = _maxPwm * sin(radians(sinIndex));
-            }
-            else if (_pattern == Pattern::OnOff)
-            {
-                _microsPerStep = ((float)_delay / 2.0) * 1000.0;
-                toggle = !toggle;
-                _pwmValue = toggle ? _maxPwm : 0;
-            }
-            else if (_pattern == Pattern::Flash)
-            {
-                if (toggle)
-                {
-                    toggle = false;
-                    _microsPerStep = ((float)_delay / 10.0) * 1000.0 * 9;
-                }
-                else
-                {
-                    toggle = true;
-                    _microsPerStep = ((float)_delay / 10.0) * 1000.0;
-                }
-                _pwmValue = toggle ? _maxPwm : 0;
-            }
-            else if (_pattern == Pattern::RandomFlash)
-            {
-                if (toggle)
-                {
-                    toggle = false;
-                    _microsPerStep = ((float)random(_delay / 2, _delay * 1.5)) * 1000.0;
-                    _endOfCycle = true;
-                }
-                else
-                {
-                    toggle = true;
-                    _microsPerStep = 100 * 1000.0;
-                }
-                _pwmValue = toggle ? _maxPwm : 0;
-            }
-            else if (_pattern == Pattern::RandomReverseFlash)
-            {
-                if (toggle)
-                {
-                    toggle = false;
-                    _microsPerStep = ((float)random(_delay / 2, _delay * 1.5)) * 1000.0;
-                }
-                else
-                {
-                    toggle = true;
-                    _microsPerStep = 100 * 1000.0;
-                }
-                _pwmValue = toggle ? 0 : _maxPwm;
-            }
+        _pwmValue = FlasherValue(_pattern, _phase, toggle, _maxPwm);
+        _ticked = true;
+    }
 
-            _oldMicros = curMicros;
-        }
+    // Value as of the last tick(), reading it does not advance the flasher.
+    inline int value()
+    {
+        return _endOfCycle && !_repeat ? 0 : _pwmValue;
+    }
 
-        return _pwmValue;
+    // Ticks to the frame's time then reads the value.
+    inline int getPwmValue()
+    {
+        tick(FLASHER_CLOCK());
+        return value();
     }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,178 @@
+// flasherBank
+//
+// N flashers advanced together, for panels driving rows of LEDs from one pattern set.
+// State is kept in parallel arrays rather than N flasher objects. update()
+// reads the clock once and advances every flasher in one pass, values are
+// then read back, or copied straight into a PCA9685 channel array.
+// Patterns behave as in flasher.h, which holds the shared phase math.
+//
+// Version 1.0
+
+#ifndef FLASHER_BANK_H
+#define FLASHER_BANK_H
+
+#include <Arduino.h>
+#include <flasher.h>
+
+enum FlasherBankFlags
+{
+  flasherOn = 0x01, // Random patterns, in the on time.
+  flasherEndOfCycle = 0x02,
+  flasherNoRepeat = 0x04
+};
+
+template <byte N>
+class flasherBank
+{
+
+private:
+  int _maxPwm;
+  uint32_t _oldMicros;
+
+  uint32_t _phase[N];
+  uint32_t _rate[N];
+  unsigned long _period[N];
+  byte _phaseFrac[N];
+  byte _rateFrac[N];
+  byte _flags[N];
+  Pattern _pattern[N];
+  int _delay[N];
+  uint16_t _value[N];
+
+  void updateRate(byte i)
+  {
+    _period[i] = FlasherPeriod(_pattern[i], _delay[i], _flags[i] & flasherOn);
+    FlasherRate(_period[i], _rate[i], _rateFrac[i]);
+  }
+
+public:
+  // Delay in milliseconds, every flasher starts with the same pattern.
+  flasherBank(Pattern pattern = Pattern::Sin, int delay = 1000, int maxPwm = 255)
+  {
+    _maxPwm = maxPwm;
+    _oldMicros = FLASHER_CLOCK();
+
+    for (byte i = 0; i < N; i++)
+    {
+      _phase[i] = 0;
+      _phaseFrac[i] = 0;
+      _flags[i] = flasherOn;
+      _pattern[i] = pattern;
+      _delay[i] = delay;
+      _value[i] = 0;
+      updateRate(i);
+    }
+  }
+
+  inline void setDelay(byte i, int delay)
+  {
+    if (_delay[i] != delay)
+    {
+      _delay[i] = delay;
+      updateRate(i);
+    }
+  }
+
+  inline void setPattern(byte i, Pattern pattern)
+  {
+    if (_pattern[i] != pattern)
+    {
+      _pattern[i] = pattern;
+      updateRate(i);
+    }
+  }
+
+  void setPattern(Pattern pattern)
+  {
+    for (byte i = 0; i < N; i++)
+    {
+      setPattern(i, pattern);
+    }
+  }
+
+  inline void repeat(byte i, bool repeat)
+  {
+    _flags[i] = repeat ? _flags[i] & ~flasherNoRepeat : _flags[i] | flasherNoRepeat;
+  }
+
+  inline void reset(byte i)
+  {
+    _phase[i] = 0;
+    _phaseFrac[i] = 0;
+    _value[i] = 0;
+    _flags[i] &= ~flasherEndOfCycle;
+  }
+
+  inline bool endOfCycle(byte i)
+  {
+    if (_flags[i] & flasherEndOfCycle)
+    {
+      _flags[i] &= ~flasherEndOfCycle;
+      return true;
+    }
+    return false;
+  }
+
+  inline int getMaxPwm()
+  {
+    return _maxPwm;
+  }
+
+  // Advances every flasher to the current time, call once per frame.
+  void update()
+  {
+    uint32_t curMicros = FLASHER_CLOCK();
+    uint32_t elapsed = curMicros - _oldMicros;
+    _oldMicros = curMicros;
+
+    for (byte i = 0; i < N; i++)
+    {
+      byte flags = _flags[i];
+
+      // A finished flasher that does not repeat holds 0 until endOfCycle() is read.
+      if ((flags & (flasherEndOfCycle | flasherNoRepeat)) == (flasherEndOfCycle | flasherNoRepeat))
+      {
+        _value[i] = 0;
+        continue;
+      }
+
+      Pattern pattern = _pattern[i];
+
+      if (FlasherAdvance(_phase[i], _phaseFrac[i], _rate[i], _rateFrac[i], _period[i], elapsed))
+      {
+        if (FlasherRandom(pattern))
+        {
+          if ((flags & flasherOn) && pattern == Pattern::RandomFlash)
+          {
+            flags |= flasherEndOfCycle;
+          }
+          flags ^= flasherOn;
+          _flags[i] = flags;
+          updateRate(i);
+        }
+        else if (pattern == Pattern::RampUp || pattern == Pattern::Sin)
+        {
+          flags |= flasherEndOfCycle;
+          _flags[i] = flags;
+        }
+      }
+
+      _value[i] = FlasherValue(pattern, _phase[i], flags & flasherOn, _maxPwm);
+    }
+  }
+
+  // Value as of the last update().
+  inline uint16_t value(byte i)
+  {
+    return _value[i];
+  }
+
+  // Advances every flasher and copies the values into pwms from first on, e.g. for setChannelsPWM().
+  void update(uint16_t *pwms, byte first = 0)
+  {
+    update();
+    memcpy(pwms + first, _value, sizeof(_value));
+  }
+};
+
+#endif
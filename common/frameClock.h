@@ -0,0 +1,34 @@
+// frameClock
+//
+// Time latched once per pass of loop().
+// msTimer and flasher read the latched time, so every check in one pass sees
+// the same now, and the clock is read twice per pass instead of at every check.
+//
+// Version 1.0
+
+#ifndef FRAME_CLOCK_H
+#define FRAME_CLOCK_H
+
+#include <Arduino.h>
+
+unsigned long frameMillis = 0;
+unsigned long frameMicros = 0;
+
+// Call first thing in loop(), BeginControlData() latches it for setup().
+inline void LatchFrameClock()
+{
+  frameMicros = micros();
+  frameMillis = millis();
+}
+
+inline unsigned long FrameMillis()
+{
+  return frameMillis;
+}
+
+inline unsigned long FrameMicros()
+{
+  return frameMicros;
+}
+
+#endif
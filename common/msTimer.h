@@ -10,27 +10,35 @@
 
 
 #include <Arduino.h>
+#include <frameClock.h>
+
+// Clock the timers read, the time latched for this pass of loop().
+// A host build can point it at a simulated clock.
+#ifndef MS_TIMER_CLOCK
+#define MS_TIMER_CLOCK FrameMillis
+#endif
 
 // Non-blocking millisecond timer.
+// Times are compared as unsigned differences, so timers run through the millis() wrap every 49.7 days.
 class msTimer
 {
 
 private:
-  unsigned long _oldMillis;
+  uint32_t _oldMillis; // 32 bits as on the AVR, so differences wrap with millis() on a host too.
   unsigned long _delay;
 
 public:
   // Default Constructor.
   msTimer()
   {
-    _oldMillis = millis();
+    _oldMillis = MS_TIMER_CLOCK();
     _delay = 1000;
   }
 
   // Constructor.
   msTimer(unsigned long delay = 0)
   {
-    _oldMillis = millis();
+    _oldMillis = MS_TIMER_CLOCK();
     _delay = delay;
   }
 
@@ -38,25 +46,28 @@ public:
   // Reset delay.
   inline bool elapsed()
   {
-    if ((_oldMillis + _delay) < millis())
+    uint32_t now = MS_TIMER_CLOCK();
+
+    if ((uint32_t)(now - _oldMillis) > _delay)
     {
-      _oldMillis = millis();
+      _oldMillis = now;
       return 1;
     }
 
     return 0;
   }
 
+  // Next elapsed() returns true.
   inline void ForceTrigger()
   {
-    _oldMillis = 0;
+    _oldMillis = MS_TIMER_CLOCK() - _delay - 1;
   }
 
   // Set delay and reset timer.
   inline void setDelayAndReset(unsigned long delay)
   {
     _delay = delay;
-    _oldMillis = millis();
+    _oldMillis = MS_TIMER_CLOCK();
   }
 
   // Set delay and reset timer if delay is different.
@@ -64,7 +75,7 @@ public:
   {
     if (_delay != delay)
     {
-      _oldMillis = millis();
+      _oldMillis = MS_TIMER_CLOCK();
       _delay = delay;
     }
   }
@@ -72,7 +83,7 @@ public:
   // Reset timer.
   inline void resetDelay()
   {
-    _oldMillis = millis();
+    _oldMillis = MS_TIMER_CLOCK();
   }
 
   //deconstructor
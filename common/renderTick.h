@@ -0,0 +1,118 @@
+// renderTick
+//
+// Fixed rate frame clock for a panel's rendering.
+// The Timer2 overflow interrupt raises a frame flag RENDER_TICK_HZ times a
+// second, a panel renders once per flag and services its inputs and the ring
+// in the time left over. A frame still pending when the next one is due is
+// dropped and counted, renderFramesDropped climbing means the panel is over
+// its frame budget.
+// Timer2 is left as the Arduino core sets it up, phase correct PWM at clk/64,
+// so analogWrite() on pins 3 and 11 is unaffected. Its overflow every
+// 510 x 64 cycles is divided down to the frame rate.
+// Animations timed in milliseconds step from frames with a renderTimer, which
+// steps as often as the delay says even when the delay is under two frames.
+//
+// Version 1.0
+
+#ifndef RENDER_TICK_H
+#define RENDER_TICK_H
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+
+#ifndef RENDER_TICK_HZ
+#define RENDER_TICK_HZ 100
+#endif
+
+// Frame period in milliseconds.
+#define RENDER_TICK_MS (1000 / RENDER_TICK_HZ)
+
+#define RENDER_TICK_OVERFLOW_CYCLES (510UL * 64)
+#define RENDER_TICK_FRAME_CYCLES (F_CPU / RENDER_TICK_HZ)
+
+volatile bool renderTickPending = false;
+
+// Frames dropped since boot, saturates.
+volatile unsigned int renderFramesDropped = 0;
+
+ISR(TIMER2_OVF_vect)
+{
+  static unsigned long cycles = 0;
+
+  cycles += RENDER_TICK_OVERFLOW_CYCLES;
+
+  if (cycles < RENDER_TICK_FRAME_CYCLES)
+  {
+    return;
+  }
+
+  cycles -= RENDER_TICK_FRAME_CYCLES;
+
+  if (!renderTickPending)
+  {
+    renderTickPending = true;
+  }
+  else if (renderFramesDropped < 0xFFFF)
+  {
+    renderFramesDropped++;
+  }
+}
+
+void BeginRenderTick()
+{
+  TIMSK2 |= _BV(TOIE2);
+}
+
+// True once per frame, call every pass of loop() and render when it returns true.
+inline bool RenderTickDue()
+{
+  if (!renderTickPending)
+  {
+    return false;
+  }
+
+  renderTickPending = false;
+  return true;
+}
+
+// Steps an animation every delay milliseconds from render frames.
+// A msTimer polled once a frame fires on the frame after its delay, so a 10 ms
+// delay steps every 20 ms. Here the time left over carries into the next
+// frame, and a delay shorter than a frame steps more than once in it.
+class renderTimer
+{
+
+private:
+  unsigned int _delay;
+  unsigned int _elapsed;
+
+public:
+  renderTimer(unsigned int delay)
+  {
+    _elapsed = 0;
+    setDelay(delay);
+  }
+
+  // Delays under 1 ms step once a millisecond.
+  void setDelay(int delay)
+  {
+    _delay = delay > 0 ? delay : 1;
+  }
+
+  // Steps due this frame, call once per frame.
+  byte steps()
+  {
+    byte steps = 0;
+
+    _elapsed += RENDER_TICK_MS;
+    while (_elapsed >= _delay)
+    {
+      _elapsed -= _delay;
+      steps++;
+    }
+
+    return steps;
+  }
+};
+
+#endif
@@ -0,0 +1,282 @@
+// ringBaud
+//
+// Runtime baud rate negotiation for the panel ring.
+//
+// The master probes each faster rate in turn:
+//   1. Sends a probe frame at the committed rate, every panel relays it and then switches.
+//   2. Once the probe returns, waits for the slowest loop() and switches itself.
+//   3. Sends verify frames, commits once enough return intact, otherwise falls back.
+// Panels return to the committed rate when no commit arrives, and every board
+// returns to the base rate when the ring goes quiet, so a reset master or a
+// noisy link always recovers at BAUD_RATE.
+//
+// Version 1.0
+
+#ifndef RING_BAUD_H
+#define RING_BAUD_H
+
+#include <Arduino.h>
+#include <msTimer.h>
+#include <ringSerial.h>
+#include <ringFrame.h>
+#include <ringSchedule.h>
+
+// Rates with small divisor error at 16 MHz, index 0 is the base rate every board starts at.
+const unsigned long ringBaudRates[] PROGMEM = {BAUD_RATE, 115200, 250000, 500000, 1000000};
+#define RING_BAUD_RATE_COUNT (sizeof(ringBaudRates) / sizeof(ringBaudRates[0]))
+
+#define RING_BAUD_PROBE_MS 500        // Wait for the probe to return.
+#define RING_BAUD_GUARD_MS 250        // Longest panel loop() time, panels switch before the master.
+#define RING_BAUD_TRIAL_MS 600        // Master verify window.
+#define RING_BAUD_PANEL_TRIAL_MS 1000 // Panel waits this long for a commit.
+#define RING_BAUD_LOSS_MS 2000        // Fall back to the base rate after this long without a valid frame.
+#define RING_BAUD_RETRY_MS 10000      // Renegotiate this long after a fallback.
+#define RING_BAUD_VERIFY_FRAMES 16
+
+// Baud frame payload: command, rate index.
+enum BaudCommands
+{
+  baudProbe = 0,
+  baudVerify = 1,
+  baudCommit = 2
+};
+
+enum BaudStates
+{
+  baudIdle,
+  baudProbing,
+  baudGuard,
+  baudTrial,
+  baudSettle,
+  baudDone
+};
+
+byte ringBaudState = baudIdle;
+
+// Rate index in use and the last index every panel confirmed.
+byte ringBaudIndex = 0;
+byte ringBaudCommitted = 0;
+
+// Highest index still worth probing, lowered by failed trials.
+byte ringBaudCeiling = RING_BAUD_RATE_COUNT - 1;
+
+// Failed trials and fallbacks per rate, reported in the status frame.
+unsigned int ringBaudErrorCounts[RING_BAUD_RATE_COUNT];
+
+bool ringBaudEchoed;
+byte ringBaudVerified;
+unsigned long ringBaudLastValidMillis;
+
+inline bool RingBaudNegotiating()
+{
+  return ringBaudState != baudDone;
+}
+
+inline unsigned long RingBaudRate(byte index)
+{
+  return pgm_read_dword(&ringBaudRates[index]);
+}
+
+void SetRingBaud(byte index)
+{
+  RingSerialFlush();
+  RingSerialSetBaud(RingBaudRate(index));
+  ringScheduler.setBaud(RingBaudRate(index));
+  ringBaudIndex = index;
+}
+
+void SendBaudFrame(byte command, byte index)
+{
+  byte payload[2] = {command, index};
+  SendFrame(baudFrame, payload, sizeof(payload));
+}
+
+// Master side of the negotiation, driven by RingBaudUpdate(), returns true once finished.
+// Restart by setting ringBaudState to baudIdle.
+bool RingBaudNegotiate()
+{
+  static msTimer timer(0);
+  static msTimer timerVerify(10);
+  static byte attempts;
+  static unsigned int crcErrorBase;
+
+  switch (ringBaudState)
+  {
+  case baudIdle:
+    if (ringLegacyProtocol || ringBaudCommitted >= ringBaudCeiling)
+    {
+      ringBaudState = baudDone;
+      break;
+    }
+    attempts = 0;
+    ringBaudEchoed = false;
+    SendBaudFrame(baudProbe, ringBaudCommitted + 1);
+    timer.setDelayAndReset(RING_BAUD_PROBE_MS);
+    ringBaudState = baudProbing;
+    break;
+
+  case baudProbing:
+    if (ringBaudEchoed)
+    {
+      timer.setDelayAndReset(RING_BAUD_GUARD_MS);
+      ringBaudState = baudGuard;
+    }
+    else if (timer.elapsed())
+    {
+      // Ring not closed, nothing to negotiate with.
+      if (++attempts >= 3)
+      {
+        ringBaudState = baudDone;
+        break;
+      }
+      SendBaudFrame(baudProbe, ringBaudCommitted + 1);
+    }
+    break;
+
+  case baudGuard:
+    if (timer.elapsed())
+    {
+      SetRingBaud(ringBaudCommitted + 1);
+      ringBaudVerified = 0;
+      timer.setDelayAndReset(RING_BAUD_TRIAL_MS);
+      ringBaudState = baudTrial;
+    }
+    break;
+
+  case baudTrial:
+  {
+    // Bytes in flight during the switch are garbled, count errors from the first verified frame.
+    if (ringBaudVerified == 0)
+    {
+      crcErrorBase = ringDecoder.crcErrorCount;
+    }
+
+    unsigned int errors = ringDecoder.crcErrorCount - crcErrorBase;
+
+    if (ringBaudVerified >= RING_BAUD_VERIFY_FRAMES && errors == 0)
+    {
+      // Sent twice, a panel that misses both drops back and the loss timeout recovers the ring.
+      SendBaudFrame(baudCommit, ringBaudIndex);
+      SendBaudFrame(baudCommit, ringBaudIndex);
+      ringBaudCommitted = ringBaudIndex;
+      ringBaudState = baudIdle;
+    }
+    else if (errors > 0 || timer.elapsed())
+    {
+      ringBaudErrorCounts[ringBaudIndex] += errors > 0 ? errors : 1;
+      ringBaudCeiling = ringBaudIndex - 1;
+      SetRingBaud(ringBaudCommitted);
+      // Outlast the panel trial so every panel is back before frames resume.
+      timer.setDelayAndReset(RING_BAUD_PANEL_TRIAL_MS);
+      ringBaudState = baudSettle;
+    }
+    else if (timerVerify.elapsed())
+    {
+      SendBaudFrame(baudVerify, ringBaudIndex);
+    }
+    break;
+  }
+
+  case baudSettle:
+    if (timer.elapsed())
+    {
+      ringBaudState = baudDone;
+    }
+    break;
+  }
+
+  return ringBaudState == baudDone;
+}
+
+// Handle a baud frame read from the ring.
+void RingBaudFrame(const byte *payload, bool masterPanel)
+{
+  byte command = payload[0];
+  byte index = payload[1];
+
+  if (index >= RING_BAUD_RATE_COUNT)
+  {
+    return;
+  }
+
+  if (masterPanel)
+  {
+    if (command == baudProbe && ringBaudState == baudProbing)
+    {
+      ringBaudEchoed = true;
+    }
+    else if (command == baudVerify && ringBaudState == baudTrial && ringBaudVerified < 255)
+    {
+      ringBaudVerified++;
+    }
+    return;
+  }
+
+  if (command == baudProbe && index != ringBaudIndex)
+  {
+    // The probe has already been relayed, switch once it has left.
+    SetRingBaud(index);
+  }
+  else if (command == baudCommit && index == ringBaudIndex)
+  {
+    ringBaudCommitted = index;
+  }
+}
+
+// Call on every valid frame.
+inline void RingBaudFrameValid()
+{
+  ringBaudLastValidMillis = millis();
+}
+
+// Negotiation and fallback supervision, call every loop.
+void RingBaudUpdate(bool masterPanel)
+{
+  static msTimer timerCommit(RING_BAUD_PANEL_TRIAL_MS);
+  static msTimer timerRetry(RING_BAUD_RETRY_MS);
+  static byte oldIndex;
+
+  // Panel trial without a commit.
+  if (!masterPanel)
+  {
+    if (ringBaudIndex != oldIndex)
+    {
+      oldIndex = ringBaudIndex;
+      timerCommit.resetDelay();
+    }
+
+    if (ringBaudIndex != ringBaudCommitted && timerCommit.elapsed())
+    {
+      SetRingBaud(ringBaudCommitted);
+    }
+  }
+
+  // Master negotiation in progress.
+  if (masterPanel && ringBaudState != baudDone)
+  {
+    RingBaudNegotiate();
+    return;
+  }
+
+  if (ringBaudIndex != 0 && (millis() - ringBaudLastValidMillis) > RING_BAUD_LOSS_MS)
+  {
+    if (masterPanel)
+    {
+      ringBaudErrorCounts[ringBaudIndex]++;
+      ringBaudCeiling = ringBaudIndex - 1;
+      timerRetry.resetDelay();
+    }
+
+    SetRingBaud(0);
+    ringBaudCommitted = 0;
+    ringBaudLastValidMillis = millis();
+  }
+
+  // Master renegotiates up to the lowered ceiling after a fallback.
+  if (masterPanel && ringBaudCommitted < ringBaudCeiling && timerRetry.elapsed())
+  {
+    ringBaudState = baudIdle;
+  }
+}
+
+#endif
@@ -0,0 +1,220 @@
+// ringBlock
+//
+// Versioned data blocks pushed by the master, e.g. effect parameters and programs.
+// A block is split into chunks, each in its own frame so the frame CRC covers
+// the chunk. A CRC over the whole block is checked once every chunk of a
+// version has arrived, then the block is applied in one copy. A block pushed
+// with the persist flag is also written to its EEPROM area and loaded at the
+// next boot, if the firmware's layout tag for the block still matches.
+// A block arriving at the master with a new version, e.g. from a tuning tool
+// spliced into the ring, is applied and pushed on to every panel.
+//
+// Version 1.0
+
+#ifndef RING_BLOCK_H
+#define RING_BLOCK_H
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <ringFrame.h>
+
+#define RING_BLOCK_CHUNK_SIZE 8
+// Received chunks are tracked in a byte.
+#define RING_BLOCK_MAX_SIZE (RING_BLOCK_CHUNK_SIZE * 8)
+
+#define RING_BLOCK_CHUNK_MS 20     // Master sends one chunk this often.
+#define RING_BLOCK_REPEAT_MS 10000 // Master repeats every block this often for panels that missed it.
+
+enum Blocks
+{
+  blockParams = 0, // ringParams.h
+  blockProgram,    // ringVm.h
+  blockCount
+};
+
+// EEPROM areas, size then version, CRC, layout tag and the block.
+// Each area is the header and its block's largest size, params 5 + 28, program 5 + 64.
+#define RING_BLOCK_EEPROM_HEADER 5
+const int ringBlockEeprom[blockCount] = {0, 40};
+
+// Block frame payload.
+enum BlockFields
+{
+  blockId = 0,
+  blockVersion, // Little endian, 0 is the built in block.
+  blockChunk = blockVersion + 2,
+  blockFlags,
+  blockCrc,
+  blockData,
+  blockFrameSize = blockData + RING_BLOCK_CHUNK_SIZE
+};
+
+enum BlockFlags
+{
+  blockPersist = 0x01
+};
+
+struct ringBlock
+{
+  byte *data;
+  byte size;
+  // Bumped by the firmware whenever the block's contents change meaning.
+  byte layout;
+  uint16_t version;
+  byte flags;
+  // Rejects malformed contents before they are applied, may be NULL.
+  bool (*verify)(const byte *data);
+};
+
+// Unregistered blocks have no data and are ignored.
+ringBlock ringBlocks[blockCount];
+
+// Chunks of the block being received, one block at a time.
+byte ringBlockStaging[RING_BLOCK_MAX_SIZE];
+byte ringBlockStagingId = blockCount;
+uint16_t ringBlockStagingVersion = 0;
+byte ringBlockStagingChunks = 0;
+
+inline byte BlockChunkCount(byte size)
+{
+  return (size + RING_BLOCK_CHUNK_SIZE - 1) / RING_BLOCK_CHUNK_SIZE;
+}
+
+byte BlockCrc(const byte *data, byte size)
+{
+  byte crc = 0;
+  for (byte i = 0; i < size; i++)
+  {
+    crc = Crc8(crc, data[i]);
+  }
+  return crc;
+}
+
+void SaveBlock(byte id)
+{
+  ringBlock &block = ringBlocks[id];
+  int address = ringBlockEeprom[id];
+
+  EEPROM.update(address, block.size);
+  EEPROM.put(address + 1, block.version);
+  EEPROM.update(address + 3, BlockCrc(block.data, block.size));
+  EEPROM.update(address + 4, block.layout);
+
+  for (byte i = 0; i < block.size; i++)
+  {
+    EEPROM.update(address + RING_BLOCK_EEPROM_HEADER + i, block.data[i]);
+  }
+}
+
+// Registers a block holding its built in contents, then loads the saved block if it is intact, the same size
+// and saved with the same layout tag.
+void RegisterBlock(byte id, void *data, byte size, byte layout, bool (*verify)(const byte *data) = NULL)
+{
+  ringBlock &block = ringBlocks[id];
+  int address = ringBlockEeprom[id];
+
+  block.data = (byte *)data;
+  block.size = min(size, RING_BLOCK_MAX_SIZE);
+  block.layout = layout;
+  block.version = 0;
+  block.flags = 0;
+  block.verify = verify;
+
+  if (EEPROM.read(address) != block.size || EEPROM.read(address + 4) != layout)
+  {
+    return;
+  }
+
+  for (byte i = 0; i < block.size; i++)
+  {
+    ringBlockStaging[i] = EEPROM.read(address + RING_BLOCK_EEPROM_HEADER + i);
+  }
+
+  if (BlockCrc(ringBlockStaging, block.size) == EEPROM.read(address + 3) && (verify == NULL || verify(ringBlockStaging)))
+  {
+    memcpy(block.data, ringBlockStaging, block.size);
+    EEPROM.get(address + 1, block.version);
+    block.flags = blockPersist;
+  }
+}
+
+// Master only, call once a block's contents have been changed, the new version is pushed to every panel.
+void BlockChanged(byte id)
+{
+  ringBlocks[id].version++;
+}
+
+void SendBlockChunk(byte id, byte chunk)
+{
+  ringBlock &block = ringBlocks[id];
+  byte payload[blockFrameSize];
+  byte offset = chunk * RING_BLOCK_CHUNK_SIZE;
+
+  payload[blockId] = id;
+  memcpy(payload + blockVersion, &block.version, 2);
+  payload[blockChunk] = chunk;
+  payload[blockFlags] = block.flags;
+  payload[blockCrc] = BlockCrc(block.data, block.size);
+  memset(payload + blockData, 0, RING_BLOCK_CHUNK_SIZE);
+  memcpy(payload + blockData, block.data + offset, min(RING_BLOCK_CHUNK_SIZE, block.size - offset));
+
+  SendFrame(blockFrame, payload, sizeof(payload));
+}
+
+// Handle a block frame read from the ring, returns true once a new block has been applied.
+bool RingBlockFrame(const byte *payload)
+{
+  byte id = payload[blockId];
+  uint16_t version;
+  memcpy(&version, payload + blockVersion, 2);
+  byte chunk = payload[blockChunk];
+
+  if (id >= blockCount || ringBlocks[id].data == NULL)
+  {
+    return false;
+  }
+
+  ringBlock &block = ringBlocks[id];
+  byte chunkCount = BlockChunkCount(block.size);
+
+  if (version == block.version || chunk >= chunkCount)
+  {
+    return false;
+  }
+
+  if (id != ringBlockStagingId || version != ringBlockStagingVersion)
+  {
+    ringBlockStagingId = id;
+    ringBlockStagingVersion = version;
+    ringBlockStagingChunks = 0;
+  }
+
+  memcpy(ringBlockStaging + chunk * RING_BLOCK_CHUNK_SIZE, payload + blockData, RING_BLOCK_CHUNK_SIZE);
+  ringBlockStagingChunks |= 1 << chunk;
+
+  if (ringBlockStagingChunks != (byte)((1 << chunkCount) - 1))
+  {
+    return false;
+  }
+
+  ringBlockStagingChunks = 0;
+
+  // Chunks from two pushes of one version can only mix if a tool reused a version.
+  if (BlockCrc(ringBlockStaging, block.size) != payload[blockCrc] || (block.verify && !block.verify(ringBlockStaging)))
+  {
+    return false;
+  }
+
+  memcpy(block.data, ringBlockStaging, block.size);
+  block.version = version;
+  block.flags = payload[blockFlags];
+
+  if (block.flags & blockPersist)
+  {
+    SaveBlock(id);
+  }
+
+  return true;
+}
+
+#endif
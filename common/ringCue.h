@@ -0,0 +1,171 @@
+// ringCue
+//
+// Choreography fired on every panel at the same ring time.
+// The master sends "cue n at ring time t" with t far enough ahead to outrun
+// the ring, each panel looks the cue up in a table of steps kept in flash and
+// runs each step at t plus the step's offset. Panels fire together to within
+// the ring clock's error plus one pass of their loop().
+//
+// Version 1.0
+
+#ifndef RING_CUE_H
+#define RING_CUE_H
+
+#include <Arduino.h>
+#include <ringFrame.h>
+#include <ringTime.h>
+#include <ringBaud.h>
+
+// Cues are sent this far ahead of their ring time, well above the ring's p99 round trip.
+#define RING_CUE_LEAD_MS 100
+
+// Steps found this late, e.g. after a panel rejoins, are dropped rather than fired out of step.
+#define RING_CUE_LATE_MS 250
+
+// Steps scheduled per board.
+#define RING_CUE_QUEUE_SIZE 8
+
+enum Cues
+{
+  cueSentience = 0, // CPU Core detected sentience.
+  cueAbort = 1      // Sentience aborted.
+};
+
+// Cue frame payload: cue, ring time to fire at in milliseconds, little endian.
+enum CueFields
+{
+  cueId = 0,
+  cueFireAt,
+  cueFieldCount = cueFireAt + 4
+};
+
+// Step table entry, a cue runs every step with its id, each offsetMs after the cue's ring time.
+struct cueStep
+{
+  byte cue;
+  unsigned int offsetMs;
+  void (*handler)(byte cue);
+};
+
+struct scheduledStep
+{
+  unsigned long fireAt;
+  byte step;
+};
+
+scheduledStep ringCueQueue[RING_CUE_QUEUE_SIZE];
+byte ringCueCount = 0;
+
+// Steps dropped because the queue was full.
+unsigned int ringCueOverflowCount = 0;
+
+const cueStep *ringCueSteps = NULL;
+byte ringCueStepCount = 0;
+
+// Subscribe to cues, table must be in PROGMEM.
+void SetCueSteps(const cueStep *table, byte count)
+{
+  ringCueSteps = table;
+  ringCueStepCount = count;
+}
+
+// Schedules a cue's steps, a repeat of the last cue is ignored.
+void ScheduleCue(byte cue, unsigned long fireAt, bool masterPanel = false)
+{
+  static byte lastCue = 0xFF;
+  static unsigned long lastFireAt;
+
+  if (cue == lastCue && fireAt == lastFireAt)
+  {
+    return;
+  }
+  lastCue = cue;
+  lastFireAt = fireAt;
+
+  // Panels without the ring clock yet fire at once. The master's clock is the ring clock, it never locks.
+  if (!masterPanel && !ringTimeLocked)
+  {
+    fireAt = RingMillis();
+  }
+
+  for (byte i = 0; i < ringCueStepCount; i++)
+  {
+    cueStep entry;
+    memcpy_P(&entry, &ringCueSteps[i], sizeof(entry));
+
+    if (entry.cue != cue)
+    {
+      continue;
+    }
+
+    if (ringCueCount == RING_CUE_QUEUE_SIZE)
+    {
+      ringCueOverflowCount++;
+      continue;
+    }
+
+    ringCueQueue[ringCueCount].fireAt = fireAt + entry.offsetMs;
+    ringCueQueue[ringCueCount].step = i;
+    ringCueCount++;
+  }
+}
+
+// Master only, sends a cue to every panel and schedules it locally.
+// Sent twice, a panel that misses both still runs later cues.
+void SendCue(byte cue)
+{
+  uint32_t fireAt = RingMillis() + RING_CUE_LEAD_MS;
+  byte payload[cueFieldCount];
+  payload[cueId] = cue;
+  memcpy(payload + cueFireAt, &fireAt, 4);
+
+  // Frames in flight while rates switch would be garbled, legacy panels have no ring clock.
+  if (!RingBaudNegotiating() && !ringLegacyProtocol)
+  {
+    SendFrame(cueFrame, payload, sizeof(payload));
+    SendFrame(cueFrame, payload, sizeof(payload));
+  }
+  ScheduleCue(cue, fireAt, true);
+}
+
+// Handle a cue frame read from the ring, panels only.
+void RingCueFrame(const byte *payload)
+{
+  uint32_t fireAt;
+  memcpy(&fireAt, payload + cueFireAt, 4);
+  ScheduleCue(payload[cueId], fireAt);
+}
+
+// Runs the steps that are due, call every loop.
+void UpdateCues()
+{
+  if (ringCueCount == 0)
+  {
+    return;
+  }
+
+  unsigned long now = RingMillis();
+
+  for (byte i = 0; i < ringCueCount;)
+  {
+    long late = (long)(now - ringCueQueue[i].fireAt);
+
+    if (late < 0)
+    {
+      i++;
+      continue;
+    }
+
+    byte step = ringCueQueue[i].step;
+    ringCueQueue[i] = ringCueQueue[--ringCueCount];
+
+    if (late <= RING_CUE_LATE_MS)
+    {
+      cueStep entry;
+      memcpy_P(&entry, &ringCueSteps[step], sizeof(entry));
+      entry.handler(entry.cue);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,207 @@
+// ringEvent
+//
+// Typed events between panels.
+// An event is its source panel, an id and a value byte. Events posted on a
+// board are coalesced, a newer event with the same source and id replaces the
+// pending one, so a pot sweep sends only its latest position.
+// Panels send their pending events between the frames they relay, a frame per
+// source panel, the master sends its own after its control frame. The master
+// forwards other panels' event frames once more so every panel sees them, the
+// source panel strips its frame when it comes back around.
+// Panels subscribe with a table of handlers kept in flash.
+//
+// Requires Panels, PanelBit() and hostedPanels from common.h.
+//
+// Version 1.0
+
+#ifndef RING_EVENT_H
+#define RING_EVENT_H
+
+#include <Arduino.h>
+#include <ringSerial.h>
+#include <ringFrame.h>
+
+// Pending events per board, also the most events per frame.
+#define RING_EVENT_QUEUE_SIZE 4
+
+// Event frames from one panel are at least this far apart, coalescing fills the gap.
+#define RING_EVENT_MIN_MS 20
+
+// Matches any source in a handler table.
+#define EVENT_ANY_SOURCE 0xFF
+
+// Event ids, the control number is added to the kind, e.g. eventPot + 1 for a panel's second pot.
+enum Events
+{
+  eventButton = 0x10, // Value unused.
+  eventToggle = 0x20, // Value is the new state.
+  eventPot = 0x30,    // Value is the new position.
+  eventKindMask = 0xF0
+};
+
+// Event frame payload: source, then id and value per event.
+enum EventFields
+{
+  eventSource = 0,
+  eventList
+};
+
+struct ringEvent
+{
+  byte source;
+  byte id;
+  byte value;
+};
+
+// Handler table entry, matches when the source matches and (id & mask) == id.
+struct eventHandler
+{
+  byte source;
+  byte id;
+  byte mask;
+  void (*handler)(byte source, byte id, byte value);
+};
+
+// Pending events of every panel on the board, written by loop() and sent from the RX interrupt.
+volatile ringEvent ringEventQueue[RING_EVENT_QUEUE_SIZE];
+volatile byte ringEventCount = 0;
+
+// Events dropped because the queue was full.
+unsigned int ringEventOverflowCount = 0;
+
+const eventHandler *ringEventHandlers = NULL;
+byte ringEventHandlerCount = 0;
+
+// Subscribe to events, table must be in PROGMEM.
+void SetEventHandlers(const eventHandler *table, byte count)
+{
+  ringEventHandlers = table;
+  ringEventHandlerCount = count;
+}
+
+// Shared method among the projects.
+// Queues an event for the other panels, a pending event with the same source and id is replaced.
+void PostEvent(Panels source, byte id, byte value)
+{
+  byte oldSREG = SREG;
+  cli();
+
+  SetPanelBit(hostedPanels, source);
+
+  byte i = 0;
+  while (i < ringEventCount && (ringEventQueue[i].source != source || ringEventQueue[i].id != id))
+  {
+    i++;
+  }
+
+  if (i < RING_EVENT_QUEUE_SIZE)
+  {
+    ringEventQueue[i].source = source;
+    ringEventQueue[i].id = id;
+    ringEventQueue[i].value = value;
+    ringEventCount = max(ringEventCount, i + 1);
+  }
+  else
+  {
+    ringEventOverflowCount++;
+  }
+
+  SREG = oldSREG;
+}
+
+// Moves the first pending source's events into an event frame payload and returns its length, 0 if none.
+// Other sources' events stay pending, in order. Only call with interrupts disabled.
+byte TakeEvents(byte *payload)
+{
+  if (ringEventCount == 0)
+  {
+    return 0;
+  }
+
+  byte source = ringEventQueue[0].source;
+  byte length = eventList;
+  byte kept = 0;
+
+  payload[eventSource] = source;
+  for (byte i = 0; i < ringEventCount; i++)
+  {
+    if (ringEventQueue[i].source == source)
+    {
+      payload[length++] = ringEventQueue[i].id;
+      payload[length++] = ringEventQueue[i].value;
+    }
+    else
+    {
+      ringEventQueue[kept].source = ringEventQueue[i].source;
+      ringEventQueue[kept].id = ringEventQueue[i].id;
+      ringEventQueue[kept].value = ringEventQueue[i].value;
+      kept++;
+    }
+  }
+
+  ringEventCount = kept;
+  return length;
+}
+
+// Queues this board's pending events, only call with interrupts disabled and the relay between frames.
+void QueueEvents()
+{
+  byte payload[eventList + RING_EVENT_QUEUE_SIZE * 2];
+
+  // Leave them pending rather than overflow the relay.
+  while (ringEventCount > 0 && RingSerialTxFree() >= FRAME_WIRE_SIZE(sizeof(payload)))
+  {
+    QueueFrame(eventFrame, payload, TakeEvents(payload));
+  }
+}
+
+// Sends this board's pending events from loop(), used by the master.
+void SendEvents()
+{
+  byte payload[eventList + RING_EVENT_QUEUE_SIZE * 2];
+
+  for (;;)
+  {
+    byte oldSREG = SREG;
+    cli();
+    byte length = TakeEvents(payload);
+    SREG = oldSREG;
+
+    if (length == 0)
+    {
+      return;
+    }
+
+    SendFrame(eventFrame, payload, length);
+  }
+}
+
+// Calls the matching handlers for each event in a received event frame.
+// A board's own events are not dispatched back to it.
+void DispatchEvents(const byte *payload, byte length)
+{
+  byte source = payload[eventSource];
+
+  if (length < eventList || source >= MAX_PANELS || PanelBit(hostedPanels, source))
+  {
+    return;
+  }
+
+  for (byte i = eventList; i + 1 < length; i += 2)
+  {
+    byte id = payload[i];
+
+    for (byte h = 0; h < ringEventHandlerCount; h++)
+    {
+      eventHandler entry;
+      memcpy_P(&entry, &ringEventHandlers[h], sizeof(entry));
+
+      if ((entry.source == EVENT_ANY_SOURCE || entry.source == source) && (id & entry.mask) == entry.id)
+      {
+        entry.handler(source, id, payload[i + 1]);
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,339 @@
+// ringFrame
+//
+// Wire format for the panel ring.
+//
+//   END | version << 4 | type | length | payload ... | CRC-8 | END
+//
+// SLIP (RFC 1055) byte stuffing lets any value appear inside a frame.
+// SLIP is used rather than COBS because it can be decoded, patched and
+// re-encoded one byte at a time by the cut-through relay.
+// CRC-8 uses polynomial 0x07 over the header, length and payload.
+//
+// Version 1.0
+
+#ifndef RING_FRAME_H
+#define RING_FRAME_H
+
+#include <Arduino.h>
+#include <ringSerial.h>
+#include <ringSchedule.h>
+
+#define RING_PROTOCOL_VERSION 1
+#ifndef RING_FRAME_MAX_PAYLOAD
+#define RING_FRAME_MAX_PAYLOAD 32
+#endif
+
+#define SLIP_END 0xC0
+#define SLIP_ESC 0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+enum FrameTypes
+{
+  controlFrame = 0,
+  baudFrame = 1,
+  statusFrame = 2,
+  eventFrame = 3,
+  linkFrame = 4,
+  blockFrame = 5,
+  cueFrame = 6
+};
+
+// Mixed rings: define RING_LEGACY_PROTOCOL in the master's build_flags while panels
+// running the legacy firmware remain. Updated panels accept and relay both formats.
+#ifdef RING_LEGACY_PROTOCOL
+bool ringLegacyProtocol = true;
+#else
+bool ringLegacyProtocol = false;
+#endif
+
+const byte crc8Table[256] PROGMEM = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+    0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65, 0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D,
+    0xE0, 0xE7, 0xEE, 0xE9, 0xFC, 0xFB, 0xF2, 0xF5, 0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+    0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85, 0xA8, 0xAF, 0xA6, 0xA1, 0xB4, 0xB3, 0xBA, 0xBD,
+    0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2, 0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA,
+    0xB7, 0xB0, 0xB9, 0xBE, 0xAB, 0xAC, 0xA5, 0xA2, 0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+    0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32, 0x1F, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0D, 0x0A,
+    0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42, 0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A,
+    0x89, 0x8E, 0x87, 0x80, 0x95, 0x92, 0x9B, 0x9C, 0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+    0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC, 0xC1, 0xC6, 0xCF, 0xC8, 0xDD, 0xDA, 0xD3, 0xD4,
+    0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C, 0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44,
+    0x19, 0x1E, 0x17, 0x10, 0x05, 0x02, 0x0B, 0x0C, 0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+    0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B, 0x76, 0x71, 0x78, 0x7F, 0x6A, 0x6D, 0x64, 0x63,
+    0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B, 0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13,
+    0xAE, 0xA9, 0xA0, 0xA7, 0xB2, 0xB5, 0xBC, 0xBB, 0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+    0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB, 0xE6, 0xE1, 0xE8, 0xEF, 0xFA, 0xFD, 0xF4, 0xF3};
+
+inline byte Crc8(byte crc, byte c)
+{
+  return pgm_read_byte(&crc8Table[crc ^ c]);
+}
+
+inline byte FrameType(const byte *frame)
+{
+  return frame[0] & 0x0F;
+}
+
+inline byte FrameLength(const byte *frame)
+{
+  return frame[1];
+}
+
+inline const byte *FramePayload(const byte *frame)
+{
+  return frame + 2;
+}
+
+// Queue a frame byte with SLIP stuffing, only call with interrupts disabled.
+inline void SlipQueue(byte c)
+{
+  if (c == SLIP_END)
+  {
+    RingSerialQueue(SLIP_ESC);
+    RingSerialQueue(SLIP_ESC_END);
+  }
+  else if (c == SLIP_ESC)
+  {
+    RingSerialQueue(SLIP_ESC);
+    RingSerialQueue(SLIP_ESC_ESC);
+  }
+  else
+  {
+    RingSerialQueue(c);
+  }
+}
+
+// Write a frame byte with SLIP stuffing from loop().
+void SlipWrite(byte c)
+{
+  if (c == SLIP_END)
+  {
+    RingSerialWrite(SLIP_ESC);
+    RingSerialWrite(SLIP_ESC_END);
+  }
+  else if (c == SLIP_ESC)
+  {
+    RingSerialWrite(SLIP_ESC);
+    RingSerialWrite(SLIP_ESC_ESC);
+  }
+  else
+  {
+    RingSerialWrite(c);
+  }
+}
+
+// Worst case bytes on the wire for a frame, every byte stuffed.
+#define FRAME_WIRE_SIZE(length) (2 * ((length) + 3) + 2)
+
+// Encode a complete frame, put writes a stuffed byte and putEnd a delimiter.
+void EncodeFrame(byte type, const byte *payload, byte length, void (*put)(byte), void (*putEnd)(byte))
+{
+  byte header = (RING_PROTOCOL_VERSION << 4) | type;
+  byte crc = Crc8(Crc8(0, header), length);
+
+  // Leading END flushes any line noise on the receiver.
+  putEnd(SLIP_END);
+  put(header);
+  put(length);
+
+  for (byte i = 0; i < length; i++)
+  {
+    crc = Crc8(crc, payload[i]);
+    put(payload[i]);
+  }
+
+  put(crc);
+  putEnd(SLIP_END);
+}
+
+// Encode and transmit a complete frame, master only.
+// Charged to the master's share of the line, stuffing aside.
+void SendFrame(byte type, const byte *payload, byte length)
+{
+  EncodeFrame(type, payload, length, SlipWrite, RingSerialWrite);
+  ringScheduler.charge(length + 5);
+}
+
+// Encode and queue a complete frame, only call with interrupts disabled.
+// Check RingSerialTxFree() against FRAME_WIRE_SIZE() first.
+void QueueFrame(byte type, const byte *payload, byte length)
+{
+  EncodeFrame(type, payload, length, SlipQueue, RingSerialQueue);
+}
+
+// Relay hooks, called from the RX interrupt and defined by common.h.
+// Returns the payload byte to relay in place of the received byte.
+byte PatchRelayedByte(byte type, byte offset, byte c);
+// Called once the relayed frame's CRC has been checked.
+void FrameRelayed(byte type, bool valid);
+// Called with the first payload byte, returns true to remove the frame from the ring.
+bool StripRelayedFrame(byte type, byte c);
+
+// Position of the relay within the current frame, 0 between frames.
+volatile byte relayIndex = 0;
+
+// Cut-through relay of a framed stream: decode, patch and re-encode one byte at a time.
+// A frame that arrived corrupted is relayed with an inverted CRC so downstream drops it too.
+// A stripped frame is cut short with an END, downstream ignores the two byte remnant.
+void RelayFramedByte(byte c)
+{
+  static byte type;
+  static byte length;
+  static byte crcIn;
+  static byte crcOut;
+  static bool escape;
+  static bool strip;
+
+  if (c == SLIP_END)
+  {
+    relayIndex = 0;
+    crcIn = 0;
+    crcOut = 0;
+    escape = false;
+    strip = false;
+    RingSerialQueue(SLIP_END);
+    return;
+  }
+
+  if (strip)
+  {
+    return;
+  }
+
+  if (c == SLIP_ESC)
+  {
+    escape = true;
+    return;
+  }
+
+  if (escape)
+  {
+    escape = false;
+    c = c == SLIP_ESC_END ? SLIP_END : c == SLIP_ESC_ESC ? SLIP_ESC : c;
+  }
+
+  byte index = relayIndex;
+  byte out = c;
+
+  if (index == 0)
+  {
+    type = c & 0x0F;
+  }
+  else if (index == 1)
+  {
+    length = c;
+  }
+  else if (index == 2 && length > 0 && StripRelayedFrame(type, c))
+  {
+    strip = true;
+    RingSerialQueue(SLIP_END);
+    return;
+  }
+  else if (index - 2 < length)
+  {
+    out = PatchRelayedByte(type, index - 2, c);
+  }
+  else if (index - 2 == length)
+  {
+    bool valid = (c == crcIn);
+    out = valid ? crcOut : ~crcOut;
+    FrameRelayed(type, valid);
+  }
+
+  crcIn = Crc8(crcIn, c);
+  crcOut = Crc8(crcOut, out);
+  SlipQueue(out);
+
+  if (index < 255)
+  {
+    relayIndex = index + 1;
+  }
+}
+
+// SLIP frame decoder.
+// Decodes in place and returns a pointer to the frame (header first) once a complete
+// frame with a valid version, length and CRC is received, otherwise NULL.
+// The frame stays valid until the next byte is decoded.
+class frameDecoder
+{
+
+private:
+  byte _frame[RING_FRAME_MAX_PAYLOAD + 3];
+  byte _index = 0;
+  byte _crc = 0;
+  byte _escapes = 0;
+  bool _escape = false;
+  bool _overflow = false;
+
+public:
+  unsigned int crcErrorCount = 0;
+
+  // Bytes the last frame returned was stuffed with, its length on the wire is its length plus this.
+  byte stuffedCount = 0;
+
+  inline bool idle()
+  {
+    return _index == 0 && !_escape;
+  }
+
+  const byte *decode(byte c)
+  {
+    if (c == SLIP_END)
+    {
+      const byte *frame = NULL;
+
+      // Back-to-back ENDs delimit empty frames, those are ignored.
+      // Frames run together by a lost END overflow, and count as errors too.
+      if (_index >= 3)
+      {
+        byte length = _index - 3;
+
+        if (!_overflow && (_frame[0] >> 4) == RING_PROTOCOL_VERSION && _frame[1] == length && _crc == 0)
+        {
+          frame = _frame;
+          stuffedCount = _escapes;
+        }
+        else
+        {
+          crcErrorCount++;
+        }
+      }
+
+      _index = 0;
+      _crc = 0;
+      _escapes = 0;
+      _escape = false;
+      _overflow = false;
+      return frame;
+    }
+
+    if (c == SLIP_ESC)
+    {
+      _escape = true;
+      _escapes++;
+      return NULL;
+    }
+
+    if (_escape)
+    {
+      _escape = false;
+      c = c == SLIP_ESC_END ? SLIP_END : c == SLIP_ESC_ESC ? SLIP_ESC : c;
+    }
+
+    if (_index == sizeof(_frame))
+    {
+      _overflow = true;
+      return NULL;
+    }
+
+    // Running CRC over the trailing CRC byte is zero for an intact frame.
+    _crc = Crc8(_crc, c);
+    _frame[_index++] = c;
+    return NULL;
+  }
+};
+
+frameDecoder ringDecoder;
+
+#endif
@@ -0,0 +1,59 @@
+// ringParams
+//
+// Effect parameters tunable over the ring without reflashing.
+// Panels read parameters from a RAM table, Param() costs the same as a global.
+// The table is pushed by the master as a block, see ringBlock.h.
+//
+// Version 1.0
+
+#ifndef RING_PARAMS_H
+#define RING_PARAMS_H
+
+#include <Arduino.h>
+#include <ringBlock.h>
+
+// Parameters, per state entries are indexed by adding the state.
+enum Params
+{
+  paramStateDelay = 0,                        // Automatic state controller hold time, stable, warning, critical.
+  paramStateRandMax = paramStateDelay + 3,    // Automatic state controller, one in n chance to escalate.
+  paramVertexBaseSpeed = paramStateRandMax + 3,
+  paramVertexBrightness,
+  paramCloudGenesis,                          // Cloud bank 9 genesis delay.
+  paramCloudSpread = paramCloudGenesis + 3,   // Cloud bank 9 spread delay.
+  paramCount = paramCloudSpread + 3
+};
+
+// Bump when parameters are added, removed or reordered, saved tables of another layout are not loaded.
+#define RING_PARAMS_LAYOUT 1
+
+const uint16_t ringParamDefaults[paramCount] PROGMEM = {
+    10000, 6000, 3000,
+    3, 4, 5,
+    160,
+    85,
+    20000, 15000, 10000,
+    3000, 2000, 1000};
+
+uint16_t ringParams[paramCount];
+
+inline uint16_t Param(byte id)
+{
+  return ringParams[id];
+}
+
+// Built in parameters, replaced by a saved block.
+void BeginParams()
+{
+  memcpy_P(ringParams, ringParamDefaults, sizeof(ringParams));
+  RegisterBlock(blockParams, ringParams, sizeof(ringParams), RING_PARAMS_LAYOUT);
+}
+
+// Master only, changes a parameter and pushes the new table.
+void SetParam(byte id, uint16_t value)
+{
+  ringParams[id] = value;
+  BlockChanged(blockParams);
+}
+
+#endif
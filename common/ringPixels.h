@@ -0,0 +1,84 @@
+// ringPixels
+//
+// NeoPixel strips that do not cost the ring any bytes.
+// Adafruit_NeoPixel::show() holds interrupts off for 10 us per colour byte,
+// while the USART only holds two received bytes before the next one overruns.
+// A 44 pixel strip is 1.3 ms, seven bytes at 57600 baud and 132 at 1 Mbaud.
+// show() here sends the strip in segments short enough for the ring's current
+// rate, letting the RX interrupt drain the USART between them. The line only
+// idles low between segments for about one RX interrupt, well inside the LEDs'
+// latch time (50 us for WS2812, 280 us for WS2812B).
+//
+// Version 1.0
+
+#ifndef RING_PIXELS_H
+#define RING_PIXELS_H
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include <ringSerial.h>
+#include <ringBaud.h>
+
+// Line time of one colour byte at 800 kHz.
+#define RING_PIXELS_BYTE_US 10
+
+// Interrupts off time around each segment besides its bytes.
+#define RING_PIXELS_MARGIN_US 4
+
+// Adafruit_NeoPixel waits this long after the previous show(), so the strip latches.
+#define RING_PIXELS_LATCH_US 300
+
+// Colour bytes sent with interrupts off at the ring's current rate.
+// The USART has two bytes of buffer, the third byte to complete meanwhile overruns.
+uint16_t RingPixelsSegmentBytes()
+{
+  static byte index = 0xFF;
+  static uint16_t bytes;
+
+  if (index != ringBaudIndex)
+  {
+    index = ringBaudIndex;
+    unsigned long window = 2 * 10000000UL / RingBaudRate(index);
+    bytes = max((long)(window - RING_PIXELS_MARGIN_US) / RING_PIXELS_BYTE_US, 1L);
+  }
+
+  return bytes;
+}
+
+class ringPixels : public Adafruit_NeoPixel
+{
+
+public:
+  ringPixels(uint16_t n, int16_t pin, neoPixelType type) : Adafruit_NeoPixel(n, pin, type)
+  {
+  }
+
+  // Same as Adafruit_NeoPixel::show(), in segments.
+  void show()
+  {
+    uint8_t *start = pixels;
+    uint16_t total = numBytes;
+    uint16_t segment = RingPixelsSegmentBytes();
+
+    for (uint16_t sent = 0; sent < total; sent += segment)
+    {
+      if (sent > 0)
+      {
+        // Let the RX interrupt empty the USART, then skip the latch wait so the strip takes the next segment as a continuation.
+        while ((UCSR0B & _BV(RXCIE0)) && (UCSR0A & _BV(RXC0)))
+        {
+        }
+        endTime -= RING_PIXELS_LATCH_US;
+      }
+
+      pixels = start + sent;
+      numBytes = min(segment, (uint16_t)(total - sent));
+      Adafruit_NeoPixel::show();
+    }
+
+    pixels = start;
+    numBytes = total;
+  }
+};
+
+#endif
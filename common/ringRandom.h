@@ -0,0 +1,113 @@
+// ringRandom
+//
+// Pseudo-random streams shared by every panel on the ring.
+// The master broadcasts a seed and an epoch counter in each control frame.
+// A stream is keyed by the seed, the epoch and an effect id, so every panel
+// drawing from the same effect gets the same values without them being sent.
+// Streams restart at each epoch, a panel that drew more or fewer values than
+// the others is back in step from the next epoch.
+//
+// Version 1.0
+
+#ifndef RING_RANDOM_H
+#define RING_RANDOM_H
+
+#include <Arduino.h>
+
+// Master advances the epoch this often.
+#ifndef RING_EPOCH_MS
+#define RING_EPOCH_MS 4000
+#endif
+
+// Streams, panels drawing from the same id make the same choices.
+enum RandomEffects
+{
+  randomErrors = 0,    // CPU Core error lamps.
+  randomFlux = 1,      // Tachyon Sensormatic Grid systems in flux.
+  randomRadiation = 2  // GNDN radiation flashers.
+};
+
+// Set by the master, received by the panels.
+uint16_t ringSeed = 0;
+uint16_t ringEpoch = 0;
+
+// Master only, picks a seed and advances the epoch, call before each control frame.
+void RingEpochUpdate()
+{
+  static unsigned long epochMillis;
+
+  // Frame timing after the baud negotiation varies from boot to boot.
+  if (ringSeed == 0)
+  {
+    ringSeed = micros() | 1;
+    epochMillis = millis();
+  }
+
+  if (millis() - epochMillis >= RING_EPOCH_MS)
+  {
+    epochMillis += RING_EPOCH_MS;
+    ringEpoch++;
+  }
+}
+
+class lockstepRandom
+{
+
+private:
+  byte _effect;
+  uint16_t _seed;
+  uint16_t _epoch;
+  uint32_t _state = 0;
+
+  // Murmur3 finalizer, spreads neighbouring epochs and effects apart.
+  static uint32_t Mix(uint32_t x)
+  {
+    x ^= x >> 16;
+    x *= 0x85EBCA6BUL;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35UL;
+    x ^= x >> 16;
+    return x;
+  }
+
+  uint32_t Next()
+  {
+    if (_state == 0 || _seed != ringSeed || _epoch != ringEpoch)
+    {
+      _seed = ringSeed;
+      _epoch = ringEpoch;
+      _state = Mix(((uint32_t)_seed << 16 | _epoch) ^ Mix(_effect + 1));
+
+      // Xorshift never leaves zero.
+      if (_state == 0)
+      {
+        _state = 1;
+      }
+    }
+
+    // Xorshift32.
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+    return _state;
+  }
+
+public:
+  lockstepRandom(byte effect)
+  {
+    _effect = effect;
+  }
+
+  // Same ranges as random().
+  long next(long howbig)
+  {
+    return howbig <= 0 ? 0 : Next() % howbig;
+  }
+
+  long next(long howsmall, long howbig)
+  {
+    return howsmall >= howbig ? howsmall : howsmall + next(howbig - howsmall);
+  }
+};
+
+#endif
@@ -0,0 +1,93 @@
+// ringSchedule
+//
+// Transmit schedule for the master's control frames.
+// A frame is due as soon as something changed, otherwise a keep-alive is sent
+// so panels hold their clocks and rate. Every frame the master originates,
+// control, events, status, blocks and cues, is charged against a set share of
+// the line, and control frames wait until the share is paid back. The rest of
+// the line is left for the panels' own events and link frames.
+//
+// Version 1.0
+
+#ifndef RING_SCHEDULE_H
+#define RING_SCHEDULE_H
+
+#include <Arduino.h>
+
+// Unchanged frames are sent this often, well inside the panels' loss timeouts.
+#ifndef RING_KEEPALIVE_MS
+#define RING_KEEPALIVE_MS 500
+#endif
+
+// Share of the line the master's frames may use.
+#ifndef RING_SEND_BUDGET_PERCENT
+#define RING_SEND_BUDGET_PERCENT 25
+#endif
+
+// Spacing floor, gives panels' loop() time to act on a frame before the next.
+#define RING_SEND_MIN_MS 10
+
+class sendScheduler
+{
+
+private:
+  unsigned long _sentMillis = 0;
+  unsigned long _nextMicros = 0;
+  unsigned long _baud = 57600;
+
+public:
+  // True once the line time charged so far has been paid back, gates bulk frames such as blocks.
+  bool ready()
+  {
+    return (long)(micros() - _nextMicros) >= 0;
+  }
+
+  // Returns true when a frame should be sent now, changed is true while unsent changes are pending.
+  bool due(bool changed)
+  {
+    unsigned long elapsed = millis() - _sentMillis;
+    return ready() && (changed || elapsed >= RING_KEEPALIVE_MS);
+  }
+
+  unsigned long sinceSent()
+  {
+    return millis() - _sentMillis;
+  }
+
+  // Call when the line rate changes.
+  void setBaud(unsigned long baud)
+  {
+    _baud = baud;
+  }
+
+  // Call once any frame has been sent, holds off the next control frame by the frame's share of the line.
+  void charge(unsigned int wireBytes)
+  {
+    unsigned long now = micros();
+
+    // An idle line earns no credit.
+    if ((long)(now - _nextMicros) > 0)
+    {
+      _nextMicros = now;
+    }
+
+    // 10 bits per byte, line time scaled up by the budget.
+    _nextMicros += wireBytes * 10000000UL / _baud * 100 / RING_SEND_BUDGET_PERCENT;
+  }
+
+  // Call once a control frame has been sent and charged.
+  void sent()
+  {
+    _sentMillis = millis();
+
+    unsigned long floor = micros() + RING_SEND_MIN_MS * 1000UL;
+    if ((long)(_nextMicros - floor) < 0)
+    {
+      _nextMicros = floor;
+    }
+  }
+};
+
+sendScheduler ringScheduler;
+
+#endif
@@ -0,0 +1,230 @@
+// ringSerial
+//
+// Interrupt driven USART0 driver for the panel ring.
+// Replaces HardwareSerial so received bytes can be relayed downstream
+// from within the RX interrupt instead of waiting for loop().
+//
+// Version 1.0
+
+#ifndef RING_SERIAL_H
+#define RING_SERIAL_H
+
+#include <Arduino.h>
+
+// Buffer sizes must be a power of two, up to 256. Override in build_flags for large rings.
+#ifndef RING_RX_BUFFER_SIZE
+#define RING_RX_BUFFER_SIZE 64
+#endif
+#ifndef RING_TX_BUFFER_SIZE
+#define RING_TX_BUFFER_SIZE 64
+#endif
+#define RING_RX_MASK (RING_RX_BUFFER_SIZE - 1)
+#define RING_TX_MASK (RING_TX_BUFFER_SIZE - 1)
+
+// Single-producer/single-consumer receive ring.
+// Only the RX interrupt writes ringRxHead and only loop() writes ringRxTail,
+// both are single bytes so no locking is required.
+volatile byte ringRxBuffer[RING_RX_BUFFER_SIZE];
+volatile byte ringRxHead = 0;
+volatile byte ringRxTail = 0;
+
+// Bytes lost because loop() did not drain the receive ring in time.
+volatile unsigned int ringRxOverflowCount = 0;
+
+// Bytes lost in the USART because the RX interrupt was held off, e.g. by a NeoPixel show().
+volatile unsigned int ringRxOverrunCount = 0;
+
+// micros() when recent frame delimiters (SLIP END) arrived and their positions in the receive ring.
+// Slots are reused oldest first, so a frame's closing END keeps its stamp while loop() is
+// behind by up to RING_STAMP_SLOTS frames. An END straight after an END only opens the
+// next frame, it is not stamped.
+#define RING_STAMP_BYTE 0xC0
+#define RING_STAMP_SLOTS 4
+volatile unsigned long ringRxStampMicros[RING_STAMP_SLOTS];
+volatile byte ringRxStampIndex[RING_STAMP_SLOTS];
+volatile byte ringRxStampNext = 0;
+volatile byte ringRxLast = 0;
+
+volatile byte ringTxBuffer[RING_TX_BUFFER_SIZE];
+volatile byte ringTxHead = 0;
+volatile byte ringTxTail = 0;
+
+// Set by the first transmitted byte, TXC0 is meaningless before that.
+volatile bool ringTxWritten = false;
+
+// Relay every received byte downstream (non-master panels).
+bool ringForwarding = false;
+
+// Relays a received byte downstream, queueing zero or more bytes with RingSerialQueue().
+// Called from the RX interrupt, defined by common.h.
+void ForwardRingByte(byte c);
+
+// Queue a byte for transmit, only call with interrupts disabled.
+inline void RingSerialQueue(byte c)
+{
+  ringTxWritten = true;
+
+  // Write straight to the USART when idle, cuts a full byte time from each hop.
+  if (ringTxHead == ringTxTail && (UCSR0A & _BV(UDRE0)))
+  {
+    UDR0 = c;
+    UCSR0A = (UCSR0A & _BV(U2X0)) | _BV(TXC0); // Cleared for RingSerialFlush().
+    return;
+  }
+
+  byte next = (ringTxHead + 1) & RING_TX_MASK;
+
+  if (next == ringTxTail)
+  {
+    return; // Overflow, downstream checksum rejects the frame.
+  }
+
+  ringTxBuffer[ringTxHead] = c;
+  ringTxHead = next;
+  UCSR0B |= _BV(UDRIE0);
+}
+
+ISR(USART_RX_vect)
+{
+  // Flags the byte about to be read, so read before UDR0.
+  if (UCSR0A & _BV(DOR0))
+  {
+    ringRxOverrunCount++;
+  }
+
+  byte c = UDR0;
+
+  if (ringForwarding)
+  {
+    ForwardRingByte(c);
+  }
+
+  byte head = ringRxHead;
+  byte next = (head + 1) & RING_RX_MASK;
+  byte last = ringRxLast;
+  ringRxLast = c;
+
+  if (next == ringRxTail)
+  {
+    ringRxOverflowCount++;
+    return;
+  }
+
+  if (c == RING_STAMP_BYTE && last != RING_STAMP_BYTE)
+  {
+    byte slot = ringRxStampNext;
+    ringRxStampMicros[slot] = micros();
+    ringRxStampIndex[slot] = head;
+    ringRxStampNext = (slot + 1) & (RING_STAMP_SLOTS - 1);
+  }
+
+  // Store the byte before publishing the new head.
+  ringRxBuffer[head] = c;
+  ringRxHead = next;
+}
+
+ISR(USART_UDRE_vect)
+{
+  UDR0 = ringTxBuffer[ringTxTail];
+  UCSR0A = (UCSR0A & _BV(U2X0)) | _BV(TXC0);
+  ringTxTail = (ringTxTail + 1) & RING_TX_MASK;
+
+  if (ringTxHead == ringTxTail)
+  {
+    UCSR0B &= ~_BV(UDRIE0);
+  }
+}
+
+// Change the baud rate, call RingSerialFlush() first so queued bytes leave at the old rate.
+void RingSerialSetBaud(unsigned long baud)
+{
+  // Double speed mode, same divisor selection as HardwareSerial.
+  // Exact at 16 MHz for 250000, 500000 and 1000000.
+  uint16_t baudSetting = (F_CPU / 4 / baud - 1) / 2;
+  UCSR0A = _BV(U2X0);
+  UBRR0H = baudSetting >> 8;
+  UBRR0L = baudSetting;
+}
+
+// Configure USART0 for 8N1 at the specified baud rate.
+void RingSerialBegin(unsigned long baud, bool forwarding)
+{
+  ringForwarding = forwarding;
+
+  RingSerialSetBaud(baud);
+  UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+  UCSR0B = _BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0);
+}
+
+inline bool RingSerialAvailable()
+{
+  return ringRxHead != ringRxTail;
+}
+
+// Returns the next received byte, call RingSerialAvailable() first.
+inline byte RingSerialRead()
+{
+  byte tail = ringRxTail;
+  byte c = ringRxBuffer[tail];
+  ringRxTail = (tail + 1) & RING_RX_MASK;
+  return c;
+}
+
+// micros() when the byte at the head of the receive ring arrived, if it is a stamped frame delimiter.
+// Call before RingSerialRead(), otherwise returns the current micros().
+unsigned long RingSerialStamp()
+{
+  byte oldSREG = SREG;
+  cli();
+  unsigned long stamp = micros();
+  byte slot = ringRxStampNext;
+
+  // Newest first, an older slot at the same position is a stale one.
+  for (byte i = 0; i < RING_STAMP_SLOTS && ringRxBuffer[ringRxTail] == RING_STAMP_BYTE; i++)
+  {
+    slot = (slot - 1) & (RING_STAMP_SLOTS - 1);
+
+    if (ringRxStampIndex[slot] == ringRxTail)
+    {
+      stamp = ringRxStampMicros[slot];
+      break;
+    }
+  }
+
+  SREG = oldSREG;
+  return stamp;
+}
+
+// Blocks until every queued byte has been shifted out.
+void RingSerialFlush()
+{
+  if (!ringTxWritten)
+  {
+    return;
+  }
+
+  while ((UCSR0B & _BV(UDRIE0)) || !(UCSR0A & _BV(TXC0)))
+  {
+  }
+}
+
+// Free space in the transmit buffer.
+inline byte RingSerialTxFree()
+{
+  return (ringTxTail - ringTxHead - 1) & RING_TX_MASK;
+}
+
+// Blocks while the transmit buffer is full.
+void RingSerialWrite(byte c)
+{
+  while (((ringTxHead + 1) & RING_TX_MASK) == ringTxTail)
+  {
+  }
+
+  byte oldSREG = SREG;
+  cli();
+  RingSerialQueue(c);
+  SREG = oldSREG;
+}
+
+#endif
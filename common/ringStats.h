@@ -0,0 +1,213 @@
+// ringStats
+//
+// Round trip metrics for the panel ring, kept by the master panel.
+// Every control frame carries a sequence number and a hop count which each
+// relaying panel increments. Returning frames are matched to the micros() they
+// were sent at, frames that never return are counted as lost.
+// Statistics roll: counts are halved once enough samples have been taken.
+//
+// Version 1.0
+
+#ifndef RING_STATS_H
+#define RING_STATS_H
+
+#include <Arduino.h>
+
+// Frames in flight before the oldest is counted lost, power of two up to 8.
+#define RING_STATS_WINDOW 8
+#define RING_STATS_MASK (RING_STATS_WINDOW - 1)
+
+// Round trip histogram for the percentile, log spaced so one table serves a short fast ring
+// and 32 panels at 57600. Four bins per octave from 256 us to the 65535 us cap, bins are
+// within 25% of the round trip. The first bin also collects everything faster.
+#define RING_STATS_BIN_BASE_MICROS 256
+#define RING_STATS_BINS_PER_OCTAVE 4
+#define RING_STATS_BIN_COUNT 32
+
+// Samples per rolling period.
+#define RING_STATS_PERIOD 512
+
+// An echo is overdue after four average round trips, but never sooner than this.
+#define RING_ECHO_MIN_MICROS 20000
+
+class roundTripStats
+{
+
+private:
+  unsigned long _sentMicros[RING_STATS_WINDOW];
+  byte _outstanding;
+  byte _seq;
+
+  unsigned int _bins[RING_STATS_BIN_COUNT];
+  unsigned int _samples;
+  unsigned long _avg; // Microseconds << 4.
+  unsigned int _min;
+  unsigned int _oldMin;
+
+  unsigned int _lost;
+  unsigned int _received;
+
+  // Newest frame sent, awaiting its echo.
+  byte _lastSeq;
+  bool _awaiting;
+
+  static byte Bin(unsigned int rtt)
+  {
+    if (rtt < RING_STATS_BIN_BASE_MICROS)
+    {
+      return 0;
+    }
+
+    // Shift into the first octave, the two bits below its top bit pick the quarter.
+    byte octave = 0;
+    while (rtt >= RING_STATS_BIN_BASE_MICROS * 2)
+    {
+      rtt >>= 1;
+      octave++;
+    }
+
+    return octave * RING_STATS_BINS_PER_OCTAVE + ((rtt - RING_STATS_BIN_BASE_MICROS) * RING_STATS_BINS_PER_OCTAVE) / RING_STATS_BIN_BASE_MICROS;
+  }
+
+  // Upper edge of a bin, saturates at the cap.
+  static unsigned int BinEdge(byte bin)
+  {
+    byte octave = bin / RING_STATS_BINS_PER_OCTAVE;
+    byte quarter = bin % RING_STATS_BINS_PER_OCTAVE + 1;
+    unsigned long edge = (RING_STATS_BIN_BASE_MICROS + (unsigned long)quarter * RING_STATS_BIN_BASE_MICROS / RING_STATS_BINS_PER_OCTAVE) << octave;
+    return edge > 0xFFFF ? 0xFFFF : edge;
+  }
+
+  void Roll()
+  {
+    _samples = 0;
+    for (byte i = 0; i < RING_STATS_BIN_COUNT; i++)
+    {
+      _bins[i] >>= 1;
+      _samples += _bins[i];
+    }
+
+    _oldMin = _min;
+    _min = 0;
+  }
+
+public:
+  // Panels relaying the last returned frame.
+  byte ringLength;
+
+  // Frames sent in a row whose echo never returned.
+  byte missedEchoes;
+
+  // Call as a frame is sent, returns its sequence number.
+  byte sent(unsigned long now)
+  {
+    byte seq = _seq++;
+    byte slot = seq & RING_STATS_MASK;
+
+    if (_outstanding & (1 << slot))
+    {
+      _lost++;
+    }
+
+    _outstanding |= 1 << slot;
+    _sentMicros[slot] = now;
+
+    if (_awaiting && missedEchoes < 255)
+    {
+      missedEchoes++;
+    }
+    _awaiting = true;
+    _lastSeq = seq;
+    return seq;
+  }
+
+  // Call as a frame returns, rxMicros is when it finished arriving.
+  void received(byte seq, byte hops, unsigned long rxMicros)
+  {
+    byte slot = seq & RING_STATS_MASK;
+
+    // Late, duplicated or from before a reset.
+    if (!(_outstanding & (1 << slot)) || (byte)(_seq - 1 - seq) >= RING_STATS_WINDOW)
+    {
+      return;
+    }
+
+    _outstanding &= ~(1 << slot);
+    _received++;
+    ringLength = hops;
+    missedEchoes = 0;
+
+    if (seq == _lastSeq)
+    {
+      _awaiting = false;
+    }
+
+    unsigned long elapsed = rxMicros - _sentMicros[slot];
+    unsigned int rtt = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+
+    if (_min == 0 || rtt < _min)
+    {
+      _min = rtt;
+    }
+
+    _avg = _avg == 0 ? (unsigned long)rtt << 4 : _avg - (_avg >> 4) + rtt;
+    _bins[Bin(rtt)]++;
+
+    if (++_samples >= RING_STATS_PERIOD)
+    {
+      Roll();
+    }
+
+    if (_lost + _received >= RING_STATS_PERIOD)
+    {
+      _lost >>= 1;
+      _received >>= 1;
+    }
+  }
+
+  // True once the newest frame's echo is overdue.
+  bool echoOverdue(unsigned long now)
+  {
+    unsigned long timeout = max(avgMicros() * 4UL, (unsigned long)RING_ECHO_MIN_MICROS);
+    return _awaiting && now - _sentMicros[_lastSeq & RING_STATS_MASK] > timeout;
+  }
+
+  // Lowest round trip over this and the last period.
+  unsigned int minMicros()
+  {
+    return _oldMin == 0 || (_min != 0 && _min < _oldMin) ? _min : _oldMin;
+  }
+
+  unsigned int avgMicros()
+  {
+    return _avg >> 4;
+  }
+
+  // Upper edge of the bin holding the 99th percentile.
+  unsigned int p99Micros()
+  {
+    unsigned int above = 0;
+
+    for (byte i = RING_STATS_BIN_COUNT; i > 0; i--)
+    {
+      above += _bins[i - 1];
+      if (above > _samples / 100)
+      {
+        return BinEdge(i - 1);
+      }
+    }
+
+    return 0;
+  }
+
+  unsigned int lossPerMille()
+  {
+    unsigned int total = _lost + _received;
+    return total == 0 ? 0 : (unsigned long)_lost * 1000 / total;
+  }
+};
+
+// Kept by the master panel only.
+roundTripStats ringStats;
+
+#endif
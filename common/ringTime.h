@@ -0,0 +1,118 @@
+// ringTime
+//
+// Shared ring clock disciplined to the master panel.
+// The master stamps each control frame with its ring time, every other panel
+// steers its local estimate toward those stamps with a proportional-integral
+// loop. The integral term tracks the resonator drift between the boards so the
+// clock holds its rate between frames and when frames stop.
+//
+// Version 1.0
+
+#ifndef RING_TIME_H
+#define RING_TIME_H
+
+#include <Arduino.h>
+#include <waveTable.h>
+
+// Stamps further than this from the local estimate are applied as a step.
+#define RING_TIME_STEP_MICROS 100000L
+
+// Ring time at ringBaseLocal, milliseconds plus microseconds (0..999).
+unsigned long ringBaseMillis = 0;
+unsigned int ringBaseMicros = 0;
+
+// Local micros() at the base.
+unsigned long ringBaseLocal = 0;
+
+// Local clock rate correction, units of 2^-20 (about 1 ppm).
+long ringDrift = 0;
+
+// A stamp from the master has been applied.
+bool ringTimeLocked = false;
+
+// Ring time at the local micros() timestamp. Local must not be older than the base by more than ~35 minutes.
+void RingTimeAt(unsigned long local, unsigned long *ms, unsigned int *us)
+{
+  long elapsed = (long)(local - ringBaseLocal);
+
+  // Rebase so the correction below stays within 32 bits.
+  while (elapsed > (1L << 20))
+  {
+    long step = 1L << 20;
+    long corrected = step + (((step >> 4) * ringDrift) >> 16);
+    unsigned long total = ringBaseMicros + corrected;
+    ringBaseMillis += total / 1000;
+    ringBaseMicros = total % 1000;
+    ringBaseLocal += step;
+    elapsed -= step;
+  }
+
+  long corrected = elapsed + (((elapsed >> 4) * ringDrift) >> 16);
+  long total = (long)ringBaseMicros + corrected;
+
+  // Timestamps slightly older than the base give a negative total.
+  long carry = total >= 0 ? total / 1000 : -((999 - total) / 1000);
+  *ms = ringBaseMillis + carry;
+  *us = total - carry * 1000;
+}
+
+// Milliseconds of ring time, use in place of millis() for effects shared between panels.
+unsigned long RingMillis()
+{
+  unsigned long ms;
+  unsigned int us;
+  RingTimeAt(micros(), &ms, &us);
+  return ms;
+}
+
+// Steer the ring clock toward a master stamp received at the local micros() timestamp.
+void RingTimeSync(unsigned long masterMillis, unsigned int masterMicros, unsigned long local)
+{
+  static unsigned long oldLocal;
+
+  unsigned long ms;
+  unsigned int us;
+  RingTimeAt(local, &ms, &us);
+
+  long error = (long)(masterMillis - ms) * 1000 + ((int)masterMicros - (int)us);
+
+  if (!ringTimeLocked || error > RING_TIME_STEP_MICROS || error < -RING_TIME_STEP_MICROS)
+  {
+    ringBaseMillis = masterMillis;
+    ringBaseMicros = masterMicros;
+    ringBaseLocal = local;
+    ringTimeLocked = true;
+    oldLocal = local;
+    return;
+  }
+
+  // Integral term: drift in 2^-20 units is error / interval, gain 1/8.
+  long interval = (long)(local - oldLocal) >> 8;
+  oldLocal = local;
+
+  if (interval > 0)
+  {
+    ringDrift += ((error << 12) / interval) >> 3;
+  }
+
+  // Proportional term: remove a quarter of the phase error.
+  long total = (long)us + error / 4;
+  long carry = total >= 0 ? total / 1000 : -((999 - total) / 1000);
+  ringBaseMillis = ms + carry;
+  ringBaseMicros = total - carry * 1000;
+  ringBaseLocal = local;
+}
+
+// Half-sine 0..maxPwm..0 over periodMs, phased to the ring clock so panels pulse together.
+int RingSinPwm(unsigned long periodMs, int maxPwm)
+{
+  unsigned long ms;
+  unsigned int us;
+  RingTimeAt(micros(), &ms, &us);
+
+  // 16 bit phase, periods up to 65535 ms.
+  uint16_t phase = (((ms % periodMs) << 16) + ((unsigned long)us << 16) / 1000) / periodMs;
+  return WavePwm(WaveHalfSin(phase), maxPwm);
+}
+
+#endif
@@ -0,0 +1,467 @@
+// ringVm
+//
+// Bytecode interpreter for effects loaded over the ring.
+// A program is a block pushed by the master, see ringBlock.h, and runs from
+// loop() in place of an Update*() function. It is a stack machine over 16 bit
+// integers with ring time, flasher-like oscillators, timers, and writes to
+// strip pixels and PWM channels through output functions set by the panel.
+// Nothing is allocated. Programs are verified as they arrive, so the
+// interpreter runs without bounds checks, and jumps are budgeted so no
+// program hangs loop().
+// Programs are assembled on the host by tools/vmasm.py, or in C with the
+// VM_ macros below. The CPU Core's vmbench env measures ops per ms on a board.
+// Only panels that run programs, and the master that pushes them, call
+// BeginVm(), other panels link none of the VM's storage.
+//
+// Requires state, Param(), PanelBit() and hostedPanels from common.h.
+//
+// Version 1.0
+
+#ifndef RING_VM_H
+#define RING_VM_H
+
+#include <Arduino.h>
+#include <ringBlock.h>
+#include <ringTime.h>
+
+#define RING_VM_PROGRAM_SIZE 64
+#define RING_VM_STACK_SIZE 8
+#define RING_VM_REGISTER_COUNT 8
+#define RING_VM_TIMER_COUNT 4
+
+// Bump when opcodes or their operands change, saved programs of another layout are not loaded.
+#define RING_VM_LAYOUT 1
+
+// Jumps taken per run.
+#define RING_VM_MAX_JUMPS 255
+
+// Opcodes, operand bytes follow the opcode. Stack effects are listed top last.
+enum VmOps
+{
+  opEnd = 0,      // Ends the run.
+  opPush,         // n8: -- n, sign extended.
+  opPush16,       // n16: -- n, little endian.
+  opLoad,         // r: -- register r.
+  opStore,        // r: a -- , into register r.
+  opDup,          // a -- a a
+  opDrop,         // a --
+  opAdd,          // a b -- a+b
+  opSub,          // a b -- a-b
+  opMul,          // a b -- a*b
+  opShr,          // n: a -- a>>n
+  opAnd,          // a b -- a&b
+  opMin,          // a b -- min
+  opMax,          // a b -- max
+  opLt,           // a b -- a<b
+  opEq,           // a b -- a==b
+  opJump,         // offset8: jumps relative to the next opcode.
+  opJumpZero,     // offset8: a -- , jumps when a is zero.
+  opTime,         // -- ring time in ms, low 16 bits.
+  opTri,          // period -- triangle 0..255..0 over period ms of ring time.
+  opSin,          // period -- half-sine 0..255..0 over period ms of ring time.
+  opTimer,        // t: period -- 1 once every period ms on timer t, otherwise 0.
+  opRandom,       // n -- random(n)
+  opState,        // -- state
+  opParam,        // p: -- Param(p)
+  opHosts,        // panel: -- 1 if this board hosts the panel.
+  opPixel,        // index r g b -- , sets a strip pixel.
+  opPwm,          // channel value -- , sets a PWM channel.
+  opCount
+};
+
+// Per opcode: operand bytes, values popped, values pushed.
+const byte ringVmOpShapes[opCount][3] PROGMEM = {
+    {0, 0, 0}, {1, 0, 1}, {2, 0, 1}, {1, 0, 1}, {1, 1, 0}, {0, 1, 2}, {0, 1, 0}, {0, 2, 1},
+    {0, 2, 1}, {0, 2, 1}, {1, 1, 1}, {0, 2, 1}, {0, 2, 1}, {0, 2, 1}, {0, 2, 1}, {0, 2, 1},
+    {1, 0, 0}, {1, 1, 0}, {0, 0, 1}, {0, 1, 1}, {0, 1, 1}, {1, 1, 1}, {0, 1, 1}, {0, 0, 1},
+    {1, 0, 1}, {1, 0, 1}, {0, 4, 0}, {0, 2, 0}};
+
+// Assembler, programs are byte arrays of these.
+// Jump offsets count from the opcode after the jump.
+#define VM_END opEnd
+#define VM_PUSH(n) opPush, (byte)(n)
+#define VM_PUSH16(n) opPush16, (byte)((n) & 0xFF), (byte)((unsigned int)(n) >> 8)
+#define VM_LOAD(r) opLoad, (byte)(r)
+#define VM_STORE(r) opStore, (byte)(r)
+#define VM_DUP opDup
+#define VM_DROP opDrop
+#define VM_ADD opAdd
+#define VM_SUB opSub
+#define VM_MUL opMul
+#define VM_SHR(n) opShr, (byte)(n)
+#define VM_AND opAnd
+#define VM_MIN opMin
+#define VM_MAX opMax
+#define VM_LT opLt
+#define VM_EQ opEq
+#define VM_JUMP(offset) opJump, (byte)(offset)
+#define VM_JUMP_ZERO(offset) opJumpZero, (byte)(offset)
+#define VM_TIME opTime
+#define VM_TRI opTri
+#define VM_SIN opSin
+#define VM_TIMER(t) opTimer, (byte)(t)
+#define VM_RANDOM opRandom
+#define VM_STATE opState
+#define VM_PARAM(p) opParam, (byte)(p)
+#define VM_HOSTS(panel) opHosts, (byte)(panel)
+#define VM_PIXEL opPixel
+#define VM_PWM opPwm
+
+// The byte past the program holds opEnd, so running off the end ends.
+byte ringVmProgram[RING_VM_PROGRAM_SIZE + 1];
+
+// Kept between runs, cleared when a new program arrives.
+int ringVmRegisters[RING_VM_REGISTER_COUNT];
+unsigned long ringVmTimers[RING_VM_TIMER_COUNT];
+
+#ifdef RING_VM_COUNT_OPS
+// Ops dispatched, opEnd included, for the native tests.
+unsigned long ringVmOps = 0;
+#endif
+
+void (*ringVmPixel)(byte index, byte r, byte g, byte b) = NULL;
+void (*ringVmPwm)(byte channel, int value) = NULL;
+
+// Outputs for the running panel, either may be NULL. Indexes come from the program, outputs check their range.
+void SetVmOutputs(void (*pixel)(byte index, byte r, byte g, byte b), void (*pwm)(byte channel, int value))
+{
+  ringVmPixel = pixel;
+  ringVmPwm = pwm;
+}
+
+// Follows every path through a program, returns false unless each opcode is known, each operand is in range,
+// each jump lands inside the program, and the stack depth stays in bounds and agrees wherever paths meet.
+// Every opcode reached must also be where decoding in a line from the start finds one, RunVm() threads it so.
+bool VmVerify(const byte *program)
+{
+  byte depth[RING_VM_PROGRAM_SIZE];
+  memset(depth, 0xFF, sizeof(depth));
+  depth[0] = 0;
+
+  // A bit per program byte.
+  byte opcode[RING_VM_PROGRAM_SIZE / 8];
+  memset(opcode, 0, sizeof(opcode));
+  for (byte pc = 0; pc < RING_VM_PROGRAM_SIZE && program[pc] < opCount; pc += 1 + pgm_read_byte(&ringVmOpShapes[program[pc]][0]))
+  {
+    opcode[pc >> 3] |= 1 << (pc & 7);
+  }
+
+  // Small enough to sweep until nothing changes.
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+
+    for (byte pc = 0; pc < RING_VM_PROGRAM_SIZE; pc++)
+    {
+      if (depth[pc] == 0xFF)
+      {
+        continue;
+      }
+
+      byte op = program[pc];
+      if (!(opcode[pc >> 3] & (1 << (pc & 7))))
+      {
+        return false;
+      }
+
+      byte operands = pgm_read_byte(&ringVmOpShapes[op][0]);
+      if (pc + operands >= RING_VM_PROGRAM_SIZE)
+      {
+        return false;
+      }
+
+      byte pops = pgm_read_byte(&ringVmOpShapes[op][1]);
+      byte after = depth[pc] - pops + pgm_read_byte(&ringVmOpShapes[op][2]);
+      byte operand = operands > 0 ? program[pc + 1] : 0;
+
+      if (depth[pc] < pops || after > RING_VM_STACK_SIZE)
+      {
+        return false;
+      }
+
+      if (((op == opLoad || op == opStore) && operand >= RING_VM_REGISTER_COUNT) ||
+          (op == opTimer && operand >= RING_VM_TIMER_COUNT) ||
+          (op == opParam && operand >= paramCount) ||
+          (op == opHosts && operand >= MAX_PANELS) ||
+          (op == opShr && operand > 15))
+      {
+        return false;
+      }
+
+      // Up to two successors, the guard byte ends a program that runs off its end.
+      bool jump = op == opJump || op == opJumpZero;
+      int next = op == opJump || op == opEnd ? RING_VM_PROGRAM_SIZE : pc + 1 + operands;
+      int target = pc + 1 + operands + (int8_t)operand;
+
+      if (jump && (target < 0 || target >= RING_VM_PROGRAM_SIZE))
+      {
+        return false;
+      }
+
+      for (byte k = 0; k < (jump ? 2 : 1); k++)
+      {
+        int successor = k == 0 ? next : target;
+        if (successor >= RING_VM_PROGRAM_SIZE)
+        {
+          continue;
+        }
+
+        if (depth[successor] == 0xFF)
+        {
+          depth[successor] = after;
+          changed = true;
+        }
+        else if (depth[successor] != after)
+        {
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+// Call after BeginControlData(), before SetVmOutputs().
+void BeginVm()
+{
+  RegisterBlock(blockProgram, ringVmProgram, RING_VM_PROGRAM_SIZE, RING_VM_LAYOUT, VmVerify);
+}
+
+inline bool VmLoaded()
+{
+  return ringVmProgram[0] != opEnd;
+}
+
+// Master only, loads a program from PROGMEM and pushes it to every panel, returns false if it fails VmVerify().
+// Checked in the block staging buffer, a block being received is dropped and taken again on its repeat.
+bool LoadVmProgram(const byte *program, byte size)
+{
+  byte *loaded = ringBlockStaging;
+  ringBlockStagingId = blockCount;
+  memset(loaded, opEnd, RING_VM_PROGRAM_SIZE);
+  memcpy_P(loaded, program, min(size, RING_VM_PROGRAM_SIZE));
+
+  if (!VmVerify(loaded))
+  {
+    return false;
+  }
+
+  memcpy(ringVmProgram, loaded, RING_VM_PROGRAM_SIZE);
+  BlockChanged(blockProgram);
+  return true;
+}
+
+// Position within a period of ring time as 0..255.
+inline byte VmPhase(unsigned long now, unsigned int period)
+{
+  return period == 0 ? 0 : (now % period) * 256UL / period;
+}
+
+// Runs the program once, call every loop.
+void RunVm()
+{
+  static const void *const ops[opCount] = {
+      &&end, &&push, &&push16, &&load, &&store, &&dup, &&drop, &&add,
+      &&sub, &&mul, &&shr, &&band, &&vmin, &&vmax, &&lt, &&eq,
+      &&jump, &&jumpZero, &&vtime, &&tri, &&vsin, &&timer, &&rnd, &&vstate,
+      &&param, &&hosts, &&pixel, &&pwm};
+
+  // Direct threaded, each program byte becomes an entry holding its op's label, or the operand itself,
+  // so dispatch is a load and an indirect jump with no opcode table lookup. Offsets carry over unchanged,
+  // the cost is a pointer of RAM per program byte.
+  static const void *code[RING_VM_PROGRAM_SIZE + 1];
+  static bool threaded = false;
+  static uint16_t version;
+
+  if (!threaded || version != ringBlocks[blockProgram].version)
+  {
+    threaded = true;
+    version = ringBlocks[blockProgram].version;
+    memset(ringVmRegisters, 0, sizeof(ringVmRegisters));
+    memset(ringVmTimers, 0, sizeof(ringVmTimers));
+
+    // Decoded in a line as VmVerify() requires, past the last opcode is never reached.
+    int i = 0;
+    while (i <= RING_VM_PROGRAM_SIZE && ringVmProgram[i] < opCount)
+    {
+      byte op = ringVmProgram[i];
+      code[i++] = ops[op];
+      for (byte k = pgm_read_byte(&ringVmOpShapes[op][0]); k > 0 && i <= RING_VM_PROGRAM_SIZE; k--, i++)
+      {
+        code[i] = (const void *)(uintptr_t)ringVmProgram[i];
+      }
+    }
+    while (i <= RING_VM_PROGRAM_SIZE)
+    {
+      code[i++] = &&end;
+    }
+  }
+
+  // Verified programs need no checks: opcodes are known and the stack stays within stack[1..RING_VM_STACK_SIZE].
+  const void *const *pc = code;
+  int stack[RING_VM_STACK_SIZE + 1];
+  int *sp = stack;
+  int tos = 0;
+  int a;
+  byte jumps = RING_VM_MAX_JUMPS;
+  unsigned long now = RingMillis();
+
+#define FETCH() ((byte)(uintptr_t)*pc++)
+#ifdef RING_VM_COUNT_OPS
+#define NEXT()     \
+  do               \
+  {                \
+    ringVmOps++;   \
+    goto **pc++;   \
+  } while (0)
+#else
+#define NEXT() goto **pc++
+#endif
+#define PUSH(v)    \
+  do               \
+  {                \
+    *++sp = tos;   \
+    tos = (v);     \
+  } while (0)
+#define POP() (*sp--)
+
+  NEXT();
+
+push:
+  PUSH((int8_t)FETCH());
+  NEXT();
+push16:
+  a = FETCH();
+  PUSH(a | (FETCH() << 8));
+  NEXT();
+load:
+  PUSH(ringVmRegisters[FETCH()]);
+  NEXT();
+store:
+  ringVmRegisters[FETCH()] = tos;
+  tos = POP();
+  NEXT();
+dup:
+  PUSH(tos);
+  NEXT();
+drop:
+  tos = POP();
+  NEXT();
+add:
+  tos = POP() + tos;
+  NEXT();
+sub:
+  tos = POP() - tos;
+  NEXT();
+mul:
+  tos = POP() * tos;
+  NEXT();
+shr:
+  tos >>= FETCH();
+  NEXT();
+band:
+  tos = POP() & tos;
+  NEXT();
+vmin:
+  a = POP();
+  tos = min(a, tos);
+  NEXT();
+vmax:
+  a = POP();
+  tos = max(a, tos);
+  NEXT();
+lt:
+  tos = POP() < tos;
+  NEXT();
+eq:
+  tos = POP() == tos;
+  NEXT();
+jump:
+  a = (int8_t)FETCH();
+  if (jumps-- == 0)
+  {
+    goto end;
+  }
+  pc += a;
+  NEXT();
+jumpZero:
+  a = (int8_t)FETCH();
+  if (tos == 0)
+  {
+    if (jumps-- == 0)
+    {
+      goto end;
+    }
+    pc += a;
+  }
+  tos = POP();
+  NEXT();
+vtime:
+  PUSH((int)now);
+  NEXT();
+tri:
+  a = VmPhase(now, tos);
+  tos = a < 128 ? a * 2 : (255 - a) * 2;
+  NEXT();
+vsin:
+  // Parabola through 0, 255 and 0, within 6% of a half-sine.
+  a = VmPhase(now, tos);
+  tos = (a * (255 - a)) >> 6;
+  NEXT();
+timer:
+  a = FETCH();
+  if (now - ringVmTimers[a] >= (unsigned int)tos)
+  {
+    ringVmTimers[a] = now;
+    tos = 1;
+  }
+  else
+  {
+    tos = 0;
+  }
+  NEXT();
+rnd:
+  tos = random(tos);
+  NEXT();
+vstate:
+  PUSH(state);
+  NEXT();
+param:
+  PUSH(Param(FETCH()));
+  NEXT();
+hosts:
+  PUSH(PanelBit(hostedPanels, FETCH()));
+  NEXT();
+pixel:
+{
+  int b = tos;
+  int g = POP();
+  int r = POP();
+  int index = POP();
+  if (ringVmPixel)
+  {
+    ringVmPixel(index, r, g, b);
+  }
+  tos = POP();
+  NEXT();
+}
+pwm:
+  a = POP();
+  if (ringVmPwm)
+  {
+    ringVmPwm(a, tos);
+  }
+  tos = POP();
+  NEXT();
+end:
+  return;
+
+#undef FETCH
+#undef NEXT
+#undef PUSH
+#undef POP
+}
+
+#endif
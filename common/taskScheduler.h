@@ -0,0 +1,229 @@
+// taskScheduler
+//
+// Cooperative scheduler for a board's timed work.
+// Tasks run every period or once at a deadline, kept in a min-heap by
+// deadline so RunTasks() only looks at the next one. Between deadlines the
+// MCU idles in SLEEP_MODE_IDLE, the millis() tick or a received ring byte
+// wakes it, so the ring is still read within a tick.
+// A panel's tasks are added with AddPanelTask() and run only while the
+// panel is booted, each at the period of the work it does.
+//
+// Version 1.0
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+#include <common.h>
+#include <frameClock.h>
+#include <ringSerial.h>
+#include <renderTick.h>
+
+#ifndef TASK_MAX
+#define TASK_MAX 8
+#endif
+
+#define TASK_NONE 0xFF
+
+// Task panel for tasks that run whether or not any panel is booted.
+#define TASK_ANY_PANEL 0xFF
+
+// Animations redrawn every frame, flashers and per-element timers, at the render tick's rate.
+#define TASK_FRAME_MS RENDER_TICK_MS
+
+typedef void (*taskFunction)();
+
+struct task
+{
+  taskFunction run;
+  unsigned long deadline;
+  unsigned long period; // 0 for one shot tasks.
+  byte heapIndex;       // TASK_NONE while not scheduled.
+  byte panel;           // Runs only while this panel is booted, or TASK_ANY_PANEL.
+};
+
+task tasks[TASK_MAX];
+byte taskCount = 0;
+
+// Scheduled task ids, earliest deadline first.
+byte taskHeap[TASK_MAX];
+byte taskHeapSize = 0;
+
+// Wrap safe, true if task a is due before task b.
+inline bool TaskBefore(byte a, byte b)
+{
+  return (long)(tasks[a].deadline - tasks[b].deadline) < 0;
+}
+
+inline void TaskHeapSet(byte index, byte id)
+{
+  taskHeap[index] = id;
+  tasks[id].heapIndex = index;
+}
+
+void TaskHeapUp(byte index)
+{
+  byte id = taskHeap[index];
+
+  while (index > 0)
+  {
+    byte parent = (index - 1) / 2;
+    if (!TaskBefore(id, taskHeap[parent]))
+    {
+      break;
+    }
+    TaskHeapSet(index, taskHeap[parent]);
+    index = parent;
+  }
+  TaskHeapSet(index, id);
+}
+
+void TaskHeapDown(byte index)
+{
+  byte id = taskHeap[index];
+
+  while (true)
+  {
+    byte child = index * 2 + 1;
+    if (child >= taskHeapSize)
+    {
+      break;
+    }
+    if (child + 1 < taskHeapSize && TaskBefore(taskHeap[child + 1], taskHeap[child]))
+    {
+      child++;
+    }
+    if (!TaskBefore(taskHeap[child], id))
+    {
+      break;
+    }
+    TaskHeapSet(index, taskHeap[child]);
+    index = child;
+  }
+  TaskHeapSet(index, id);
+}
+
+// Stops a task until it is scheduled again.
+void CancelTask(byte id)
+{
+  if (id >= taskCount || tasks[id].heapIndex == TASK_NONE)
+  {
+    return;
+  }
+
+  byte index = tasks[id].heapIndex;
+  tasks[id].heapIndex = TASK_NONE;
+  byte last = taskHeap[--taskHeapSize];
+
+  if (index < taskHeapSize)
+  {
+    TaskHeapSet(index, last);
+    TaskHeapUp(index);
+    TaskHeapDown(tasks[last].heapIndex);
+  }
+}
+
+// Runs a task delayMs from now, replacing its current deadline.
+void ScheduleTask(byte id, unsigned long delayMs)
+{
+  if (id >= taskCount)
+  {
+    return;
+  }
+
+  CancelTask(id);
+  tasks[id].deadline = FrameMillis() + delayMs;
+  TaskHeapSet(taskHeapSize++, id);
+  TaskHeapUp(taskHeapSize - 1);
+}
+
+// Registers a task run every periodMs, first after firstMs. Returns its id, TASK_NONE if the table is full.
+byte AddTask(taskFunction run, unsigned long periodMs, unsigned long firstMs = 0)
+{
+  if (taskCount == TASK_MAX)
+  {
+    return TASK_NONE;
+  }
+
+  byte id = taskCount++;
+  tasks[id].run = run;
+  tasks[id].period = periodMs;
+  tasks[id].heapIndex = TASK_NONE;
+  tasks[id].panel = TASK_ANY_PANEL;
+  ScheduleTask(id, firstMs);
+  return id;
+}
+
+// Registers a task run every periodMs while panel is booted, deadlines that pass while it is down are skipped.
+byte AddPanelTask(Panels panel, taskFunction run, unsigned long periodMs, unsigned long firstMs = 0)
+{
+  byte id = AddTask(run, periodMs, firstMs);
+  if (id != TASK_NONE)
+  {
+    tasks[id].panel = panel;
+  }
+  return id;
+}
+
+// Registers a one shot task, idle until ScheduleTask().
+byte AddTaskOnce(taskFunction run)
+{
+  byte id = AddTask(run, 0);
+  CancelTask(id);
+  return id;
+}
+
+// Idles until the next interrupt, unless ring bytes or a render frame are already waiting.
+void SleepUntilInterrupt()
+{
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  cli();
+
+  if (RingSerialAvailable() || renderTickPending)
+  {
+    sei();
+    return;
+  }
+
+  // sei takes effect after the next instruction, an interrupt arriving meanwhile still wakes the sleep.
+  sleep_enable();
+  sei();
+  sleep_cpu();
+  sleep_disable();
+}
+
+// Runs every due task, then sleeps if none is due yet. Call at the end of loop().
+// A task rescheduling itself for now runs again in the next pass.
+void RunTasks()
+{
+  unsigned long now = FrameMillis();
+
+  for (byte runs = 0; runs < taskCount && taskHeapSize > 0 && (long)(now - tasks[taskHeap[0]].deadline) >= 0; runs++)
+  {
+    byte id = taskHeap[0];
+    task &t = tasks[id];
+
+    CancelTask(id);
+
+    // Periodic tasks keep their phase, periods missed while busy are skipped rather than run back to back.
+    if (t.period > 0)
+    {
+      t.deadline += ((now - t.deadline) / t.period + 1) * t.period;
+      TaskHeapSet(taskHeapSize++, id);
+      TaskHeapUp(taskHeapSize - 1);
+    }
+
+    if (t.panel == TASK_ANY_PANEL || IsPanelBootup((Panels)t.panel))
+    {
+      t.run();
+    }
+  }
+
+  if (taskHeapSize == 0 || (long)(millis() - tasks[taskHeap[0]].deadline) < 0)
+  {
+    SleepUntilInterrupt();
+  }
+}
+
+#endif
@@ -0,0 +1,70 @@
+// waveTable
+//
+// Waveforms for LED fades, read from PROGMEM tables with linear interpolation.
+// Phases and samples are 16 bit, so a sample scales to the full 12 bits of a
+// PCA9685 channel as well as to a NeoPixel's 8 bits, without the stair-steps
+// of per-degree sampling on slow fades.
+//
+// Version 1.0
+
+#ifndef WAVE_TABLE_H
+#define WAVE_TABLE_H
+
+#include <Arduino.h>
+
+// Table segments, each table holds WAVE_TABLE_SEGMENTS + 1 samples.
+#define WAVE_TABLE_SEGMENTS 64
+
+// sin() over a quarter cycle, scaled to 65535.
+const uint16_t waveQuarterSin[WAVE_TABLE_SEGMENTS + 1] PROGMEM = {
+    0, 1608, 3216, 4821, 6424, 8022, 9616, 11204, 12785, 14359, 15924, 17479, 19024,
+    20557, 22078, 23586, 25079, 26557, 28020, 29465, 30893, 32302, 33692, 35061, 36409, 37736,
+    39039, 40319, 41575, 42806, 44011, 45189, 46340, 47464, 48558, 49624, 50659, 51664, 52638,
+    53580, 54490, 55367, 56211, 57021, 57797, 58537, 59243, 59913, 60546, 61144, 61704, 62227,
+    62713, 63161, 63571, 63943, 64276, 64570, 64826, 65042, 65219, 65357, 65456, 65515, 65535};
+
+// Exponential ease in, (2^8x - 1) / 255, brightness steps that look even to the eye.
+const uint16_t waveEaseIn[WAVE_TABLE_SEGMENTS + 1] PROGMEM = {
+    0, 23, 49, 76, 106, 139, 175, 214, 257, 304, 354, 410, 470,
+    536, 607, 686, 771, 864, 966, 1076, 1197, 1328, 1472, 1628, 1799, 1985,
+    2188, 2409, 2651, 2914, 3201, 3514, 3855, 4227, 4633, 5076, 5558, 6085, 6659,
+    7284, 7967, 8711, 9523, 10408, 11373, 12426, 13574, 14826, 16191, 17680, 19303, 21073,
+    23004, 25109, 27405, 29909, 32639, 35616, 38863, 42404, 46265, 50476, 55067, 60075, 65535};
+
+// Table value at position, 0 to 65535 across the table.
+uint16_t WaveLookup(const uint16_t *table, uint16_t position)
+{
+  byte index = position >> 10;
+  uint16_t fraction = position & 0x3FF;
+  uint16_t a = pgm_read_word(&table[index]);
+  uint16_t b = pgm_read_word(&table[index + 1]);
+
+  return a + (((long)(b - a) * fraction) >> 10);
+}
+
+// Rise and fall of half a sine over one cycle of phase.
+uint16_t WaveHalfSin(uint16_t phase)
+{
+  uint16_t quarter = phase < 0x8000 ? phase : 0xFFFF - phase;
+  return WaveLookup(waveQuarterSin, quarter << 1);
+}
+
+// Linear rise over one cycle of phase.
+inline uint16_t WaveRamp(uint16_t phase)
+{
+  return phase;
+}
+
+// Exponential rise over one cycle of phase.
+inline uint16_t WaveEase(uint16_t phase)
+{
+  return WaveLookup(waveEaseIn, phase);
+}
+
+// Scales a sample to 0 to maxPwm, 4095 for a PCA9685 channel, 255 for a NeoPixel.
+inline int WavePwm(uint16_t sample, int maxPwm)
+{
+  return ((unsigned long)sample * maxPwm + 0x8000) >> 16;
+}
+
+#endif
@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+# vmasm
+#
+# Assembler for ring VM programs, see common/ringVm.h.
+# Reads assembly source and writes a header of PROGMEM byte arrays for
+# LoadVmProgram(). Opcodes, operand sizes and mnemonics are read from
+# ringVm.h itself, mnemonics being the VM_ macro names in lower case, so the
+# assembler follows the interpreter without a table of its own.
+#
+#   vmasm.py -o ../Metaphasic-Vx-Cpu-Core/include/vmPrograms.h sweep.vma pulse.vma
+#
+# Source, one instruction per line, ';' starts a comment:
+#
+#   .equ STEPS 12       ; named constant
+#   loop:               ; label, a jump operand
+#       push 12
+#       jump_zero loop
+#
+# Each file becomes one array named after the file.
+#
+# Version 1.0
+
+import argparse
+import os
+import re
+import sys
+
+RING_VM_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'common', 'ringVm.h')
+
+
+class AsmError(Exception):
+    pass
+
+
+def ReadOps(path):
+    """Returns mnemonic -> (opcode, operand bytes), and the program size, from ringVm.h."""
+    with open(path) as f:
+        text = f.read()
+
+    enum = re.search(r'enum VmOps\s*{(.*?)};', text, re.S).group(1)
+    names = re.findall(r'^\s*(op\w+)', enum, re.M)
+    opcodes = {name: i for i, name in enumerate(names) if name != 'opCount'}
+
+    table = re.search(r'ringVmOpShapes\[opCount\]\[3\] PROGMEM = {(.*?)};', text, re.S).group(1)
+    shapes = [int(n) for n in re.findall(r'{(\d+),', table)]
+    if len(shapes) != len(opcodes):
+        raise AsmError('%s: %d opcodes but %d shapes' % (path, len(opcodes), len(shapes)))
+
+    ops = {}
+    for macro, op in re.findall(r'^#define VM_(\w+)(?:\(\w+\))? (op\w+)', text, re.M):
+        ops[macro.lower()] = (opcodes[op], shapes[opcodes[op]])
+
+    size = int(re.search(r'#define RING_VM_PROGRAM_SIZE (\d+)', text).group(1))
+    return ops, size
+
+
+def Assemble(lines, ops, size):
+    """Two passes, the first places labels, the second encodes. Returns the program bytes."""
+    equs = {}
+    labels = {}
+    code = []
+
+    for number, line in enumerate(lines, 1):
+        line = line.split(';', 1)[0].strip()
+        if not line:
+            continue
+
+        label = re.match(r'^(\w+):\s*(.*)$', line)
+        if label:
+            labels[label.group(1)] = None
+            code.append((number, 'label', [label.group(1)]))
+            line = label.group(2)
+            if not line:
+                continue
+
+        words = line.split()
+        if words[0] == '.equ':
+            if len(words) != 3:
+                raise AsmError('line %d: .equ takes a name and a value' % number)
+            equs[words[1]] = words[2]
+            continue
+
+        mnemonic = words[0].lower()
+        if mnemonic not in ops:
+            raise AsmError('line %d: unknown instruction %s' % (number, words[0]))
+        opcode, operands = ops[mnemonic]
+        if len(words) != (2 if operands else 1):
+            raise AsmError('line %d: %s takes %s operand' % (number, mnemonic, 'one' if operands else 'no'))
+        code.append((number, mnemonic, words[1:]))
+
+    def Value(number, word):
+        word = equs.get(word, word)
+        try:
+            return int(word, 0)
+        except ValueError:
+            raise AsmError('line %d: bad operand %s' % (number, word))
+
+    # Instruction sizes do not depend on operands, so one pass places every label.
+    pc = 0
+    for number, mnemonic, words in code:
+        if mnemonic == 'label':
+            labels[words[0]] = pc
+        else:
+            pc += 1 + ops[mnemonic][1]
+
+    program = []
+    for number, mnemonic, words in code:
+        if mnemonic == 'label':
+            continue
+
+        opcode, operands = ops[mnemonic]
+        program.append(opcode)
+        if not operands:
+            continue
+
+        next = len(program) + operands
+        if words[0] in labels:
+            if not mnemonic.startswith('jump'):
+                raise AsmError('line %d: label %s used outside a jump' % (number, words[0]))
+            value = labels[words[0]] - next
+        else:
+            value = Value(number, words[0])
+
+        if operands == 1:
+            if not -128 <= value <= 255:
+                raise AsmError('line %d: %d does not fit a byte' % (number, value))
+            program.append(value & 0xFF)
+        else:
+            if not -32768 <= value <= 65535:
+                raise AsmError('line %d: %d does not fit 16 bits' % (number, value))
+            program += [value & 0xFF, (value >> 8) & 0xFF]
+
+    if len(program) > size:
+        raise AsmError('%d bytes, programs hold %d' % (len(program), size))
+
+    return program
+
+
+def Header(name, programs, sources):
+    guard = re.sub(r'([a-z])([A-Z])', r'\1_\2', name).upper() + '_H'
+    out = ['// ' + name, '//', '// Generated by tools/vmasm.py from %s, do not edit.' % ', '.join(sources), '']
+    out += ['#ifndef ' + guard, '#define ' + guard, '', '#include <Arduino.h>', '']
+    for name, program in programs:
+        out.append('const byte %s[] PROGMEM = {' % name)
+        for i in range(0, len(program), 12):
+            out.append('    ' + ', '.join('0x%02X' % b for b in program[i:i + 12]) + ',')
+        out[-1] = out[-1][:-1]
+        out += ['};', '']
+    out += ['#endif', '']
+    return '\n'.join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Assembles ring VM programs into a header of PROGMEM arrays.')
+    parser.add_argument('sources', nargs='+')
+    parser.add_argument('-o', '--output', help='header to write, stdout if not given')
+    parser.add_argument('--vm', default=RING_VM_H, help='ringVm.h to take the opcodes from')
+    args = parser.parse_args()
+
+    ops, size = ReadOps(args.vm)
+
+    programs = []
+    for source in args.sources:
+        name = os.path.splitext(os.path.basename(source))[0]
+        name = 'vm' + name[0].upper() + name[1:]
+        with open(source) as f:
+            try:
+                programs.append((name, Assemble(f.readlines(), ops, size)))
+            except AsmError as e:
+                sys.exit('%s: %s' % (source, e))
+
+    name = os.path.splitext(os.path.basename(args.output))[0] if args.output else 'vmPrograms'
+    header = Header(name, programs, [os.path.basename(s) for s in args.sources])
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(header)
+    else:
+        sys.stdout.write(header)
+
+
+if __name__ == '__main__':
+    main()